@@ -32,12 +32,21 @@ public class DSNPacketDumper {
 		
 		// start DSN sniffer */
 		DSNConnector dsnConnection = new DSNConnector();
-		dsnConnection.init();
-		dsnConnection.connect();
+		// optional DSN location, e.g. tcp://localhost:10110 for a DSNReplayServer
+		if (args.length > 1) {
+			dsnConnection.connect( DSNConnector.createTransport(args[1]));
+		} else {
+			dsnConnection.init();
+			dsnConnection.connect();
+		}
 		dsnConnection.setSnifConfig(parser.getSnifferConfig());
 
 		// crate data stream source 
 		DSNPacketSource dsnPacketSource = new DSNPacketSource(dsnConnection, parser);
+		// optional replay speed of the DSN
+		if (args.length > 2) {
+			dsnPacketSource.setTimeScale( Float.parseFloat(args[2]));
+		}
 
 		// create and subscribe data sink
 		dsnPacketSource.subscribe( new AbstractSink<PacketTuple>() {
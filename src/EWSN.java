@@ -6,43 +6,54 @@ import gui.SNIFController;
 import gui.View;
 
 import java.awt.Color;
+import java.io.File;
 import java.io.FileWriter;
-import java.io.IOException;
+import java.io.OutputStreamWriter;
 import java.text.NumberFormat;
+import java.util.ArrayList;
 import java.util.HashMap;
 
 import model.NodeAddress;
+import model.PacketTracer;
 import packetparser.PDL;
 import packetparser.Parser;
 import stream.AbstractPipe;
 import stream.AbstractSink;
 import stream.AbstractSource;
+import stream.Checkpoint;
 import stream.Filter;
 import stream.Predicate;
 import stream.Scheduler;
 import stream.TimeTriggered;
 import stream.Union;
 import stream.tuple.ArrayExtractor;
+import stream.tuple.AsyncTupleLogger;
 import stream.tuple.AttributePredicate;
 import stream.tuple.BinaryDecisionTree;
 import stream.tuple.Counter;
 import stream.tuple.DSNPacketSource;
+import stream.tuple.Demultiplexer;
 import stream.tuple.DistinctInWindow;
 import stream.tuple.GroupingEvaluator;
+import stream.tuple.LinkMetricStore;
+import stream.tuple.CaptureReader;
+import stream.tuple.CaptureWriter;
 import stream.tuple.LogReader;
 import stream.tuple.Mapper;
 import stream.tuple.TopologyAnalyzer;
 import stream.tuple.PacketCrcPredicate;
 import stream.tuple.PacketTuple;
 import stream.tuple.PacketTupleTracer;
-import stream.tuple.Ratio;
 import stream.tuple.PathAnalyzer;
+import stream.tuple.SeqNrCoverage;
 import stream.tuple.SeqNrResetDetector;
 import stream.tuple.TreeAttributePredicate;
 import stream.tuple.Tuple;
 import stream.tuple.TupleAttribute;
 import stream.tuple.TupleChangePredicate;
+import stream.tuple.TupleCodec;
 import stream.tuple.TupleTimeWindowDistinctGroupAggregator;
+import stream.tuple.TimeSeriesSink;
 import stream.tuple.TupleTimeWindowGroupAggregator;
 
 /**
@@ -105,22 +116,43 @@ public class EWSN extends SNIFController {
 	}
 	
 	/**
+	 * Write packets in link-dump format on a background thread
 	 * @param dsnLogWriter
 	 * @return
 	 */
-	private static AbstractSink<PacketTuple> createPacketLogger(final FileWriter dsnLogWriter) {
-		AbstractSink<PacketTuple> packetLogger = new AbstractSink<PacketTuple>() {
-			public void process(PacketTuple o, int srcID, long timestamp) {
-				logLine( dsnLogWriter, "" + timestamp + " " + o.getDsnNode() + " " + o.toString());
+	private static AsyncTupleLogger createPacketLogger(FileWriter dsnLogWriter) {
+		// packet log is complete, the analysis waits if the disk is too slow
+		AsyncTupleLogger logger = new AsyncTupleLogger(dsnLogWriter, AsyncTupleLogger.DEFAULT_CAPACITY, true) {
+			protected String format(Tuple o, long timestamp) {
+				PacketTuple packetTuple = (PacketTuple) o;
+				return "" + timestamp + " " + packetTuple.getDsnNode() + " " + packetTuple.toString();
 			}
 		};
-		return packetLogger;
+		return logger;
 	}
 
 
 	// used to signal run queue
 	private static FileWriter dsnLogWriter;	
 
+	// log files are written on background threads
+	private static AsyncTupleLogger packetLogger;
+	private static AsyncTupleLogger eventLogger;
+
+	// metric history of current run
+	private static TimeSeriesSink historySink;
+
+	// operator state is stored every minute
+	private static final int CHECKPOINT_INTERVAL = 60 * 1000;
+	private static Checkpoint checkpoint;
+
+	// DSN timestamps are corrected for clock offset and drift. Once all clocks are calibrated,
+	// de-jitter delay and duplicate window are reduced to the remaining clock error
+	private static final int DSN_DUPLICATE_TIMEOUT = 1000;
+	private static final int DSN_MIN_DEJITTER_DELAY = 1000;
+	private static final int DSN_MIN_DUPLICATE_TIMEOUT = 100;
+	private static DistinctInWindow distinctInWindow;
+
 	public void setup() {
 		// create view
 		// create graph
@@ -136,7 +168,8 @@ public class EWSN extends SNIFController {
 	}
 
 	/**
-	 * @param args Path to folder containing logFilter logs
+	 * @param args [-resume] [DSN location(s), comma separated, see DSNConnector.createTransport]
+	 *   -resume: restore operator state of an interrupted run from its checkpoint
 	 * @throws Exception
 	 */
 	// @SuppressWarnings("unchecked")
@@ -145,6 +178,18 @@ public class EWSN extends SNIFController {
 		EWSN debugger = new EWSN();
 		debugger.setup();
 
+		// optional DSN location, e.g. tcp://localhost:10110 for a DSNReplayServer,
+		// or several gateways, e.g. tcp://host1:10110,tcp://host2:10110
+		String dsnLocation = null;
+		boolean resume = false;
+		for (String arg : args) {
+			if (arg.equals("-resume")) {
+				resume = true;
+			} else {
+				dsnLocation = arg;
+			}
+		}
+
 		while (true) {
 
 			// --- let's wait for user first..
@@ -155,6 +200,18 @@ public class EWSN extends SNIFController {
 			
 			// get W
 			W = view.getW();
+
+			// periodically store operator state to allow quick restarts
+			if (debugger.useLog) {
+				checkpoint = new Checkpoint(debugger.PACKET_INPUT + ".checkpoint", CHECKPOINT_INTERVAL, resume);
+				debugger.HISTORY_DIR = debugger.PACKET_INPUT + ".history";
+			} else {
+				// a new live session never continues an old one
+				checkpoint = new Checkpoint("dsn.checkpoint", CHECKPOINT_INTERVAL, false);
+				debugger.HISTORY_DIR = "history_"+(System.currentTimeMillis()/1000);
+			}
+			TupleCodec.setParser(parser);
+
 			// -- create whole graph and connect to GUI
 			Filter<PacketTuple> crcFilter = debugger.createAnalysisGraph();
 
@@ -162,12 +219,24 @@ public class EWSN extends SNIFController {
 
 			// ---
 			AbstractSource<PacketTuple> dsnPacketSource = null;
-			DSNConnector dsnConnection = null;
-
-			if (debugger.useLog) {
+			ArrayList<DSNConnector> dsnConnections = new ArrayList<DSNConnector>();
+
+			if (debugger.useLog && debugger.PACKET_INPUT.endsWith(CaptureWriter.SUFFIX)) {
+				CaptureReader captureReader = new CaptureReader(debugger.PACKET_INPUT, parser);
+				dsnPacketSource = captureReader;
+				checkpoint.registerSource(captureReader);
+				if (debugger.START_TIME >= 0) {
+					captureReader.seek(debugger.START_TIME, W * linkAdvPeriod);
+				}
+			} else if (debugger.useLog) {
 				LogReader logReader = LogReader.createLogReaderFromFile(debugger.PACKET_INPUT);
 				logReader.setParser(parser);
 				dsnPacketSource = logReader;
+				checkpoint.registerSource(logReader);
+				if (debugger.START_TIME >= 0) {
+					// fill longest time window before start time
+					logReader.seek(debugger.START_TIME, W * linkAdvPeriod);
+				}
 			}
 
 			if (debugger.useDSN) {
@@ -175,29 +244,69 @@ public class EWSN extends SNIFController {
 				// create log file based on current time
 				dsnLogWriter = new FileWriter("log_"+(System.currentTimeMillis()/1000));
 
-				// DNS connection
-				dsnConnection = new DSNConnector();
-				dsnConnection.registerView(view);
 				// is used for Graph
-				dsnPacketSource = new DSNPacketSource(dsnConnection, parser );
-				AbstractSink<PacketTuple> packetLogger = createPacketLogger(dsnLogWriter);
+				DSNPacketSource dsnSource = new DSNPacketSource( parser );
+				dsnPacketSource = dsnSource;
+				setIngestPriorities(dsnSource);
+				adaptToClockError(dsnSource);
+				dsnSource.getStatusStream().subscribe(historySink, 0);
+				dsnSource.getStatusStream().subscribe(new AbstractSink<Tuple>() {
+					public void process(Tuple o, int srcID, long timestamp) {
+						int dropped = o.getIntAttribute(dropped_Attribute);
+						if (dropped > 0) {
+							view.writeMessage("Overload: " + dropped + " packets dropped, lag "
+									+ o.getAttribute(lag_Attribute) + " ms");
+						}
+					}
+				}, 0);
+				packetLogger = createPacketLogger(dsnLogWriter);
 				dsnPacketSource.subscribe(packetLogger, 0);
 
-				// start DSN sniffer */
-				dsnConnection.init();
-				dsnConnection.connect();
-				dsnConnection.setSnifConfig(parser.getSnifferConfig());
-				dsnConnection.start();
-				view.setBTConnection( dsnConnection.getSnifGateway() );
+				// DSN connection per gateway, first one is time reference
+				String dsnLocations[] = { null };
+				if (dsnLocation != null) {
+					dsnLocations = dsnLocation.split(",");
+				}
+				for (String location : dsnLocations) {
+					DSNConnector dsnConnection = new DSNConnector();
+					dsnConnection.registerView(view);
+					dsnSource.addGateway(dsnConnection);
+
+					// start DSN sniffer */
+					if (location != null) {
+						dsnConnection.connect( DSNConnector.createTransport(location.trim()));
+					} else {
+						dsnConnection.init();
+						dsnConnection.connect();
+					}
+					dsnConnection.setSnifConfig(parser.getSnifferConfig());
+					dsnConnection.start();
+					dsnConnections.add(dsnConnection);
+					view.setBTConnection( dsnConnection.getSnifGateway() );
+				}
 			}
 
 			if (runDebugger) {
 				dsnLogWriter = null;
 				// dsnPacketSource.subscribe( totalDataAggregator, 0);
 				dsnPacketSource.subscribe( crcFilter, 0);
+				// snapshot refers to complete log
+				if (debugger.START_TIME < 0) {
+					Scheduler.registerCheckpoint(checkpoint);
+				}
 			}
 
 			Scheduler.run( dsnPacketSource );
+			Scheduler.registerCheckpoint(null);
+
+			// write pending log entries
+			eventLogger.stop();
+			historySink.close();
+			if (packetLogger != null) {
+				packetLogger.close();
+				packetLogger = null;
+				dsnLogWriter = null;
+			}
 
 			// flush and close file
 			if (dsnLogWriter != null) {
@@ -207,7 +316,9 @@ public class EWSN extends SNIFController {
 
 			// stop DSN
 			if (debugger.useDSN) {
-				dsnConnection.stopConnection();
+				for (DSNConnector dsnConnection : dsnConnections) {
+					dsnConnection.stopConnection();
+				}
 			}
 
 			// update GUI
@@ -237,7 +348,7 @@ public class EWSN extends SNIFController {
 		// pathAdvertisementMapper.subscribe(maxPathQuality , 0);
 
 		// filter packets with identical content reported by different DSN nodes within short time (20 ms)
-		DistinctInWindow distinctInWindow = new DistinctInWindow(1000);
+		distinctInWindow = new DistinctInWindow(DSN_DUPLICATE_TIMEOUT);
 		Filter<PacketTuple> dupFilter = new Filter<PacketTuple>(
 				distinctInWindow);
 		crcFilter.subscribe(dupFilter, 0);
@@ -263,6 +374,7 @@ public class EWSN extends SNIFController {
 		SeqNrResetDetector seqResetDetector = new SeqNrResetDetector("nodeID",
 				"seqNr", WORD_MAX_VALUE, 10);
 		seqNrMapper.subscribe(seqResetDetector, 0);
+		checkpoint.register("seqResetDetector", seqResetDetector);
 
 		// get linkAdvertisement tuple stream
 		Filter<Tuple> linkAdvertisementFilter = new Filter<Tuple>(
@@ -321,6 +433,7 @@ public class EWSN extends SNIFController {
 					"bmac_msg_st.destination", "data_packet.node_id",
 					"data_packet.node_id", "data_packet.seq_nr");
 			multiHopFilter.subscribe(packetTracer, 0);
+			checkpoint.register("packetTracer", PacketTracer.getPacketTracer());
 		} else {
 			packetTracer = new Mapper("PacketTracerTuple",
 					"bmac_msg_st.source", "l2src", "bmac_msg_st.destination",
@@ -334,6 +447,7 @@ public class EWSN extends SNIFController {
 						"packets"), "packetsLastEpoch");
 		packetIdStream.subscribe(packetCount, 0);
 		groupIdStream.subscribe(packetCount, 0);
+		checkpoint.register("packetCount", packetCount);
 
 		// metric: number of valid route announcements ..e
 		TupleTimeWindowGroupAggregator pathAnnouncementsLastEpoch2 = new TupleTimeWindowGroupAggregator(
@@ -341,6 +455,7 @@ public class EWSN extends SNIFController {
 						"routeAnnouncements"), "pathAnnouncementsLastEpoch");
 		pathAdvertisementMapper.subscribe(pathAnnouncementsLastEpoch2, 0);
 		groupIdStream.subscribe(pathAnnouncementsLastEpoch2, 0);
+		checkpoint.register("pathAnnouncementsLastEpoch", pathAnnouncementsLastEpoch2);
 		
 		// metric: number of neighbours reported node ..
 		TupleTimeWindowDistinctGroupAggregator seenByNeighbours = new TupleTimeWindowDistinctGroupAggregator(
@@ -348,6 +463,7 @@ public class EWSN extends SNIFController {
 						"sightings"), "seenNode", "reportingNode", "seenNode");
 		linkAdvertisementMapper.subscribe(seenByNeighbours, 0);
 		groupIdStream.subscribe(seenByNeighbours, 0);
+		checkpoint.register("seenByNeighbours", seenByNeighbours);
 
 		// use "seenNode" as "nodeID"
 		Mapper seenByNeighboursIDMapper = new Mapper(
@@ -362,6 +478,7 @@ public class EWSN extends SNIFController {
 				"seenNode");
 		linkAdvertisementMapper.subscribe(neighboursSeen, 0);
 		groupIdStream.subscribe(neighboursSeen, 0);
+		checkpoint.register("neighboursSeen", neighboursSeen);
 
 		// use "reportingNode" as "nodeID"
 		Mapper neighboursSeenLastEpochIDMapper = new Mapper(
@@ -384,6 +501,7 @@ public class EWSN extends SNIFController {
 				"goodRouteReports");
 		goodRouteFilter.subscribe(goodRouteReports, 0);
 		groupIdStream.subscribe(goodRouteReports, 0);
+		checkpoint.register("goodRouteReports", goodRouteReports);
 
 		// get RoutingLoop detections
 		Filter<Tuple> routingLoopFilter = new Filter<Tuple>(
@@ -396,13 +514,15 @@ public class EWSN extends SNIFController {
 				new Counter("RoutingLoops", "reports"), "routingLoopReports");
 		routingLoopFilter.subscribe(routingLoopReports, 0);
 		groupIdStream.subscribe(routingLoopReports, 0);
+		checkpoint.register("routingLoopReports", routingLoopReports);
 
 		// get observation quality .. -- requires smoothing
-		TupleTimeWindowDistinctGroupAggregator observationQuality = new TupleTimeWindowDistinctGroupAggregator(
-				4 * W * beaconPeriod, new Ratio("ObservationQuality", "seqNr"),
-				"nodeID", "nodeID", "seqNr");
+		SeqNrCoverage observationQuality = new SeqNrCoverage(
+				4 * W * beaconPeriod, "nodeID", "seqNr", WORD_MAX_VALUE,
+				"ObservationQuality");
 		seqNrMapper.subscribe(observationQuality, 0);
 		groupIdStream.subscribe(observationQuality, 0);
+		checkpoint.register("observationQuality", observationQuality);
 
 		// reboots last epoch
 		TupleTimeWindowGroupAggregator rebootCount = new TupleTimeWindowGroupAggregator(
@@ -410,6 +530,7 @@ public class EWSN extends SNIFController {
 						"reboots"), "rebootsLastEpoch");
 		seqResetDetector.subscribe(rebootCount, 0);
 		groupIdStream.subscribe(rebootCount, 0);
+		checkpoint.register("rebootCount", rebootCount);
 
 		// get all metric streams
 		Union<Tuple> metricStream = new Union<Tuple>();
@@ -433,12 +554,15 @@ public class EWSN extends SNIFController {
 		GroupingEvaluator stateDetector = GroupingEvaluator
 				.createBinaryTreeEvaluator(firstTest, "nodeID",
 						"stateDetector");
+		// drop metrics of crashed or removed nodes
+		stateDetector.setTimeToLive(2 * W * pathAdvPeriod);
 		metricStream.subscribe(stateDetector, 0);
 
 		// get node state changes
-		Filter<Tuple> nodeStateChangeFilter = new Filter<Tuple>(
-				new TupleChangePredicate("nodeID"));
+		TupleChangePredicate nodeStateChange = new TupleChangePredicate("nodeID");
+		Filter<Tuple> nodeStateChangeFilter = new Filter<Tuple>(nodeStateChange);
 		stateDetector.subscribe(nodeStateChangeFilter, 0);
+		checkpoint.register("nodeStateChange", nodeStateChange);
 
 		// network partition detetction
 		int packetTracerID = 1;
@@ -450,67 +574,36 @@ public class EWSN extends SNIFController {
 		nodeStateChangeFilter.subscribe(partitionDetection,
 				nodeStateChangeFilterID);
 		partitionDetection.subscribe(metricStream, 0);
+		checkpoint.register("partitionDetection", partitionDetection);
 
 		// log to file
-		AbstractSink<Tuple> logger = new AbstractSink<Tuple>() {
-			public void process(Tuple o, int srcID, long timestamp) {
-				logLine(dsnLogWriter, "" + timestamp / 1000 + " -- "
-						+ o.toString());
-			}
-		};
-		nodeStateChangeFilter.subscribe(logger, 0);
-		eventStream.subscribe(logger, 0);
+		eventLogger = new AsyncTupleLogger(new OutputStreamWriter(System.out),
+				AsyncTupleLogger.DEFAULT_CAPACITY);
+		nodeStateChangeFilter.subscribe(eventLogger, 0);
+		eventStream.subscribe(eventLogger, 0);
+
+		// store metrics and events for queries by node and time
+		historySink = new TimeSeriesSink(new File(HISTORY_DIR));
+		metricStream.subscribe(historySink, 0);
+		nodeStateChangeFilter.subscribe(historySink, 0);
+		eventStream.subscribe(historySink, 0);
 
 		// metricStream.subscribe(logger, 0);
 		// routeAnalyzer.subscribe(logger, 0);
 		// packetTupleMapper.subscribe(logger, 0);		
 
-		// map "from", "to" -> "linkID=from#to
-		Tuple.registerTupleType("LinkTuple", "linkID");
-		AbstractPipe<Tuple, Tuple> linkEnumeratorNeighbours = new AbstractPipe<Tuple, Tuple>() {
-			final TupleAttribute idField = new TupleAttribute("linkID");
-
-			final TupleAttribute fromAttribute = new TupleAttribute(
-					"reportingNode");
-
-			final TupleAttribute toAttribute = new TupleAttribute("seenNode");
-
-			public void process(Tuple o, int srcID, long timestamp) {
-				int from = o.getIntAttribute(fromAttribute);
-				int to = o.getIntAttribute(toAttribute);
-				Tuple tuple = Tuple.createTuple("LinkTuple");
-				tuple.setAttribute(idField, "" + from + "#" + to);
-				transfer(tuple, timestamp);
-			}
-		};
-		linkAdvertisementMapper.subscribe(linkEnumeratorNeighbours, 0);
 		// metric: nr of times a neighbour was was reported last ..
-		TupleTimeWindowGroupAggregator linkNeighboursLastEpoch = new TupleTimeWindowGroupAggregator(
-				W * linkAdvPeriod, "linkID", new Counter("LinkListed",
-						"reports"), "linkNeighboursLastEpoch");
-		linkEnumeratorNeighbours.subscribe(linkNeighboursLastEpoch, 0);
-
-		AbstractPipe<Tuple, Tuple> linkEnumeratorData = new AbstractPipe<Tuple, Tuple>() {
-			final TupleAttribute idField = new TupleAttribute("linkID");
+		LinkMetricStore linkNeighboursLastEpoch = new LinkMetricStore(
+				W * linkAdvPeriod, "reportingNode", "seenNode", "LinkListed",
+				"reports");
+		linkAdvertisementMapper.subscribe(linkNeighboursLastEpoch, 0);
+		checkpoint.register("linkNeighboursLastEpoch", linkNeighboursLastEpoch);
 
-			final TupleAttribute l2srcAttribute = new TupleAttribute("l2src");
-
-			final TupleAttribute l2dstAttribute = new TupleAttribute("l2dst");
-
-			public void process(Tuple o, int srcID, long timestamp) {
-				int from = o.getIntAttribute(l2srcAttribute);
-				int to = o.getIntAttribute(l2dstAttribute);
-				Tuple tuple = Tuple.createTuple("LinkTuple");
-				tuple.setAttribute(idField, "" + from + "#" + to);
-				transfer(tuple, timestamp);
-			}
-		};
-		packetTracer.subscribe(linkEnumeratorData, 0);
 		// metric: nr of times a packet was sent across a link ..
-		TupleTimeWindowGroupAggregator linkDataLastEpoch = new TupleTimeWindowGroupAggregator(
-				W * dataPeriod, "linkID", new Counter("LinkData", "reports"),
-				"linkDataLastEpoch");
-		linkEnumeratorData.subscribe(linkDataLastEpoch, 0);
+		LinkMetricStore linkDataLastEpoch = new LinkMetricStore(
+				W * dataPeriod, "l2src", "l2dst", "LinkData", "reports");
+		packetTracer.subscribe(linkDataLastEpoch, 0);
+		checkpoint.register("linkDataLastEpoch", linkDataLastEpoch);
 
 		// connect to GUI
 		createGuiSink(dupFilter, linkAdvertisementMapper, metricStream,
@@ -518,6 +611,9 @@ public class EWSN extends SNIFController {
 				linkDataLastEpoch, seqNrMapper, multiHopFilter,
 				pathAdvertisementMapper, linkBeaconFilter);
 
+		// dispatch on packet type once instead of testing it in every type filter
+		Demultiplexer.foldAttributeFilters(dupFilter);
+
 		return crcFilter;
 	}
 
@@ -707,7 +803,7 @@ public class EWSN extends SNIFController {
 	 */
 	private static void createGuiSink(Filter<PacketTuple> dupFilter, Mapper linkAdvertisementMapper,
 			Union<Tuple> metricStream, Union<Tuple> eventStream, Filter<Tuple> nodeStateChangeFilter,
-			TupleTimeWindowGroupAggregator linkNeighboursCount, TupleTimeWindowGroupAggregator linkDataCount,
+			LinkMetricStore linkNeighboursCount, LinkMetricStore linkDataCount,
 			AbstractPipe<Tuple, Tuple> seqNrMapper, AbstractPipe<Tuple, Tuple> multiHopFilter,
 			AbstractPipe<Tuple, Tuple> pathAdvertisementMapper, AbstractPipe<Tuple, Tuple> linkBeaconFilter) {
 		// GUI
@@ -814,10 +910,9 @@ public class EWSN extends SNIFController {
 						break;
 					case 5:
 					case 6:
-						String link = (String) o.getAttribute(linkID_Attribute);
-						String parts[] = link.split("#");
-						int from = Integer.parseInt( parts[0]) + 1;
-						int to = Integer.parseInt( parts[1])   + 1;
+						int link = o.getIntAttribute(linkID_Attribute);
+						int from = LinkMetricStore.getFrom(link) + 1;
+						int to = LinkMetricStore.getTo(link) + 1;
 						int reports = o.getIntAttribute(reports_Attribute);
 						metric = getNodeInfo(from);
 						metric.lastLinkAdv = timestamp / 1000;
@@ -901,6 +996,48 @@ public class EWSN extends SNIFController {
 		});
 	}
 
+	/**
+	 * Under overload, keep beacons and route adverts, drop duplicates and data first
+	 * @param dsnSource
+	 */
+	/**
+	 * reduce de-jitter delay and duplicate window after clock calibration, checked with every ingest status
+	 * @param dsnSource
+	 */
+	private static void adaptToClockError(final DSNPacketSource dsnSource) {
+		dsnSource.getStatusStream().subscribe(new AbstractSink<Tuple>() {
+			public void process(Tuple o, int srcID, long timestamp) {
+				if (!dsnSource.isClockCalibrated()) return;
+				// corrected timestamps of duplicates differ by up to twice the clock error
+				long clockError = 2 * dsnSource.getMaxClockError();
+				int dejitterDelay = (int) Math.min( DSNPacketSource.De_JITTER_DELAY, DSN_MIN_DEJITTER_DELAY + clockError);
+				int duplicateTimeout = (int) Math.min( DSN_DUPLICATE_TIMEOUT, DSN_MIN_DUPLICATE_TIMEOUT + clockError);
+				if (duplicateTimeout != distinctInWindow.getDuplicateTimeout()) {
+					view.writeMessage("Clocks calibrated: de-jitter delay " + dejitterDelay
+							+ " ms, duplicate window " + duplicateTimeout + " ms");
+				}
+				dsnSource.setDejitterDelay(dejitterDelay);
+				distinctInWindow.setDuplicateTimeout(duplicateTimeout);
+			}
+		}, 0);
+	}
+
+	private static void setIngestPriorities(DSNPacketSource dsnSource) {
+		final Object controlTypes[] = { parser.getValue("BEACON_TYPE"), parser.getValue("ADVERT_TYPE"),
+				parser.getValue("DISTANCE_TYPE") };
+		dsnSource.setPriority( new Predicate<PacketTuple>() {
+			final TupleAttribute typeAttribute = new TupleAttribute("ccc_packet_st.type");
+			public boolean invoke(PacketTuple o, long timestamp) {
+				if (!o.exists(typeAttribute.getName())) return false;
+				Object type = o.getAttribute(typeAttribute);
+				for (Object controlType : controlTypes) {
+					if (controlType.equals(type)) return true;
+				}
+				return false;
+			}
+		}, DSNPacketSource.PRIORITY_DATA + 2);
+	}
+
 	/**
 	 * @return
 	 */
@@ -916,15 +1053,6 @@ public class EWSN extends SNIFController {
 
 
 
-	private static void logLine( FileWriter writer, String text)  {
-		System.out.println( text );
-		if (writer != null) {
-			try {
-				writer.write(text+"\n");
-				writer.flush();
-			} catch (IOException e) { /** */}
-		}
-	}
 	
 	static final TupleAttribute bmac_src_Attribute = new TupleAttribute("bmac_msg_st.source");
 	static final TupleAttribute bmac_dst_Attribute = new TupleAttribute("bmac_msg_st.destination");
@@ -940,5 +1068,7 @@ public class EWSN extends SNIFController {
 	static final TupleAttribute packets_Attribute = new TupleAttribute("packets");
 	static final TupleAttribute sightings_Attribute = new TupleAttribute("sightings");
 	static final TupleAttribute seqNr_Attribute = new TupleAttribute("seqNr");
+	static final TupleAttribute dropped_Attribute = new TupleAttribute("dropped");
+	static final TupleAttribute lag_Attribute = new TupleAttribute("lag");
 	static final TupleAttribute beacon_packet_battery_Attribute = new TupleAttribute("beacon_packet.battery");
 }
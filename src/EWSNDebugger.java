@@ -7,7 +7,7 @@ import gui.View;
 
 import java.awt.Color;
 import java.io.FileWriter;
-import java.io.IOException;
+import java.io.OutputStreamWriter;
 import java.text.NumberFormat;
 import java.util.HashMap;
 
@@ -23,20 +23,23 @@ import stream.Scheduler;
 import stream.TimeTriggered;
 import stream.Union;
 import stream.tuple.ArrayExtractor;
+import stream.tuple.AsyncTupleLogger;
 import stream.tuple.AttributePredicate;
 import stream.tuple.BinaryDecisionTree;
 import stream.tuple.Counter;
 import stream.tuple.DSNPacketSource;
+import stream.tuple.Demultiplexer;
 import stream.tuple.DistinctInWindow;
 import stream.tuple.GroupingEvaluator;
+import stream.tuple.LinkMetricStore;
 import stream.tuple.LogReader;
 import stream.tuple.Mapper;
 import stream.tuple.TopologyAnalyzer;
 import stream.tuple.PacketCrcPredicate;
 import stream.tuple.PacketTuple;
 import stream.tuple.PacketTupleTracer;
-import stream.tuple.Ratio;
 import stream.tuple.PathAnalyzer;
+import stream.tuple.SeqNrCoverage;
 import stream.tuple.SeqNrResetDetector;
 import stream.tuple.TreeAttributePredicate;
 import stream.tuple.Tuple;
@@ -97,21 +100,28 @@ public class EWSNDebugger extends SNIFController {
 
 	
 	/**
+	 * Write packets in link-dump format on a background thread
 	 * @param dsnLogWriter
 	 * @return
 	 */
-	private static AbstractSink<PacketTuple> createPacketLogger(final FileWriter dsnLogWriter) {
-		AbstractSink<PacketTuple> packetLogger = new AbstractSink<PacketTuple>() {
-			public void process(PacketTuple o, int srcID, long timestamp) {
-				logLine( dsnLogWriter, "" + timestamp + " " + o.getDsnNode() + " " + o.toString());
+	private static AsyncTupleLogger createPacketLogger(FileWriter dsnLogWriter) {
+		// packet log is complete, the analysis waits if the disk is too slow
+		AsyncTupleLogger logger = new AsyncTupleLogger(dsnLogWriter, AsyncTupleLogger.DEFAULT_CAPACITY, true) {
+			protected String format(Tuple o, long timestamp) {
+				PacketTuple packetTuple = (PacketTuple) o;
+				return "" + timestamp + " " + packetTuple.getDsnNode() + " " + packetTuple.toString();
 			}
 		};
-		return packetLogger;
+		return logger;
 	}
 	
 
 	private static FileWriter dsnLogWriter;	
 
+	// log files are written on background threads
+	private static AsyncTupleLogger packetLogger;
+	private static AsyncTupleLogger eventLogger;
+
 	public void setup() {
 		// create view
 		// create graph
@@ -284,8 +294,8 @@ public class EWSNDebugger extends SNIFController {
 			routingLoopFilter.subscribe(routingLoopReports , 0);
 
 			// get observation quality last 2 epochs
-			TupleTimeWindowDistinctGroupAggregator observationQuality = new TupleTimeWindowDistinctGroupAggregator
-			( epoch, new Ratio ( "ObservationQuality", "seqNr"), "nodeID", "nodeID", "seqNr") ;
+			SeqNrCoverage observationQuality = new SeqNrCoverage
+			( epoch, "nodeID", "seqNr", WORD_MAX_VALUE, "ObservationQuality") ;
 			seqNrMapper.subscribe( observationQuality, 0 );
 			
 			// reboots last epoch
@@ -434,60 +444,31 @@ public class EWSNDebugger extends SNIFController {
 			partitionDetection.subscribe( metricStream, 0);
 
 			// log to file
-			AbstractSink<Tuple> logger = new AbstractSink<Tuple>() {
-				public void process(Tuple o, int srcID, long timestamp) {
-					logLine( dsnLogWriter, "" + timestamp/1000 + " -- " + o.toString() );
-				}
-			};
-			nodeStateChangeFilter.subscribe( logger, 0);
-			eventStream.subscribe(logger, 0);
+			eventLogger = new AsyncTupleLogger( new OutputStreamWriter(System.out), AsyncTupleLogger.DEFAULT_CAPACITY);
+			nodeStateChangeFilter.subscribe( eventLogger, 0);
+			eventStream.subscribe( eventLogger, 0);
 
 			// metricStream.subscribe(logger, 0);
 			// routeAnalyzer.subscribe(logger, 0);
 			// packetTupleMapper.subscribe(logger, 0);		
 
-			// map "from", "to" -> "linkID=from#to
-			AbstractPipe<Tuple,Tuple> linkEnumeratorNeighbours = new AbstractPipe<Tuple,Tuple>() {
-				final TupleAttribute idField = new TupleAttribute("linkID");
-				final TupleAttribute fromAttribute = new TupleAttribute("reportingNode");
-				final TupleAttribute toAttribute = new TupleAttribute("seenNode");
-				public void process(Tuple o, int srcID, long timestamp) {
-					int from = o.getIntAttribute(fromAttribute);
-					int to = o.getIntAttribute(toAttribute);
-					Tuple tuple = Tuple.createTuple("LinkTuple");
-					tuple.setAttribute(idField, "" + from + "#" + to);
-					transfer( tuple, timestamp);
-				}
-			};
-			linkAdvertisementMapper.subscribe( linkEnumeratorNeighbours, 0);
 			// metric: nr of times a neighbour was was reported last 2 epoch
-			TupleTimeWindowGroupAggregator linkNeighboursLastEpoch =
-				new TupleTimeWindowGroupAggregator ( 2 * epoch, "linkID", new Counter( "LinkListed", "reports"),"linkNeighboursLastEpoch");
-			linkEnumeratorNeighbours.subscribe(linkNeighboursLastEpoch , 0);
-
-			Tuple.registerTupleType( "LinkTuple", "linkID");
-			AbstractPipe<Tuple,Tuple> linkEnumeratorData = new AbstractPipe<Tuple,Tuple>() {
-				final TupleAttribute idField = new TupleAttribute("linkID");
-				final TupleAttribute l2srcAttribute = new TupleAttribute("l2src");
-				final TupleAttribute l2dstAttribute = new TupleAttribute("l2dst");
-				public void process(Tuple o, int srcID, long timestamp) {
-					int from = o.getIntAttribute(l2srcAttribute);
-					int to = o.getIntAttribute(l2dstAttribute);
-					Tuple tuple = Tuple.createTuple("LinkTuple");
-					tuple.setAttribute(idField, "" + from + "#" + to);
-					transfer( tuple, timestamp);
-				}
-			};
-			packetTracer.subscribe( linkEnumeratorData, 0);
+			LinkMetricStore linkNeighboursLastEpoch =
+				new LinkMetricStore ( 2 * epoch, "reportingNode", "seenNode", "LinkListed", "reports");
+			linkAdvertisementMapper.subscribe(linkNeighboursLastEpoch , 0);
+
 			// metric: nr of times a packet was sent across a link last 2 epoch
-			TupleTimeWindowGroupAggregator linkDataLastEpoch =
-				new TupleTimeWindowGroupAggregator ( 2 * epoch, "linkID", new Counter( "LinkData", "reports"),"linkDataLastEpoch");
-			linkEnumeratorData.subscribe(linkDataLastEpoch , 0);
+			LinkMetricStore linkDataLastEpoch =
+				new LinkMetricStore ( 2 * epoch, "l2src", "l2dst", "LinkData", "reports");
+			packetTracer.subscribe(linkDataLastEpoch , 0);
 
 			// connect to GUI
 			createGuiSink(dupFilter, linkAdvertisementMapper, metricStream, eventStream, nodeStateChangeFilter,
 					linkNeighboursLastEpoch, linkDataLastEpoch, seqNrMapper, multiHopFilter,
 					pathAdvertisementMapper, linkBeaconFilter);
+
+			// dispatch on packet type once instead of testing it in every type filter
+			Demultiplexer.foldAttributeFilters(dupFilter);
 			Scheduler.registerClockView( new TimeTriggered() {
 				public void handleTimerEvent(long timestamp) {
 					view.setTime( ""+(timestamp / 1000)+ " s");
@@ -513,6 +494,10 @@ public class EWSNDebugger extends SNIFController {
 				LogReader logReader = LogReader.createLogReaderFromFile(debugger.PACKET_INPUT);
 				logReader.setParser(parser);
 				dsnPacketSource = logReader;
+				if (debugger.START_TIME >= 0) {
+					// fill time windows before start time
+					logReader.seek(debugger.START_TIME, 2 * epoch);
+				}
 			}
 
 			if (debugger.useDSN) {
@@ -525,7 +510,7 @@ public class EWSNDebugger extends SNIFController {
 
 				// is used for Graph
 				dsnPacketSource = new DSNPacketSource(dsnConnection, parser );
-				AbstractSink<PacketTuple> packetLogger = createPacketLogger(dsnLogWriter);
+				packetLogger = createPacketLogger(dsnLogWriter);
 				dsnPacketSource.subscribe(packetLogger, 0);
 
 				// start DSN sniffer */
@@ -544,6 +529,14 @@ public class EWSNDebugger extends SNIFController {
 
 			Scheduler.run( dsnPacketSource );
 
+			// write pending log entries
+			eventLogger.stop();
+			if (packetLogger != null) {
+				packetLogger.close();
+				packetLogger = null;
+				dsnLogWriter = null;
+			}
+
 			
 			// flush and close file
 			if (dsnLogWriter != null) {
@@ -679,10 +672,9 @@ public class EWSNDebugger extends SNIFController {
 						break;
 					case 5:
 					case 6:
-						String link = (String) o.getAttribute(linkID_Attribute);
-						String parts[] = link.split("#");
-						int from = Integer.parseInt( parts[0]) + 1;
-						int to = Integer.parseInt( parts[1])   + 1;
+						int link = o.getIntAttribute(linkID_Attribute);
+						int from = LinkMetricStore.getFrom(link) + 1;
+						int to = LinkMetricStore.getTo(link) + 1;
 						int reports = o.getIntAttribute(reports_Attribute);
 						metric = getNodeInfo(from);
 						metric.lastLinkAdv = timestamp / 1000;
@@ -776,15 +768,6 @@ public class EWSNDebugger extends SNIFController {
 
 
 
-	private static void logLine( FileWriter writer, String text)  {
-		System.out.println( text );
-		if (writer != null) {
-			try {
-				writer.write(text+"\n");
-				writer.flush();
-			} catch (IOException e) { /** */}
-		}
-	}
 
 	static final TupleAttribute bmac_src_Attribute = new TupleAttribute("bmac_msg_st.source");
 	static final TupleAttribute bmac_dst_Attribute = new TupleAttribute("bmac_msg_st.destination");
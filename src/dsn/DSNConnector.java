@@ -7,13 +7,12 @@ import javax.bluetooth.BluetoothStateException;
 import javax.bluetooth.DeviceClass;
 import javax.bluetooth.DiscoveryAgent;
 import javax.bluetooth.DiscoveryListener;
-import javax.bluetooth.L2CAPConnection;
 import javax.bluetooth.LocalDevice;
 import javax.bluetooth.RemoteDevice;
 import javax.bluetooth.ServiceRecord;
-import javax.microedition.io.Connector;
 
 import packetparser.PDL;
+import packetparser.PacketBufferPool;
 import packetparser.PhyConfig;
 
 
@@ -26,7 +25,7 @@ public class DSNConnector extends Thread implements DiscoveryListener {
 	@SuppressWarnings("unused")
 	private static final int SNIF_COD_MAJOR = 3;
 
-	private L2CAPConnection con;
+	private DSNTransport transport;
 	
 	private final String btPrefix = "00043F00";
 
@@ -38,7 +37,8 @@ public class DSNConnector extends Thread implements DiscoveryListener {
 
 	private PacketListener packetListener;
 
-	private static PhyConfig snifConfig;
+	/** config sent periodically to this gateway */
+	private PhyConfig snifConfig;
 
 	private View view = null;
 	
@@ -74,8 +74,36 @@ public class DSNConnector extends Thread implements DiscoveryListener {
 		}
 	}
 	
-	public L2CAPConnection getConnection() {
-		return con;
+	public DSNTransport getTransport() {
+		return transport;
+	}
+
+	/**
+	 * Factory method to create a transport from a location string
+	 * 
+	 * tcp://host:port      - SocketTransport, e.g. to a DSNReplayServer
+	 * pipe:path            - StreamTransport reading from a named pipe
+	 * btl2cap://address    - L2CAP connection to a BTnode gateway
+	 * address              - L2CAP connection to a BTnode gateway
+	 * 
+	 * @param location
+	 */
+	public static DSNTransport createTransport(String location) {
+		if (location.startsWith("tcp://")) {
+			String hostPort = location.substring("tcp://".length());
+			int colon = hostPort.lastIndexOf(':');
+			if (colon < 0) {
+				return new SocketTransport(hostPort, DSNReplayServer.DEFAULT_PORT);
+			}
+			return new SocketTransport(hostPort.substring(0, colon), Integer.parseInt(hostPort.substring(colon+1)));
+		}
+		if (location.startsWith("pipe:")) {
+			return StreamTransport.createPipeTransport(location.substring("pipe:".length()));
+		}
+		if (location.startsWith("btl2cap://")) {
+			location = location.substring("btl2cap://".length());
+		}
+		return new L2CAPTransport(location);
 	}
 	
 	public void servicesDiscovered(int transID, ServiceRecord[] servRecord) {
@@ -98,18 +126,34 @@ public class DSNConnector extends Thread implements DiscoveryListener {
 	 * @param bt_mac_address
 	 */
 	public void connect(String bt_mac_address) {
-		stopConnection = false;
 		snifGateway = bt_mac_address;
+		connect( new L2CAPTransport(bt_mac_address));
+	}
+	
+	/**
+	 * connect to DSN using given transport, retry until successful or stopped
+	 * @param dsnTransport
+	 */
+	public void connect(DSNTransport dsnTransport) {
+		stopConnection = false;
+		if (snifGateway == null) {
+			snifGateway = dsnTransport.getName();
+		}
 		while (!stopConnection) {
 			// try to connect
-	    	writeMessage("Connecting to DSN via BTnode " + snifGateway);
+	    	writeMessage("Connecting to DSN via " + dsnTransport.getName());
 	    	try {
-				con = (L2CAPConnection) Connector.open("btl2cap://" + snifGateway + ":1011");
+	    		dsnTransport.open();
+	    		transport = dsnTransport;
 		    	// connected !!!
-		    	writeMessage("Connected to DSN via BTnode " + snifGateway);
+		    	writeMessage("Connected to DSN via " + dsnTransport.getName());
 		    	return;
 			} catch (IOException e) {
-		    	writeMessage("Retry...");
+		    	writeMessage("Retry... (" + e.getMessage() + ")");
+		    	try {
+					Thread.sleep(1000);
+				} catch (InterruptedException e1) {
+				}
 			}
 		}
 	}
@@ -126,7 +170,6 @@ public class DSNConnector extends Thread implements DiscoveryListener {
 			try {
 			    // start inquiry
 			    agent.startInquiry(DiscoveryAgent.GIAC, this);
-			    con = getConnection();
 
 			    // wait for max 10 seconds for inq result
 			    int i = 0;
@@ -145,7 +188,9 @@ public class DSNConnector extends Thread implements DiscoveryListener {
 			    if (snifGateway != null && !stopConnection) {
 			    	// try to connect
 			    	writeMessage("Connecting to DSN via BTnode " + snifGateway);
-			    	con = (L2CAPConnection) Connector.open("btl2cap://" + snifGateway + ":1011");
+			    	DSNTransport l2capTransport = new L2CAPTransport(snifGateway);
+			    	l2capTransport.open();
+			    	transport = l2capTransport;
 
 			    	// connected !!!
 			    	writeMessage("Connected to DSN via BTnode " + snifGateway);
@@ -164,16 +209,18 @@ public class DSNConnector extends Thread implements DiscoveryListener {
 	
 	void sendConfig(PhyConfig config) throws IOException {
 		byte config_data [] = config.serialize();
-		if (con != null) {
-			con.send(config_data);
+		if (transport != null) {
+			transport.send(config_data);
 		}
 	}
 
 	private void receivePacket() throws IOException {
-		byte data[] = new byte[255];
-		int len = con.receive(data);
+		byte data[] = PacketBufferPool.getInstance().acquire();
+		int len = transport.receive(data);
 		if (packetListener != null) {
-			packetListener.handlePacket(len, data);
+			packetListener.handlePacket(this, len, data);
+		} else {
+			PacketBufferPool.getInstance().recycle(data);
 		}
 	}
 	
@@ -183,10 +230,15 @@ public class DSNConnector extends Thread implements DiscoveryListener {
 	 * pre: snifConfig available, connected to DSN
 	 */
 	public void run() {
+		setName("DSNConnector " + snifGateway);
 		stopConnection = false;
 		int timeSyncIntervalMillis = 10000;
 		long lastTimestamp = 0;
 		try {
+			if (transport == null) {
+				writeMessage("Not connected to DSN via " + snifGateway);
+				return;
+			}
 			while (!stopConnection) {
 				// check, if timestamp should be sent
 				if (System.currentTimeMillis() - lastTimestamp > timeSyncIntervalMillis) {
@@ -194,7 +246,7 @@ public class DSNConnector extends Thread implements DiscoveryListener {
 					lastTimestamp = System.currentTimeMillis();
 				}
 				// check for new packets
-				else if (con.ready()) {
+				else if (transport.ready()) {
 					receivePacket();
 				}
 				// sleep for 10 ms
@@ -211,7 +263,13 @@ public class DSNConnector extends Thread implements DiscoveryListener {
 			// TODO Auto-generated catch block
 			e.printStackTrace();
 		} finally {
-			view.setBTConnection(null);
+			// not connected, if connect() was stopped before it succeeded
+			if (transport != null) {
+				transport.close();
+			}
+			if (view != null) {
+				view.setBTConnection(null);
+			}
 		}
 	}
 	
@@ -219,12 +277,12 @@ public class DSNConnector extends Thread implements DiscoveryListener {
 		packetListener = listener;
 	}
 
-	public static PhyConfig getSnifConfig() {
+	public PhyConfig getSnifConfig() {
 		return snifConfig;
 	}
 
 	public void setSnifConfig(PhyConfig snif_config) {
-		DSNConnector.snifConfig = snif_config;
+		snifConfig = snif_config;
 	}
 
 
@@ -0,0 +1,191 @@
+package dsn;
+
+import gui.View;
+
+import java.io.BufferedOutputStream;
+import java.io.IOException;
+import java.io.OutputStream;
+import java.net.ServerSocket;
+import java.net.Socket;
+
+import packetparser.PacketBufferPool;
+import stream.tuple.LogReader;
+
+/**
+ * Streams a packet log (as written by the SNIF applications) to a SocketTransport
+ * using the sniffed packet framing of the DSN. 
+ * 
+ * The log is replayed at a configurable multiple of real time, speed <= 0 sends as fast
+ * as the receiver accepts. Time ticks are inserted every second of log time.
+ * 
+ * Usage: DSNReplayServer logfile [port] [speed]
+ *  
+ * @author mringwal
+ *
+ */
+public class DSNReplayServer {
+
+	public static final int DEFAULT_PORT = 10110;
+
+	private static final int TICK_INTERVAL = 1000;
+
+	/** bt address used for ticks */
+	private static final int GATEWAY_ADDRESS = 0;
+
+	/** largest payload that fits into a sniffed packet frame */
+	static final int MAX_PAYLOAD_LEN = DSNTransport.MAX_PACKET_LEN - DSNTransport.SNIFFED_PACKET_HEADER_LEN;
+	
+	private String logFile;
+	private int port;
+	private float speed;
+	private View view = null;
+	
+	public DSNReplayServer(String logFile, int port, float speed) {
+		this.logFile = logFile;
+		this.port = port;
+		this.speed = speed;
+	}
+
+	/**
+	 * serve replay to one client after the other
+	 * @throws IOException
+	 */
+	public void run() throws IOException {
+		ServerSocket serverSocket = new ServerSocket(port);
+		writeMessage("Replay server listening on port " + port);
+		while (true) {
+			Socket client = serverSocket.accept();
+			client.setTcpNoDelay(true);
+			writeMessage("Replaying " + logFile + " to " + client.getInetAddress() + " at speed " + speed);
+			long startMillis = System.currentTimeMillis();
+			int count = 0;
+			try {
+				count = replay( new BufferedOutputStream( client.getOutputStream(), 65536));
+			} catch (IOException e) {
+				writeMessage("Client disconnected: " + e.getMessage());
+			} catch (InterruptedException e) {
+				e.printStackTrace();
+			}
+			client.close();
+			long duration = System.currentTimeMillis() - startMillis;
+			writeMessage("Sent " + count + " packets in " + duration + " ms");
+		}
+	}
+
+	private void writeMessage(String s) {
+		System.out.println(s);
+		if (view != null) {
+			view.writeMessage(s);
+		}
+	}
+
+	/**
+	 * show status messages in view, e.g. if server runs inside a SNIF application
+	 * @param view
+	 */
+	public void registerView(View view) {
+		this.view = view;
+	}
+
+	/**
+	 * @param out
+	 * @return nr of packets sent
+	 * @throws IOException
+	 * @throws InterruptedException
+	 */
+	public int replay(OutputStream out) throws IOException, InterruptedException {
+		LogReader reader = LogReader.createLogReaderFromFile(logFile);
+		byte frame[] = new byte[DSNTransport.MAX_PACKET_LEN];
+		long firstTimestamp = 0;
+		long startMillis = 0;
+		long nextTick = 0;
+		int count = 0;
+		while (true) {
+			LogReader.Packet packet;
+			try {
+				packet = reader.readPacket();
+			} catch (Exception e) {
+				break;
+			}
+			if (packet == null) break;
+
+			if (count == 0) {
+				firstTimestamp = packet.timestamp;
+				nextTick = firstTimestamp;
+				startMillis = System.currentTimeMillis();
+			}
+
+			// pace against wall clock
+			if (speed > 0) {
+				long due = startMillis + (long) ((packet.timestamp - firstTimestamp) / speed);
+				long now = System.currentTimeMillis();
+				if (due > now) {
+					out.flush();
+					Thread.sleep( due - now );
+				}
+			}
+			
+			// ticks
+			while (nextTick <= packet.timestamp) {
+				int len = encodeFrame( frame, GATEWAY_ADDRESS, nextTick, null, 0);
+				out.write(frame, 0, len);
+				nextTick += TICK_INTERVAL;
+			}
+			
+			if (packet.len > MAX_PAYLOAD_LEN) {
+				writeMessage("Skipping packet at " + packet.timestamp + ": " + packet.len
+						+ " bytes exceed frame payload of " + MAX_PAYLOAD_LEN);
+				PacketBufferPool.getInstance().recycle(packet.data);
+				continue;
+			}
+			int dsnNode = Integer.parseInt( packet.dsnNode, 16);
+			int len = encodeFrame( frame, dsnNode, packet.timestamp, packet.data, packet.len);
+			out.write(frame, 0, len);
+			PacketBufferPool.getInstance().recycle(packet.data);
+			count++;
+		}
+		out.flush();
+		return count;
+	}
+
+	/**
+	 * create sniffed packet as sent by the DSN gateway
+	 * @param len payload length, at most MAX_PAYLOAD_LEN
+	 * @return size of frame
+	 */
+	static int encodeFrame(byte frame[], int btAddress, long timestamp, byte payload[], int len) {
+		if (len > MAX_PAYLOAD_LEN) {
+			throw new IllegalArgumentException("payload of " + len + " bytes exceeds " + MAX_PAYLOAD_LEN);
+		}
+		for (int i = 0; i < 6; i++) {
+			frame[i] = 0;
+		}
+		frame[0] = (byte) btAddress;
+		frame[1] = (byte) (btAddress >> 8);
+		frame[6] = (byte) timestamp;
+		frame[7] = (byte) (timestamp >> 8);
+		frame[8] = (byte) (timestamp >> 16);
+		frame[9] = (byte) (timestamp >> 24);
+		frame[10] = (byte) len;
+		if (len > 0) {
+			System.arraycopy(payload, 0, frame, DSNTransport.SNIFFED_PACKET_HEADER_LEN, len);
+		}
+		return DSNTransport.SNIFFED_PACKET_HEADER_LEN + len;
+	}
+
+	public static void main(String[] args) throws Exception {
+		if (args.length < 1) {
+			System.out.println("Usage: DSNReplayServer logfile [port] [speed]");
+			return;
+		}
+		int port = DEFAULT_PORT;
+		float speed = 1;
+		if (args.length > 1) {
+			port = Integer.parseInt(args[1]);
+		}
+		if (args.length > 2) {
+			speed = Float.parseFloat(args[2]);
+		}
+		new DSNReplayServer(args[0], port, speed).run();
+	}
+}
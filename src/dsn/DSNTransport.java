@@ -0,0 +1,60 @@
+package dsn;
+
+import java.io.IOException;
+
+/**
+ * Link between the host and the DSN gateway.
+ * 
+ * Every received message is one sniffed packet in the format sent by the sniffer:
+ * 6 bytes bt address, 4 bytes timestamp (little endian), 1 byte payload length, payload.
+ * Messages with an empty payload are time ticks.
+ * Sent messages are serialized sniffer configurations.
+ * 
+ * @author mringwal
+ *
+ */
+public interface DSNTransport {
+
+	/** size of the sniffed packet header (bt address, timestamp, len) */
+	static final int SNIFFED_PACKET_HEADER_LEN = 11;
+
+	/** max size of a sniffed packet including header */
+	static final int MAX_PACKET_LEN = 255;
+	
+	/**
+	 * establish link
+	 * @throws IOException
+	 */
+	void open() throws IOException;
+	
+	/**
+	 * @return true, if receive() will not block
+	 * @throws IOException
+	 */
+	boolean ready() throws IOException;
+	
+	/**
+	 * receive a single sniffed packet
+	 * @param data buffer of at least MAX_PACKET_LEN bytes
+	 * @return length of packet
+	 * @throws IOException
+	 */
+	int receive(byte data[]) throws IOException;
+
+	/**
+	 * send a configuration packet to the DSN
+	 * @param data
+	 * @throws IOException
+	 */
+	void send(byte data[]) throws IOException;
+	
+	/**
+	 * close link
+	 */
+	void close();
+	
+	/**
+	 * @return description of the remote end for user messages
+	 */
+	String getName();
+}
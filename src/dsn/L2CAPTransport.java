@@ -0,0 +1,59 @@
+package dsn;
+
+import java.io.IOException;
+
+import javax.bluetooth.L2CAPConnection;
+import javax.microedition.io.Connector;
+
+/**
+ * DSN link over a JSR-82 L2CAP connection to a BTnode gateway
+ * 
+ * @author mringwal
+ *
+ */
+public class L2CAPTransport implements DSNTransport {
+
+	private static final int SNIF_PSM = 1011;
+
+	private String btAddress;
+	
+	private L2CAPConnection con;
+	
+	public L2CAPTransport(String btAddress) {
+		this.btAddress = btAddress;
+	}
+	
+	public void open() throws IOException {
+		con = (L2CAPConnection) Connector.open("btl2cap://" + btAddress + ":" + SNIF_PSM);
+	}
+
+	public boolean ready() throws IOException {
+		return con.ready();
+	}
+
+	public int receive(byte[] data) throws IOException {
+		return con.receive(data);
+	}
+
+	public void send(byte[] data) throws IOException {
+		con.send(data);
+	}
+
+	public void close() {
+		if (con == null) return;
+		try {
+			con.close();
+		} catch (IOException e) {
+			e.printStackTrace();
+		}
+		con = null;
+	}
+
+	public String getName() {
+		return "BTnode " + btAddress;
+	}
+	
+	public L2CAPConnection getConnection() {
+		return con;
+	}
+}
@@ -1,5 +1,17 @@
 package dsn;
 
 public interface PacketListener {
-	void handlePacket( int len, byte data[]);
+	/**
+	 * Handle sniffed packet. 
+	 * 
+	 * data was acquired from the PacketBufferPool, the listener takes ownership
+	 * and is responsible to recycle it when not used anymore. The gateway must
+	 * not access data after this call. If the listener wraps data in a DecodedPacket,
+	 * ownership passes to the packet, see DecodedPacket.recycle()
+	 * 
+	 * @param gateway connection the packet was received from
+	 * @param len
+	 * @param data
+	 */
+	void handlePacket( DSNConnector gateway, int len, byte data[]);
 }
@@ -0,0 +1,43 @@
+package dsn;
+
+import java.io.BufferedInputStream;
+import java.io.BufferedOutputStream;
+import java.io.IOException;
+import java.net.Socket;
+
+/**
+ * DSN link over TCP, e.g. to a DSNReplayServer or a gateway bridge
+ * 
+ * @author mringwal
+ *
+ */
+public class SocketTransport extends StreamTransport {
+
+	private String host;
+	private int port;
+	private Socket socket;
+	
+	public SocketTransport(String host, int port) {
+		super("tcp " + host + ":" + port);
+		this.host = host;
+		this.port = port;
+	}
+	
+	public void open() throws IOException {
+		socket = new Socket(host, port);
+		socket.setTcpNoDelay(true);
+		setStreams( new BufferedInputStream( socket.getInputStream(), 65536),
+				new BufferedOutputStream( socket.getOutputStream()));
+	}
+
+	public void close() {
+		super.close();
+		if (socket == null) return;
+		try {
+			socket.close();
+		} catch (IOException e) {
+			e.printStackTrace();
+		}
+		socket = null;
+	}
+}
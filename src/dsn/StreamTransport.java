@@ -0,0 +1,103 @@
+package dsn;
+
+import java.io.DataInputStream;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+
+/**
+ * DSN link over a byte stream, e.g. a named pipe or the stdin/stdout of another process.
+ * 
+ * As a stream does not preserve message boundaries, packets are delimited by
+ * the length field of the sniffed packet header. Config packets have a fixed size
+ * and are written as is.
+ * 
+ * @author mringwal
+ *
+ */
+public class StreamTransport implements DSNTransport {
+
+	private DataInputStream in;
+	private OutputStream out;
+	private String name;
+
+	/** used by subclasses which open the streams themselves */
+	protected StreamTransport(String name) {
+		this.name = name;
+	}
+
+	public StreamTransport(InputStream in, OutputStream out, String name) {
+		this(name);
+		setStreams(in, out);
+	}
+
+	/**
+	 * Factory method for a named pipe (or plain file) containing sniffed packets
+	 * @param path
+	 */
+	public static StreamTransport createPipeTransport(final String path) {
+		return new StreamTransport("pipe " + path) {
+			public void open() throws IOException {
+				setStreams( new FileInputStream(path), null);
+			}
+		};
+	}
+
+	/**
+	 * Factory method for a pair of named pipes, the second one is used to send configurations
+	 * @param inPath
+	 * @param outPath
+	 */
+	public static StreamTransport createPipeTransport(final String inPath, final String outPath) {
+		return new StreamTransport("pipe " + inPath) {
+			public void open() throws IOException {
+				setStreams( new FileInputStream(inPath), new FileOutputStream(outPath));
+			}
+		};
+	}
+
+	protected void setStreams(InputStream in, OutputStream out) {
+		this.in = new DataInputStream(in);
+		this.out = out;
+	}
+
+	public void open() throws IOException {
+	}
+
+	public boolean ready() throws IOException {
+		return in.available() > 0;
+	}
+
+	public int receive(byte[] data) throws IOException {
+		in.readFully(data, 0, SNIFFED_PACKET_HEADER_LEN);
+		int payloadLen = data[SNIFFED_PACKET_HEADER_LEN-1] & 0xff;
+		if (SNIFFED_PACKET_HEADER_LEN + payloadLen > data.length) {
+			throw new IOException("Sniffed packet too long: " + payloadLen);
+		}
+		in.readFully(data, SNIFFED_PACKET_HEADER_LEN, payloadLen);
+		return SNIFFED_PACKET_HEADER_LEN + payloadLen;
+	}
+
+	public void send(byte[] data) throws IOException {
+		if (out == null) return;
+		out.write(data);
+		out.flush();
+	}
+
+	public void close() {
+		try {
+			if (in  != null) in.close();
+			if (out != null) out.close();
+		} catch (IOException e) {
+			e.printStackTrace();
+		}
+		in = null;
+		out = null;
+	}
+
+	public String getName() {
+		return name;
+	}
+}
@@ -0,0 +1,478 @@
+package gui;
+
+import java.awt.BasicStroke;
+import java.awt.Color;
+import java.awt.Graphics;
+import java.awt.Graphics2D;
+import java.awt.Rectangle;
+import java.awt.RenderingHints;
+import java.awt.Stroke;
+import java.awt.event.ActionEvent;
+import java.awt.event.ActionListener;
+import java.awt.event.MouseAdapter;
+import java.awt.event.MouseEvent;
+import java.awt.event.MouseMotionAdapter;
+import java.awt.event.MouseWheelEvent;
+import java.awt.event.MouseWheelListener;
+import java.util.ArrayList;
+import java.util.Collection;
+import java.util.HashMap;
+import java.util.LinkedHashSet;
+import java.util.Map;
+
+import javax.swing.JPanel;
+
+import edu.uci.ics.jung.visualization.Coordinates;
+
+/**
+ * Network view for large deployments with known node positions
+ *
+ * In contrast to the JUNG VisualizationViewer, nodes are drawn at fixed
+ * coordinates and no layout is computed.
+ * - nodes are kept in a grid to find them for hit-testing and clipping
+ * - when zoomed out, links between nodes in the same pair of grid cells are
+ *   drawn as a single line and labels are omitted
+ * - a node or link update only repaints the affected screen region
+ *
+ * Mouse: click selects a node (shift-click adds to selection), drag pans,
+ * wheel zooms
+ *
+ * @author mringwal
+ *
+ */
+public class MapPanel extends JPanel {
+
+	private static final long serialVersionUID = 0;
+
+	/** node diameter in pixel */
+	private static final int NODE_SIZE = 12;
+
+	/** size of grid cells in world coordinates */
+	private static final int CELL_SIZE = 50;
+
+	/** below this zoom level, links are aggregated and labels omitted */
+	private static final double DETAIL_ZOOM = 0.6;
+
+	/** space reserved for labels around a node */
+	private static final int LABEL_MARGIN = 40;
+
+	class Node {
+		int address;
+		double x, y;
+		Color color = Color.GRAY;
+		String metrics;
+	}
+
+	class Link {
+		Node from, to;
+		int neighbourReports;
+		int packetCount;
+	}
+
+	private HashMap<Integer, Node> nodes = new HashMap<Integer, Node>();
+	private HashMap<Long, Link> links = new HashMap<Long, Link>();
+
+	/** spatial index: nodes per grid cell */
+	private HashMap<Long, ArrayList<Node>> grid = new HashMap<Long, ArrayList<Node>>();
+
+	private LinkedHashSet<Node> selected = new LinkedHashSet<Node>();
+	private ActionListener selectionListener;
+
+	private Map<Integer, Coordinates> coordinates;
+	/** position for nodes without coordinates */
+	private double nextFreeX = 0;
+
+	private double zoom = 1.0;
+	private double offsetX = 0, offsetY = 0;
+	private int dragX, dragY;
+
+	private final Stroke thin = new BasicStroke(0);
+	private final Stroke thick = new BasicStroke(3);
+
+	public MapPanel(Map<Integer, Coordinates> coordinates) {
+		this.coordinates = coordinates;
+		setBackground(Color.WHITE);
+
+		addMouseListener(new MouseAdapter() {
+			public void mousePressed(MouseEvent e) {
+				dragX = e.getX();
+				dragY = e.getY();
+			}
+			public void mouseClicked(MouseEvent e) {
+				Node node = findNode(e.getX(), e.getY());
+				if (!e.isShiftDown()) {
+					for (Node old : selected) {
+						repaintNode(old);
+					}
+					selected.clear();
+				}
+				if (node != null) {
+					selected.add(node);
+					repaintNode(node);
+				}
+				fireSelectionChanged();
+			}
+		});
+		addMouseMotionListener(new MouseMotionAdapter() {
+			public void mouseDragged(MouseEvent e) {
+				offsetX += e.getX() - dragX;
+				offsetY += e.getY() - dragY;
+				dragX = e.getX();
+				dragY = e.getY();
+				repaint();
+			}
+		});
+		addMouseWheelListener(new MouseWheelListener() {
+			public void mouseWheelMoved(MouseWheelEvent e) {
+				double factor = e.getWheelRotation() < 0 ? 1.1 : 1 / 1.1;
+				// keep point under mouse
+				offsetX = e.getX() - (e.getX() - offsetX) * factor;
+				offsetY = e.getY() - (e.getY() - offsetY) * factor;
+				zoom *= factor;
+				repaint();
+			}
+		});
+	}
+
+	/** model updates, called on the event dispatch thread */
+
+	public void clear() {
+		nodes.clear();
+		links.clear();
+		grid.clear();
+		selected.clear();
+		nextFreeX = 0;
+		repaint();
+		fireSelectionChanged();
+	}
+
+	/**
+	 * @return true, if node was added
+	 */
+	public boolean addNode(int address) {
+		if (nodes.containsKey(address)) return false;
+		Node node = new Node();
+		node.address = address;
+		Coordinates coords = coordinates.get(address);
+		if (coords != null) {
+			node.x = coords.getX();
+			node.y = coords.getY();
+		} else {
+			// line up unknown nodes above the map
+			System.out.println("MapPanel.addNode("+address+"), but not in nodeCoordinates");
+			node.x = nextFreeX;
+			node.y = -CELL_SIZE;
+			nextFreeX += NODE_SIZE * 3;
+		}
+		nodes.put(address, node);
+		long cell = getCell(node.x, node.y);
+		ArrayList<Node> cellNodes = grid.get(cell);
+		if (cellNodes == null) {
+			cellNodes = new ArrayList<Node>();
+			grid.put(cell, cellNodes);
+		}
+		cellNodes.add(node);
+		repaintNode(node);
+		return true;
+	}
+
+	public void setNodeColor(int address, Color color) {
+		addNode(address);
+		Node node = nodes.get(address);
+		if (color.equals(node.color)) return;
+		node.color = color;
+		repaintNode(node);
+	}
+
+	public void setNodeMetrics(int address, String metrics) {
+		Node node = nodes.get(address);
+		if (node == null) return;
+		node.metrics = metrics;
+	}
+
+	/**
+	 * @return true, if link was added or removed
+	 */
+	public boolean setLinkNeighbours(int from, int to, int reports) {
+		Long key = getLinkKey(from, to);
+		Link link = links.get(key);
+		if (reports > 0) {
+			boolean added = false;
+			if (link == null) {
+				link = createLink(key, from, to);
+				added = true;
+			}
+			link.neighbourReports = reports;
+			return added;
+		}
+		if (link != null) {
+			links.remove(key);
+			repaintLink(link);
+			return true;
+		}
+		return false;
+	}
+
+	/**
+	 * @return true, if link was added
+	 */
+	public boolean setLinkData(int from, int to, int packetCount) {
+		Long key = getLinkKey(from, to);
+		Link link = links.get(key);
+		boolean added = false;
+		if (link == null) {
+			link = createLink(key, from, to);
+			added = true;
+		}
+		if (link.packetCount != packetCount) {
+			link.packetCount = packetCount;
+			repaintLink(link);
+		}
+		return added;
+	}
+
+	private Link createLink(Long key, int from, int to) {
+		addNode(from);
+		addNode(to);
+		Link link = new Link();
+		link.from = nodes.get(from);
+		link.to = nodes.get(to);
+		links.put(key, link);
+		repaintLink(link);
+		return link;
+	}
+
+	/** selection */
+
+	public void setSelectionListener(ActionListener listener) {
+		selectionListener = listener;
+	}
+
+	public void selectAll() {
+		selected.addAll(nodes.values());
+		repaint();
+		fireSelectionChanged();
+	}
+
+	/**
+	 * @return metrics of selected nodes, null entries for nodes without metrics
+	 */
+	public Collection<String> getSelectedMetrics() {
+		ArrayList<String> result = new ArrayList<String>();
+		for (Node node : selected) {
+			result.add(node.metrics);
+		}
+		return result;
+	}
+
+	private void fireSelectionChanged() {
+		if (selectionListener != null) {
+			selectionListener.actionPerformed(new ActionEvent(this, ActionEvent.ACTION_PERFORMED, "selection"));
+		}
+	}
+
+	/** spatial index */
+
+	private static long getCell(double x, double y) {
+		long cellX = (long) Math.floor(x / CELL_SIZE);
+		long cellY = (long) Math.floor(y / CELL_SIZE);
+		return (cellX << 32) | (cellY & 0xffffffffL);
+	}
+
+	private static Long getLinkKey(int from, int to) {
+		return ((long) from << 32) | (to & 0xffffffffL);
+	}
+
+	/**
+	 * @return node at screen position or null
+	 */
+	private Node findNode(int screenX, int screenY) {
+		double x = toWorldX(screenX);
+		double y = toWorldY(screenY);
+		double radius = NODE_SIZE / 2 / Math.min(zoom, 1.0);
+		Node best = null;
+		double bestDistance = radius * radius;
+		long minCellX = (long) Math.floor((x - radius) / CELL_SIZE);
+		long maxCellX = (long) Math.floor((x + radius) / CELL_SIZE);
+		long minCellY = (long) Math.floor((y - radius) / CELL_SIZE);
+		long maxCellY = (long) Math.floor((y + radius) / CELL_SIZE);
+		for (long cellX = minCellX; cellX <= maxCellX; cellX++) {
+			for (long cellY = minCellY; cellY <= maxCellY; cellY++) {
+				ArrayList<Node> cellNodes = grid.get((cellX << 32) | (cellY & 0xffffffffL));
+				if (cellNodes == null) continue;
+				for (Node node : cellNodes) {
+					double dx = node.x - x;
+					double dy = node.y - y;
+					double distance = dx * dx + dy * dy;
+					if (distance <= bestDistance) {
+						best = node;
+						bestDistance = distance;
+					}
+				}
+			}
+		}
+		return best;
+	}
+
+	/** coordinate transformation */
+
+	private int toScreenX(double x) {
+		return (int) (x * zoom + offsetX);
+	}
+
+	private int toScreenY(double y) {
+		return (int) (y * zoom + offsetY);
+	}
+
+	private double toWorldX(int x) {
+		return (x - offsetX) / zoom;
+	}
+
+	private double toWorldY(int y) {
+		return (y - offsetY) / zoom;
+	}
+
+	private boolean isDetailed() {
+		return zoom >= DETAIL_ZOOM;
+	}
+
+	/** dirty regions */
+
+	private void repaintNode(Node node) {
+		int margin = isDetailed() ? LABEL_MARGIN : NODE_SIZE;
+		repaint(toScreenX(node.x) - margin, toScreenY(node.y) - margin, 2 * margin, 2 * margin);
+	}
+
+	private void repaintLink(Link link) {
+		double fromX = link.from.x, fromY = link.from.y, toX = link.to.x, toY = link.to.y;
+		if (!isDetailed()) {
+			// aggregated line between cell centers
+			fromX = getCellCenter(fromX);
+			fromY = getCellCenter(fromY);
+			toX = getCellCenter(toX);
+			toY = getCellCenter(toY);
+		}
+		int x1 = toScreenX(Math.min(fromX, toX));
+		int y1 = toScreenY(Math.min(fromY, toY));
+		int x2 = toScreenX(Math.max(fromX, toX));
+		int y2 = toScreenY(Math.max(fromY, toY));
+		int margin = isDetailed() ? LABEL_MARGIN : NODE_SIZE;
+		repaint(x1 - margin, y1 - margin, x2 - x1 + 2 * margin, y2 - y1 + 2 * margin);
+	}
+
+	private static double getCellCenter(double value) {
+		return (Math.floor(value / CELL_SIZE) + 0.5) * CELL_SIZE;
+	}
+
+	/** rendering */
+
+	protected void paintComponent(Graphics graphics) {
+		super.paintComponent(graphics);
+		Graphics2D g2 = (Graphics2D) graphics;
+		Rectangle clip = g2.getClipBounds();
+		if (clip == null) {
+			clip = new Rectangle(0, 0, getWidth(), getHeight());
+		}
+		if (isDetailed()) {
+			g2.setRenderingHint(RenderingHints.KEY_ANTIALIASING, RenderingHints.VALUE_ANTIALIAS_ON);
+			paintLinks(g2, clip);
+		} else {
+			paintAggregatedLinks(g2, clip);
+		}
+		paintNodes(g2, clip);
+	}
+
+	private void paintLinks(Graphics2D g2, Rectangle clip) {
+		for (Link link : links.values()) {
+			int x1 = toScreenX(link.from.x);
+			int y1 = toScreenY(link.from.y);
+			int x2 = toScreenX(link.to.x);
+			int y2 = toScreenY(link.to.y);
+			if (!clip.intersectsLine(x1, y1, x2, y2)) continue;
+			if (link.packetCount == 0) {
+				g2.setStroke(thin);
+				g2.setColor(Color.BLACK);
+			} else {
+				g2.setStroke(thick);
+				g2.setColor(Color.BLUE);
+			}
+			g2.drawLine(x1, y1, x2, y2);
+			if (link.packetCount != 0) {
+				g2.drawString("" + link.packetCount, (x1 + x2) / 2, (y1 + y2) / 2);
+			}
+		}
+		g2.setStroke(thin);
+	}
+
+	private void paintAggregatedLinks(Graphics2D g2, Rectangle clip) {
+		// sum up packets per pair of cells
+		HashMap<String, int[]> cellLinks = new HashMap<String, int[]>();
+		for (Link link : links.values()) {
+			int x1 = toScreenX(getCellCenter(link.from.x));
+			int y1 = toScreenY(getCellCenter(link.from.y));
+			int x2 = toScreenX(getCellCenter(link.to.x));
+			int y2 = toScreenY(getCellCenter(link.to.y));
+			if (x1 == x2 && y1 == y2) continue;
+			String key = "" + x1 + "," + y1 + "#" + x2 + "," + y2;
+			int aggregate[] = cellLinks.get(key);
+			if (aggregate == null) {
+				aggregate = new int[] { x1, y1, x2, y2, 0 };
+				cellLinks.put(key, aggregate);
+			}
+			aggregate[4] += link.packetCount;
+		}
+		for (int aggregate[] : cellLinks.values()) {
+			if (!clip.intersectsLine(aggregate[0], aggregate[1], aggregate[2], aggregate[3])) continue;
+			if (aggregate[4] == 0) {
+				g2.setStroke(thin);
+				g2.setColor(Color.LIGHT_GRAY);
+			} else {
+				g2.setStroke(thick);
+				g2.setColor(Color.BLUE);
+			}
+			g2.drawLine(aggregate[0], aggregate[1], aggregate[2], aggregate[3]);
+		}
+		g2.setStroke(thin);
+	}
+
+	private void paintNodes(Graphics2D g2, Rectangle clip) {
+		boolean detailed = isDetailed();
+		int size = detailed ? NODE_SIZE : NODE_SIZE / 2;
+		int margin = detailed ? LABEL_MARGIN : size;
+		// visit grid cells overlapping the clip only
+		long minCellX = (long) Math.floor(toWorldX(clip.x - margin) / CELL_SIZE);
+		long maxCellX = (long) Math.floor(toWorldX(clip.x + clip.width + margin) / CELL_SIZE);
+		long minCellY = (long) Math.floor(toWorldY(clip.y - margin) / CELL_SIZE);
+		long maxCellY = (long) Math.floor(toWorldY(clip.y + clip.height + margin) / CELL_SIZE);
+		if ((maxCellX - minCellX) * (maxCellY - minCellY) > grid.size()) {
+			// more cells than used ones, visit used ones
+			for (ArrayList<Node> cellNodes : grid.values()) {
+				paintNodes(g2, cellNodes, size, detailed);
+			}
+			return;
+		}
+		for (long cellX = minCellX; cellX <= maxCellX; cellX++) {
+			for (long cellY = minCellY; cellY <= maxCellY; cellY++) {
+				ArrayList<Node> cellNodes = grid.get((cellX << 32) | (cellY & 0xffffffffL));
+				if (cellNodes != null) {
+					paintNodes(g2, cellNodes, size, detailed);
+				}
+			}
+		}
+	}
+
+	private void paintNodes(Graphics2D g2, ArrayList<Node> cellNodes, int size, boolean detailed) {
+		for (Node node : cellNodes) {
+			int x = toScreenX(node.x) - size / 2;
+			int y = toScreenY(node.y) - size / 2;
+			g2.setColor(node.color);
+			g2.fillOval(x, y, size, size);
+			g2.setColor(selected.contains(node) ? Color.YELLOW : Color.BLACK);
+			g2.drawOval(x, y, size, size);
+			if (detailed) {
+				g2.setColor(Color.BLACK);
+				g2.drawString("" + node.address, x + size, y);
+			}
+		}
+	}
+}
@@ -12,4 +12,8 @@ public abstract class SNIFController {
 	protected boolean useDSN = false;
 	protected Object start = null;
 	protected String PACKET_INPUT = null;
+	/** start time in log in ms, -1 = from beginning */
+	protected long START_TIME = -1;
+	/** directory of TimeSeriesStore with metrics of current run, if any */
+	protected String HISTORY_DIR = null;
 }
@@ -17,6 +17,7 @@ import java.awt.event.KeyAdapter;
 import java.awt.event.KeyEvent;
 import java.io.File;
 import java.io.FilenameFilter;
+import java.io.IOException;
 import java.util.ConcurrentModificationException;
 import java.util.HashMap;
 import java.util.Hashtable;
@@ -34,10 +35,16 @@ import javax.swing.JSlider;
 import javax.swing.JSplitPane;
 import javax.swing.JTextArea;
 import javax.swing.KeyStroke;
+import javax.swing.SwingUtilities;
+import javax.swing.Timer;
 import javax.swing.event.ChangeEvent;
 import javax.swing.event.ChangeListener;
 
 import stream.Scheduler;
+import stream.Sink;
+import stream.tuple.TimeSeriesStore;
+import stream.tuple.Tuple;
+import util.TimeIndex;
 import edu.uci.ics.jung.graph.ArchetypeEdge;
 import edu.uci.ics.jung.graph.ArchetypeVertex;
 import edu.uci.ics.jung.graph.Edge;
@@ -66,6 +73,13 @@ import edu.uci.ics.jung.visualization.control.ModalGraphMouse;
 
 public class View extends JFrame implements ActionListener, ChangeListener {
 
+	/** graph updates are applied and rendered at this rate */
+	private static final int FRAME_RATE = 10;
+
+	/** latest state reported by analysis thread */
+	private ViewModel model = new ViewModel();
+	private Timer frameTimer;
+
 	private boolean haveCoordinates = false;
 	private HashMap<Integer, Coordinates> nodeCoordinates = null;
 
@@ -75,6 +89,8 @@ public class View extends JFrame implements ActionListener, ChangeListener {
 	private SNIFController controller;
 	
 	private VisualizationViewer vv;
+	/** used instead of vv for large networks with known node positions */
+	private MapPanel mapPanel;
 	private AbstractLayout layout;
 	private String oldDescription, oldMetrics, oldTime;
 	
@@ -151,101 +167,36 @@ public class View extends JFrame implements ActionListener, ChangeListener {
     }
     
     public void reset() {
+    	model.clear();
     	g.removeAllVertices();
     	g.removeAllEdges();
         linkNeigbours = new HashMap<String,Integer>();
     	linkData = new HashMap<String,Integer>();
      	speedSlider.setValue(1);
 //      	layout.update();
-    	vv.repaint();
+    	if (mapPanel != null) {
+    		mapPanel.clear();
+    	} else {
+    		vv.repaint();
+    	}
     }
     
     public void establish() {
     	setDefaultCloseOperation(EXIT_ON_CLOSE);
 	    setPreferredSize(new Dimension(1000, 700));
-	    layout = new FRLayout(g);
-	    PluggableRenderer pr = new PluggableRenderer();
-	    // scaler = new CrossoverScalingControl();
-	    pr.setEdgeShapeFunction(new EdgeShape.QuadCurve());
-	    DefaultModalGraphMouse graphMouse = new DefaultModalGraphMouse();
-	    graphMouse.setMode(ModalGraphMouse.Mode.PICKING);
-	    vv = new VisualizationViewer(layout, pr);
-	    vv.getModel().setRelaxerThreadSleepTime(500);
-	    vv.setPickSupport(new ShapePickSupport());
-	    vv.setGraphMouse(graphMouse);
-        vv.setBackground(Color.WHITE);
-        vv.getPickedState().addItemListener(new ItemListener() {
-	    	public void itemStateChanged(ItemEvent e) {
-	    		updateMetrics();
-	    	}
-	    });
-        getContentPane().add(vv, BorderLayout.CENTER);
-	   
-        GraphZoomScrollPane zoom = new GraphZoomScrollPane(vv);
-        getContentPane().add(zoom, BorderLayout.CENTER);
-	               
-        // label vertices
-        pr.setVertexStringer(new VertexStringer() {
-            public String getLabel(ArchetypeVertex v) {
-            	if (showVertexLabels) {
-        			return v.getUserDatum(vertexKey).toString();
-        		}
-        		else {
-        			return "";
-        		}
-            }
-        });
-        // color vertices according to their state
-        pr.setVertexPaintFunction(new VertexPaintFunction() {
-        	public Paint getFillPaint(Vertex v) {
-        		Color c = (Color) v.getUserDatum(statusKey);
-        		return c;
-        	}
-        	public Paint getDrawPaint(Vertex v) {
-        		return Color.BLACK;
-        	}
-        });        
-                        
-        // label edges
-        pr.setEdgeStringer(new EdgeStringer() {
-            public String getLabel(ArchetypeEdge e) {
-            	Integer packetCount = (Integer) e.getUserDatum(packetCountKey);
-            	if (showEdgeLabels && packetCount != 0) {
-        			return e.getUserDatum(packetCountKey).toString();
-        		}
-        		else {
-        			return "";
-        		}
-            }
-        });
-        
-        // adapt thickness of edges according to their packetCount
-        pr.setEdgeStrokeFunction(new EdgeStrokeFunction() {
-            protected final Stroke thin = new BasicStroke(0);
-            protected final Stroke thick = new BasicStroke(3);
-            public Stroke getStroke(Edge e) {
-                int pc = (Integer) e.getUserDatum(packetCountKey);
-                if (pc == 0)
-                    return thin;
-                else 
-                    return thick;
-            }
-        });
-        
-        pr.setEdgePaintFunction( new EdgePaintFunction() {
-			public Paint getDrawPaint(Edge e) {
-				int pc = (Integer) e.getUserDatum(packetCountKey);
-				if (pc == 0)
-					return Color.black;
-				else 
-					return Color.blue;
-			}
+	    if (haveCoordinates) {
+	    	// fixed node positions, no layout needed
+	    	mapPanel = new MapPanel(nodeCoordinates);
+	    	mapPanel.setSelectionListener(new ActionListener() {
+	    		public void actionPerformed(ActionEvent e) {
+	    			updateMetrics();
+	    		}
+	    	});
+	    	getContentPane().add(mapPanel, BorderLayout.CENTER);
+	    } else {
+	    	establishGraphView();
+	    }
 
-			public Paint getFillPaint(Edge e) {
-				return EdgePaintFunction.TRANSPARENT;
-			}
-        });
-        
         connect = new JButton("Connect");
 		connect.addActionListener(this);
         
@@ -257,6 +208,7 @@ public class View extends JFrame implements ActionListener, ChangeListener {
         stop.setEnabled(false);
 
         JButton reorder = new JButton("Reorder");
+        reorder.setEnabled(mapPanel == null);
         reorder.addActionListener(new ActionListener() {
         	public void actionPerformed(ActionEvent e) {
         		layout = new FRLayout(g);
@@ -317,10 +269,18 @@ public class View extends JFrame implements ActionListener, ChangeListener {
         wPanel.setBorder(BorderFactory.createTitledBorder("Window W"));
         wPanel.add(wArea);
 
-        JPanel runPanel = new JPanel(new GridLayout(2,1));
+        JButton history = new JButton("History");
+        history.addActionListener(new ActionListener() {
+        	public void actionPerformed(ActionEvent e) {
+        		handleHistory();
+        	}
+        });
+
+        JPanel runPanel = new JPanel(new GridLayout(3,1));
         runPanel.setBorder(BorderFactory.createTitledBorder("Run"));
         runPanel.add(stop);
         runPanel.add(reorder);
+        runPanel.add(history);
        
         JPanel speedPanel = new JPanel(new GridLayout(1,1));
         speedPanel.setBorder(BorderFactory.createTitledBorder("Time Factor"));
@@ -352,12 +312,25 @@ public class View extends JFrame implements ActionListener, ChangeListener {
         show.add(showMetricsPanel);
         getContentPane().add(controls, BorderLayout.SOUTH);
         getContentPane().add(show, BorderLayout.EAST);
+
+        // render snapshot of view model at fixed frame rate
+        frameTimer = new Timer(1000 / FRAME_RATE, new ActionListener() {
+        	public void actionPerformed(ActionEvent e) {
+        		// map panel repaints changed regions itself
+        		if (model.applyTo(View.this) && vv != null) {
+        			vv.repaint();
+        		}
+        	}
+        });
+        frameTimer.start();
         
         addKeyListener(new KeyAdapter() {
 			public void keyPressed(KeyEvent event) {
 				KeyStroke k = KeyStroke.getKeyStroke(event.getKeyCode(), event.getModifiers());
 				KeyStroke ctrlA = KeyStroke.getKeyStroke(KeyEvent.VK_A, KeyEvent.CTRL_MASK);
-				if (k == ctrlA) {
+				if (k == ctrlA && mapPanel != null) {
+					mapPanel.selectAll();
+				} else if (k == ctrlA) {
 					try {
 						PickedState pickedState = vv.getPickedState();
 						Iterator it = g.getVertices().iterator();
@@ -377,10 +350,108 @@ public class View extends JFrame implements ActionListener, ChangeListener {
 		requestFocusInWindow();
     }
     
+    /**
+     * JUNG graph view with force directed layout, used if no node coordinates are known
+     */
+    private void establishGraphView() {
+	    layout = new FRLayout(g);
+	    PluggableRenderer pr = new PluggableRenderer();
+	    // scaler = new CrossoverScalingControl();
+	    pr.setEdgeShapeFunction(new EdgeShape.QuadCurve());
+	    DefaultModalGraphMouse graphMouse = new DefaultModalGraphMouse();
+	    graphMouse.setMode(ModalGraphMouse.Mode.PICKING);
+	    vv = new VisualizationViewer(layout, pr);
+	    vv.getModel().setRelaxerThreadSleepTime(500);
+	    vv.setPickSupport(new ShapePickSupport());
+	    vv.setGraphMouse(graphMouse);
+        vv.setBackground(Color.WHITE);
+        vv.getPickedState().addItemListener(new ItemListener() {
+	    	public void itemStateChanged(ItemEvent e) {
+	    		updateMetrics();
+	    	}
+	    });
+        getContentPane().add(vv, BorderLayout.CENTER);
+	   
+        GraphZoomScrollPane zoom = new GraphZoomScrollPane(vv);
+        getContentPane().add(zoom, BorderLayout.CENTER);
+	               
+        // label vertices
+        pr.setVertexStringer(new VertexStringer() {
+            public String getLabel(ArchetypeVertex v) {
+            	if (showVertexLabels) {
+        			return v.getUserDatum(vertexKey).toString();
+        		}
+        		else {
+        			return "";
+        		}
+            }
+        });
+        // color vertices according to their state
+        pr.setVertexPaintFunction(new VertexPaintFunction() {
+        	public Paint getFillPaint(Vertex v) {
+        		Color c = (Color) v.getUserDatum(statusKey);
+        		return c;
+        	}
+        	public Paint getDrawPaint(Vertex v) {
+        		return Color.BLACK;
+        	}
+        });        
+                        
+        // label edges
+        pr.setEdgeStringer(new EdgeStringer() {
+            public String getLabel(ArchetypeEdge e) {
+            	Integer packetCount = (Integer) e.getUserDatum(packetCountKey);
+            	if (showEdgeLabels && packetCount != 0) {
+        			return e.getUserDatum(packetCountKey).toString();
+        		}
+        		else {
+        			return "";
+        		}
+            }
+        });
+        
+        // adapt thickness of edges according to their packetCount
+        pr.setEdgeStrokeFunction(new EdgeStrokeFunction() {
+            protected final Stroke thin = new BasicStroke(0);
+            protected final Stroke thick = new BasicStroke(3);
+            public Stroke getStroke(Edge e) {
+                int pc = (Integer) e.getUserDatum(packetCountKey);
+                if (pc == 0)
+                    return thin;
+                else 
+                    return thick;
+            }
+        });
+        
+        pr.setEdgePaintFunction( new EdgePaintFunction() {
+			public Paint getDrawPaint(Edge e) {
+				int pc = (Integer) e.getUserDatum(packetCountKey);
+				if (pc == 0)
+					return Color.black;
+				else 
+					return Color.blue;
+			}
+
+			public Paint getFillPaint(Edge e) {
+				return EdgePaintFunction.TRANSPARENT;
+			}
+        });
+    }
+
 	public void updateMetrics() {
     	description = "";
     	metrics = "";
-    	try {
+    	if (mapPanel != null) {
+    		for (String m : mapPanel.getSelectedMetrics()) {
+				if (m != null) {
+		    		description += d + "\n\n";
+		    		metrics     += m + "\n\n";
+				} else {
+					description +=  "none\n";
+					metrics     +=  "none\n";
+				}
+    		}
+    	} else try {
 	    	Iterator it = vv.getPickedState().getPickedVertices().iterator();
 	    	while (it.hasNext()) {
 				Vertex vertex = (Vertex) it.next();
@@ -412,8 +483,11 @@ public class View extends JFrame implements ActionListener, ChangeListener {
     }
     
     public void writeMessage(String s) {
+    	model.writeMessage(s);
+	}
+
+    void applyMessage(String s) {
     	textArea.setText(s);
-		textArea.update(textArea.getGraphics());
 	}
     
     
@@ -445,31 +519,49 @@ public class View extends JFrame implements ActionListener, ChangeListener {
     }
  
     
-    /** interface used by data stream graph */
+    /** interface used by data stream graph 
+     * 
+     * called from the analysis thread. updates are stored in the ViewModel 
+     * and applied by the event dispatch thread
+     */
 
     /** 
      * set virtual time 
      **/
     public void setTime(String time) {
+    	model.setTime(time);
+    }
+    
+    void applyTime(String time) {
     	if (!time.equals(oldTime)) {
 	    	timeArea.setText(time);
-			timeArea.update(timeArea.getGraphics()); 
 			oldTime = time;
     	}
     }
     
-    
-    
     /**
      * evidence that a node exists was gathered is directly or indirectly
      * a packet was sent by this node
      * a packet was sent to this node
      * a packet lists this node */
     public  void nodeSeen( int address) {
+    	if (address == 65535) return;
+    	if (address == 65536) return;
+    	model.nodeSeen(address);
+    }
+    
+    void applyNodeSeen( int address) {
     	String addr = "" + address;
     	if (address == 65535) return;
     	if (address == 65536) return;
     	
+    	if (mapPanel != null) {
+    		if (mapPanel.addNode(address)) {
+    			applyMessage("Node "+addr+" added");
+    		}
+    		return;
+    	}
+    	
     	// add node. node's won't disappear
     	Vertex node = getNodeVertex( addr);
     	if (node == null) {
@@ -478,19 +570,8 @@ public class View extends JFrame implements ActionListener, ChangeListener {
     	   	node.addUserDatum(vertexKey, addr, UserData.CLONE);
 	    	node.addUserDatum(statusKey, Color.GRAY, UserData.CLONE);
 	    	g.addVertex(node);
-	    	if (haveCoordinates){
-		    	Object coordKey = layout.getBaseKey();
-				Coordinates coords = nodeCoordinates.get( address );
-	    		if (coords != null) {
-					layout.lockVertex(node);
-		    		node.addUserDatum( coordKey, coords, UserData.SHARED);
-	    		} else {
-	    			System.out.println("View.nodeSeen("+address+"), but not in nodeCoordinates");
-	    		}
-	    	}
 	    	((FRLayout) layout).update();
-	    	vv.repaint();
-        	writeMessage("Node "+addr+" added");
+        	applyMessage("Node "+addr+" added");
     	}
     }
 
@@ -500,15 +581,22 @@ public class View extends JFrame implements ActionListener, ChangeListener {
      * @param args
      */
     public void setNodeState( int address, Color color ) {
+    	model.setNodeState(address, color);
+    }
+
+    void applyNodeState( int address, Color color ) {
     	// add node. nodes won't disappear
     	String addr = "" + address;
+    	if (mapPanel != null) {
+    		mapPanel.setNodeColor(address, color);
+    		return;
+    	}
     	// check that node exists
-    	nodeSeen( address );
+    	applyNodeSeen( address );
     	Vertex node = getNodeVertex( addr);
     	if (node != null) {
     		node.setUserDatum(statusKey, color, UserData.CLONE);
-        	vv.repaint();
-        	writeMessage("Node "+addr+" state changed");
+        	applyMessage("Node "+addr+" state changed");
     	}
     }
     
@@ -520,6 +608,17 @@ public class View extends JFrame implements ActionListener, ChangeListener {
      */
 
     public void setLinkNeigbours(int from, int to, int reports) {
+    	model.setLinkNeigbours(from, to, reports);
+    }
+
+    void applyLinkNeigbours(int from, int to, int reports) {
+    	if (mapPanel != null) {
+    		if (mapPanel.setLinkNeighbours(from, to, reports)) {
+    			applyMessage(reports > 0 ? "Node "+from+" lists new neighbor "+to :
+    				"Node "+to+" vanishes from node "+from+"'s neighbor list");
+    		}
+    		return;
+    	}
 		// String otherDirection = "" + to + "#" + from;
 		// linkNeigbours.put( otherDirection, reports );
 
@@ -528,8 +627,8 @@ public class View extends JFrame implements ActionListener, ChangeListener {
 		if (reports > 0) {
 			// assert link exists
 			if (link == null) {
-				nodeSeen( from );
-				nodeSeen( to );
+				applyNodeSeen( from );
+				applyNodeSeen( to );
 				Vertex fromV = getNodeVertex( ""+from);
 				Vertex toV = getNodeVertex( ""+to);
 		    	link = new DirectedSparseEdge(fromV, toV);
@@ -541,12 +640,12 @@ public class View extends JFrame implements ActionListener, ChangeListener {
 		    	link.addUserDatum(neighboutSeenKey, reports, UserData.SHARED);
 		    	// finally put it on the hashtable
 		    	g.addEdge(link);
-	        	writeMessage("Node "+from+" lists new neighbor "+to);
+	        	applyMessage("Node "+from+" lists new neighbor "+to);
 			}
 		} else {
 			// assert link is removed
 			if (link != null) {
-	        	writeMessage("Node "+to+" vanishes from node "+from+"'s neighbor list");
+	        	applyMessage("Node "+to+" vanishes from node "+from+"'s neighbor list");
 				g.removeEdge(link);
 			}
 				
@@ -561,6 +660,16 @@ public class View extends JFrame implements ActionListener, ChangeListener {
      */
 
   public void setLinkData(int from, int to, int reports) {
+	  model.setLinkData(from, to, reports);
+  }
+
+  void applyLinkData(int from, int to, int reports) {
+	  	if (mapPanel != null) {
+	  		if (mapPanel.setLinkData(from, to, reports)) {
+	  			applyMessage("Node "+from+" sends first data to "+to);
+	  		}
+	  		return;
+	  	}
 		// String otherDirection = "" + to + "#" + from;
 		// linkData.put( otherDirection, reports );
 
@@ -569,8 +678,8 @@ public class View extends JFrame implements ActionListener, ChangeListener {
 
 		// assert link exists
 		if (link == null) {
-			nodeSeen( from );
-			nodeSeen( to );
+			applyNodeSeen( from );
+			applyNodeSeen( to );
 			Vertex fromV = getNodeVertex( ""+from);
 			Vertex toV = getNodeVertex( ""+to);
 			link = new DirectedSparseEdge(fromV, toV);
@@ -578,11 +687,10 @@ public class View extends JFrame implements ActionListener, ChangeListener {
 			link.addUserDatum(edgeKey, edgeName, UserData.SHARED);
 			// finally put it on the hashtable
 			g.addEdge(link);
-			writeMessage("Node "+from+" sends first data to "+to);
+			applyMessage("Node "+from+" sends first data to "+to);
 		}
 		link.setUserDatum( packetCountKey, reports, UserData.SHARED);
 //		layout.update();
-    	vv.repaint();
   }
 
   	
@@ -591,12 +699,19 @@ public class View extends JFrame implements ActionListener, ChangeListener {
      * @param args
      */
     public void setNodeMetrics( int address, String metricInfo) {
+    	model.setNodeMetrics(address, metricInfo);
+    }
+
+    void applyNodeMetrics( int address, String metricInfo) {
+    	if (mapPanel != null) {
+    		mapPanel.setNodeMetrics(address, metricInfo);
+    		return;
+    	}
       	String addr = "" + address;
     	Vertex node = getNodeVertex( addr);
     	if (node != null) {
     		node.setUserDatum(metricsKey, metricInfo, UserData.SHARED);
     	}
-    	updateMetrics();
     }
 
 	public void actionPerformed(ActionEvent arg0) {
@@ -621,7 +736,7 @@ public class View extends JFrame implements ActionListener, ChangeListener {
 		fd.setDirectory( new File(".").getAbsolutePath());
 		fd.setFilenameFilter(new FilenameFilter() {
 			public boolean accept(File dir, String name) {
-				return name.startsWith("log_");
+				return name.startsWith("log_") && !name.endsWith(TimeIndex.SUFFIX);
 			}
 		});
 		fd.setVisible(true);
@@ -630,6 +745,15 @@ public class View extends JFrame implements ActionListener, ChangeListener {
 			open.setEnabled(false);
 			reset();
 			controller.PACKET_INPUT = fd.getDirectory()+File.separator+fd.getFile();
+			controller.START_TIME = -1;
+			String start = JOptionPane.showInputDialog(this, "Start time (s), empty = from beginning", "Open", JOptionPane.PLAIN_MESSAGE);
+			if (start != null && start.trim().length() > 0) {
+				try {
+					controller.START_TIME = Long.parseLong(start.trim()) * 1000;
+				} catch (NumberFormatException e) {
+					writeMessage("Invalid start time " + start);
+				}
+			}
 			synchronized(controller.start) {
 				controller.start.notify();
 			}
@@ -638,6 +762,61 @@ public class View extends JFrame implements ActionListener, ChangeListener {
 		}
 	}
 
+	/**
+	 * show stored metrics of one node without replaying the packets
+	 */
+	private void handleHistory() {
+		if (controller.HISTORY_DIR == null) {
+			JOptionPane.showMessageDialog(this, "No metric history available", "History", JOptionPane.PLAIN_MESSAGE);
+			return;
+		}
+		String input = JOptionPane.showInputDialog(this, "NodeID [from to] (s)", "History", JOptionPane.PLAIN_MESSAGE);
+		if (input == null) return;
+		String args[] = input.trim().split("\\s+");
+		final int nodeID;
+		final long from;
+		final long to;
+		try {
+			nodeID = Integer.parseInt(args[0]);
+			if (args.length >= 3) {
+				from = Long.parseLong(args[1]) * 1000;
+				to   = Long.parseLong(args[2]) * 1000;
+			} else {
+				from = 0;
+				to   = Long.MAX_VALUE;
+			}
+		} catch (NumberFormatException e) {
+			writeMessage("History: invalid input " + input);
+			return;
+		}
+		final TimeSeriesStore store = new TimeSeriesStore(new File(controller.HISTORY_DIR));
+		// read in background, the store may be large
+		new Thread() {
+			public void run() {
+				final StringBuffer result = new StringBuffer();
+				for (final String type : store.getTupleTypes()) {
+					try {
+						// node ids are shown + 1
+						store.query(type, from, to, "nodeID", nodeID - 1, new Sink<Tuple>() {
+							public void process(Tuple o, int srcID, long timestamp) {
+								result.append("" + timestamp / 1000 + " s " + type + o + "\n");
+							}
+						});
+					} catch (IOException e) {
+						e.printStackTrace();
+					}
+				}
+				SwingUtilities.invokeLater(new Runnable() {
+					public void run() {
+						JTextArea text = new JTextArea(result.toString(), 25, 80);
+						text.setEditable(false);
+						JOptionPane.showMessageDialog(View.this, new JScrollPane(text), "History of node " + nodeID, JOptionPane.PLAIN_MESSAGE);
+					}
+				});
+			}
+		}.start();
+	}
+
 	/**
 	 * 
 	 */
@@ -0,0 +1,141 @@
+package gui;
+
+import java.awt.Color;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.atomic.AtomicReference;
+
+/**
+ * Latest node and link state reported by the analysis graph
+ *
+ * The analysis thread writes into the model without locking the GUI. Updates
+ * for the same node or link are coalesced, only the latest value is kept.
+ * The event dispatch thread takes a snapshot of all pending updates at a fixed
+ * frame rate, applies it to the View and repaints once per frame.
+ *
+ * @author mringwal
+ *
+ */
+public class ViewModel {
+
+	/** nodes seen in order of appearance */
+	private ConcurrentLinkedQueue<Integer> nodesSeen = new ConcurrentLinkedQueue<Integer>();
+	private ConcurrentHashMap<Integer, Boolean> nodesKnown = new ConcurrentHashMap<Integer, Boolean>();
+
+	private ConcurrentHashMap<Integer, Color> nodeStates = new ConcurrentHashMap<Integer, Color>();
+	private ConcurrentHashMap<Integer, String> nodeMetrics = new ConcurrentHashMap<Integer, String>();
+
+	/** link updates by from << 16 | to */
+	private ConcurrentHashMap<Integer, int[]> linkNeighbours = new ConcurrentHashMap<Integer, int[]>();
+	private ConcurrentHashMap<Integer, int[]> linkData = new ConcurrentHashMap<Integer, int[]>();
+
+	private volatile String time = null;
+	private AtomicReference<String> message = new AtomicReference<String>();
+
+	/** writers (analysis thread) */
+
+	public void nodeSeen(int address) {
+		if (nodesKnown.putIfAbsent(address, Boolean.TRUE) == null) {
+			nodesSeen.add(address);
+		}
+	}
+
+	public void setNodeState(int address, Color color) {
+		nodeSeen(address);
+		nodeStates.put(address, color);
+	}
+
+	public void setNodeMetrics(int address, String metricInfo) {
+		nodeMetrics.put(address, metricInfo);
+	}
+
+	public void setLinkNeigbours(int from, int to, int reports) {
+		linkNeighbours.put((from << 16) | to, new int[] { from, to, reports });
+	}
+
+	public void setLinkData(int from, int to, int reports) {
+		linkData.put((from << 16) | to, new int[] { from, to, reports });
+	}
+
+	public void setTime(String time) {
+		this.time = time;
+	}
+
+	public void writeMessage(String message) {
+		this.message.set(message);
+	}
+
+	/**
+	 * drop all state, e.g. when a new run is started
+	 */
+	public void clear() {
+		nodesSeen.clear();
+		nodesKnown.clear();
+		nodeStates.clear();
+		nodeMetrics.clear();
+		linkNeighbours.clear();
+		linkData.clear();
+		time = null;
+		message.set(null);
+	}
+
+	/** reader (event dispatch thread) */
+
+	/**
+	 * apply pending updates to view
+	 * @param view
+	 * @return true, if the graph has to be repainted
+	 */
+	boolean applyTo(View view) {
+		boolean changed = false;
+
+		// nodes first, links refer to them
+		Integer address;
+		while ((address = nodesSeen.poll()) != null) {
+			view.applyNodeSeen(address);
+			changed = true;
+		}
+		for (Integer node : nodeStates.keySet()) {
+			Color color = nodeStates.remove(node);
+			if (color != null) {
+				view.applyNodeState(node, color);
+				changed = true;
+			}
+		}
+		for (Integer link : linkNeighbours.keySet()) {
+			int update[] = linkNeighbours.remove(link);
+			if (update != null) {
+				view.applyLinkNeigbours(update[0], update[1], update[2]);
+				changed = true;
+			}
+		}
+		for (Integer link : linkData.keySet()) {
+			int update[] = linkData.remove(link);
+			if (update != null) {
+				view.applyLinkData(update[0], update[1], update[2]);
+				changed = true;
+			}
+		}
+		boolean metricsChanged = false;
+		for (Integer node : nodeMetrics.keySet()) {
+			String metricInfo = nodeMetrics.remove(node);
+			if (metricInfo != null) {
+				view.applyNodeMetrics(node, metricInfo);
+				metricsChanged = true;
+			}
+		}
+		if (metricsChanged) {
+			view.updateMetrics();
+		}
+
+		String currentTime = time;
+		if (currentTime != null) {
+			view.applyTime(currentTime);
+		}
+		String currentMessage = message.getAndSet(null);
+		if (currentMessage != null) {
+			view.applyMessage(currentMessage);
+		}
+		return changed;
+	}
+}
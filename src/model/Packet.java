@@ -80,10 +80,13 @@ public class Packet implements Comparable,  ITimeStampedObject {
 	
 	/** 
 	 * Compute hashCode of packet according to the contract: equals => hashCode 
-	 * TODO data.hashCode does not return the same value for two arrays with identical content
 	 */
 	public int hashCode() {
-		return src.hashCode() ^ dst.hashCode() ^ data_len ^ type ^ group ^ data.hashCode();
+		int hash = src.toLowerCase().hashCode() ^ dst.toLowerCase().hashCode() ^ data_len ^ type ^ group;
+		for (int i=0; i < data_len; i++) {
+			hash = 31 * hash + data[i];
+		}
+		return hash;
 	}
 	
 	/**
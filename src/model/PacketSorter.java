@@ -11,6 +11,7 @@ import java.util.Date;
 import java.util.regex.Matcher;
 import java.util.regex.Pattern;
 
+import util.ClockSkewEstimator;
 import util.LinkDumpParser;
 
 /**
@@ -20,6 +21,9 @@ import util.LinkDumpParser;
  * 
  * It also uses the time of the very first packet to establish a reference time base
  * 
+ * Optionally, timestamps of each log are corrected for offset and drift of the DSN node clock,
+ * estimated from packets recorded in several logs, see setClockCorrection().
+ * 
  * @author mringwal
  *
  */
@@ -40,7 +44,7 @@ public class PacketSorter {
 		// get first packet of each parser
 		int i;
 		for (i = 0; i < parsers.size(); i++) {
-			packets[i] = parsers.get(i).readPacket();
+			packets[i] = readPacket(i);
 		}
 		// set time reference
 		time_base = getTimeBaseFromSARS(path);
@@ -140,11 +144,27 @@ public class PacketSorter {
 			return null;
 		// refer to found packet
 		Packet packet = packets[minIndex];
-		packets[minIndex] = parsers.get(minIndex).readPacket();
+		packets[minIndex] = readPacket(minIndex);
 		// update packet clock
 		return packet;
 	}
 
+	/**
+	 * Continue with the first packets at or after time - warmup in all logs.
+	 * The warm-up packets allow windows and duplicate filters to reach their normal state at time.
+	 * 
+	 * @param time relative to time base in ms
+	 * @param warmup in ms
+	 * @throws Exception
+	 */
+	public void seek(long time, long warmup) throws Exception {
+		for (int i = 0; i < parsers.size(); i++) {
+			parsers.get(i).seek(time_base + time - warmup);
+			packets[i] = readPacket(i);
+			lastPackets[i] = null;
+		}
+	}
+
 	/**
 	 * Get packet with minimal timestamp from all ready LinkDumpParsers and
 	 * ignore dupliacate packets within duplicate_timeout
@@ -183,6 +203,32 @@ public class PacketSorter {
 		}
 	}
 
+	/**
+	 * read next packet of log and correct its timestamp
+	 */
+	private Packet readPacket(int log) throws Exception {
+		Packet packet = parsers.get(log).readPacket();
+		if (packet != null && correctClocks) {
+			clockSkew.addObservation(log, packet.time_ms, packet);
+			packet.time_ms = clockSkew.correct(log, packet.time_ms);
+		}
+		return packet;
+	}
+
+	/**
+	 * @param correctClocks correct timestamps of logs by estimated clock offset and drift
+	 */
+	public void setClockCorrection(boolean correctClocks) {
+		this.correctClocks = correctClocks;
+	}
+
+	/**
+	 * @return max deviation of corrected timestamps of duplicates in ms
+	 */
+	public long getMaxClockError() {
+		return clockSkew.getMaxResidual();
+	}
+
 	/**
 	 * @return
 	 */
@@ -267,6 +313,10 @@ public class PacketSorter {
 	/** Timeout to detect duplicate packets */
 	private int duplicate_timeout = 5;
 
+	/** Clock offset and drift of DSN nodes */
+	private ClockSkewEstimator clockSkew = new ClockSkewEstimator();
+	private boolean correctClocks = false;
+
 	/** Simulation start time im ms */
 	private long time_base;
 
@@ -1,8 +1,13 @@
 package model;
 
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.IOException;
 import java.util.ArrayList;
 import java.util.HashMap;
 
+import stream.Checkpointable;
+
 
 
 /**
@@ -54,7 +59,7 @@ class TraceItem {
 	}
 }
 
-public class PacketTracer {
+public class PacketTracer implements Checkpointable {
 	
 	
 	public void tracePacket( model.PacketTracerTuple traceItem, long time) {
@@ -202,6 +207,59 @@ public class PacketTracer {
 		return packetTracer;
 	}
 	
+	public void saveState(DataOutputStream out) throws IOException {
+		out.writeInt(virtualSeqNo);
+		out.writeInt(packets.size());
+		for (TraceItem item : packets.values()) {
+			out.writeUTF(item.src.toString());
+			out.writeUTF(item.dst.toString());
+			out.writeInt(item.seqNo);
+			out.writeLong(item.time);
+			writeAddress(out, item.l2src);
+			writeAddress(out, item.l2dst);
+			out.writeInt(item.virtualSeqNo);
+			out.writeShort(item.hops.size());
+			for (NodeAddress hop : item.hops) {
+				out.writeUTF(hop.toString());
+			}
+		}
+	}
+
+	public void restoreState(DataInputStream in, long timeShift) throws IOException {
+		packets.clear();
+		hopTraces.clear();
+		garbageTimer = 0;
+		virtualSeqNo = in.readInt();
+		int count = in.readInt();
+		for (int i = 0; i < count; i++) {
+			TraceItem item = new TraceItem();
+			item.src = new NodeAddress(in.readUTF());
+			item.dst = new NodeAddress(in.readUTF());
+			item.seqNo = in.readInt();
+			item.time = in.readLong() + timeShift;
+			item.l2src = readAddress(in);
+			item.l2dst = readAddress(in);
+			item.virtualSeqNo = in.readInt();
+			int nrHops = in.readShort();
+			for (int j = 0; j < nrHops; j++) {
+				item.hops.add( new NodeAddress(in.readUTF()));
+			}
+			packets.put( item.hashCode(), item);
+		}
+	}
+	
+	private static void writeAddress(DataOutputStream out, NodeAddress address) throws IOException {
+		out.writeBoolean(address != null);
+		if (address != null) {
+			out.writeUTF(address.toString());
+		}
+	}
+
+	private static NodeAddress readAddress(DataInputStream in) throws IOException {
+		if (!in.readBoolean()) return null;
+		return new NodeAddress(in.readUTF());
+	}
+	
 	/** singleton */
 	private static PacketTracer packetTracer = null;
 	
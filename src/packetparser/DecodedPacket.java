@@ -1,60 +1,135 @@
 package packetparser;
 
+/**
+ * Packet decoded using a packet description.
+ * 
+ * The packet does not copy its data but refers to a slice of the receive buffer. 
+ * If that buffer was acquired from the PacketBufferPool, it has to be returned
+ * by calling recycle() when the packet is not used anymore.
+ * 
+ * Use after recycle() is detected if assertions are enabled (java -ea).
+ */
 public class DecodedPacket {
 
 	PacketTemplate template;
 	byte rawData[];
+	int rawOffset;
+	int rawLength;
+	boolean pooled = false;
+	boolean recycled = false;
 	int hashCode;
 	
-    private DecodedPacket(byte rawData[], PacketTemplate template){
+    private DecodedPacket(byte rawData[], int rawOffset, int rawLength, PacketTemplate template){
     	this.rawData = rawData;
+    	this.rawOffset = rawOffset;
+    	this.rawLength = rawLength;
     	this.template = template;
     	calcHash();
     }
     
     private DecodedPacket( DecodedPacket other){
-    	rawData = new byte[other.rawData.length];
-    	System.arraycopy(other.rawData, 0, rawData, 0, other.rawData.length);
+    	rawData = new byte[other.rawLength];
+    	System.arraycopy(other.rawData, other.rawOffset, rawData, 0, other.rawLength);
+    	rawOffset = 0;
+    	rawLength = other.rawLength;
     	template = other.template;
     	calcHash();
     }
     
-	private static PacketTemplate getNestedPacketTemplate( byte[] buffer, PacketTemplate packet) {
+	private static PacketTemplate getNestedPacketTemplate( byte[] buffer, int start, int length, PacketTemplate packet) {
+		// use lookup tables if available
+		while (packet.dispatchReady) {
+			PacketTemplate child = packet.getExtension(buffer, start, length);
+			if (child == null) return packet;
+			packet = child;
+		}
 		for (PacketTemplate child : packet.extensions ) {
 			// check for conditions 
 			if (child.guardField == null) {
-				return getNestedPacketTemplate(buffer,child);
+				return getNestedPacketTemplate(buffer, start, length, child);
 			}
 			Attribute attribute = child.guardField;
-			if ( DecodedPacket.getInt(buffer, attribute.offset, attribute.type.size,
+			if ( DecodedPacket.getInt(buffer, start, length, attribute.offset, attribute.type.size,
 			TypeSpecifier.littleEndian) == child.guardValue) {
 				// System.out.println("getNestedPacketTemplate: "+packet.typeName+" is a " + child.typeName);
-				return getNestedPacketTemplate(buffer, child);
+				return getNestedPacketTemplate(buffer, start, length, child);
 			}
 		}
 		return packet;
 	}
 	
-	private static PacketTemplate getPacketTemplate(PDL parser, byte[] buffer) {
+	private static PacketTemplate getPacketTemplate(PDL parser, byte[] buffer, int start, int length) {
 		PacketTemplate defPacket = parser.getDefaultPacket();
-		return getNestedPacketTemplate(buffer, defPacket);
+		return getNestedPacketTemplate(buffer, start, length, defPacket);
 	}
 
 	public static DecodedPacket createPacketFromBuffer( PDL parser, byte[] buffer) {
-		PacketTemplate packet = getPacketTemplate(parser, buffer);
+		return createPacketFromBuffer(parser, buffer, 0, buffer.length);
+	}
+
+	/**
+	 * Decode packet stored in buffer[start .. start+length-1]. The buffer is not copied
+	 */
+	public static DecodedPacket createPacketFromBuffer( PDL parser, byte[] buffer, int start, int length) {
+		PacketTemplate packet = getPacketTemplate(parser, buffer, start, length);
 		if (packet == null) return null;
-		return new DecodedPacket( buffer, packet);
+		return new DecodedPacket( buffer, start, length, packet);
+	}
+
+	/**
+	 * Decode packet stored in a buffer from the PacketBufferPool. 
+	 * The buffer is returned to the pool by recycle()
+	 */
+	public static DecodedPacket createPacketFromPooledBuffer( PDL parser, byte[] buffer, int start, int length) {
+		DecodedPacket packet = createPacketFromBuffer(parser, buffer, start, length);
+		if (packet == null) {
+			PacketBufferPool.getInstance().recycle(buffer);
+			return null;
+		}
+		packet.pooled = true;
+		return packet;
+	}
+
+	/**
+	 * Create packet from pooled buffer with an already known template, e.g. stored 
+	 * in a capture file. The buffer is returned to the pool by recycle()
+	 */
+	public static DecodedPacket createPacketFromPooledBuffer( PacketTemplate template, byte[] buffer, int start, int length) {
+		DecodedPacket packet = new DecodedPacket( buffer, start, length, template);
+		packet.pooled = true;
+		return packet;
 	}
 
+	/**
+	 * @return packet with a private copy of the packet data
+	 */
+	public DecodedPacket copy() {
+		assert !recycled : "DecodedPacket copied after recycle()";
+		return new DecodedPacket(this);
+	}
 
+	/**
+	 * Return buffer to PacketBufferPool. The packet must not be used afterwards.
+	 * 
+	 * Only the owner of the packet may call this: the source that created it, as long as
+	 * it has not passed the packet on, or the single operator the source documents as
+	 * taking ownership, e.g. DistinctInWindow. Other operators have to copy() packets
+	 * they keep beyond process().
+	 */
+	public void recycle() {
+		if (!pooled || rawData == null) return;
+		PacketBufferPool.getInstance().recycle(rawData);
+		rawData = null;
+		pooled = false;
+		recycled = true;
+	}
 
 	private void calcHash() {
-    	StringBuffer content = new StringBuffer();
-    	for (int i = 0; i < rawData.length; i++) {
-    		content.append( ".");
-    		content.append( rawData[i]);
-    	}
-    	hashCode = content.toString().hashCode();
+		int hash = 1;
+		for (int i = rawOffset; i < rawOffset + rawLength; i++) {
+			hash = 31 * hash + rawData[i];
+		}
+    	hashCode = hash;
     	if (template != null) {
     		hashCode ^= template.hashCode();
     	}
@@ -71,14 +146,16 @@ public class DecodedPacket {
     }
     
     public int getByte( int offset) {
-    	if (offset >= rawData.length) {
+    	assert !recycled : "DecodedPacket accessed after recycle()";
+    	if (offset >= rawLength) {
     		System.out.println("DecodedPacket error: access byte "+offset+" in\n"+toString());
     		System.exit(10);
-    	}    	if (rawData[offset] >= 0) return rawData[offset];
-    	return rawData[offset]+256;
+    	}    	if (rawData[rawOffset+offset] >= 0) return rawData[rawOffset+offset];
+    	return rawData[rawOffset+offset]+256;
     }
     
     public  Integer getIntAttribute( String attribute) {
+    	assert !recycled : "DecodedPacket accessed after recycle()";
     	Integer result = getIntAttribute( template, 0, attribute);
     	if (result == null) {
     		System.out.println("Cannot get attribute "+attribute + " for type " + template);
@@ -89,9 +166,18 @@ public class DecodedPacket {
     
     
 	static public int getInt(byte buffer[], int offset, int size, boolean littleEndian) {
-		if (offset + size > buffer.length)
+		return getInt(buffer, 0, buffer.length, offset, size, littleEndian);
+	}
+
+	/**
+	 * get int from packet stored in buffer[start .. start+length-1]
+	 */
+	static public int getInt(byte buffer[], int start, int length, int offset, int size, boolean littleEndian) {
+		if (offset + size > length)
 			return -1;
 
+		offset += start;
+
 		int step = 1;
 		if (littleEndian) {
 			offset += size - 1;
@@ -170,7 +256,7 @@ public class DecodedPacket {
 							return att.elements;
 						}
 						if (att.elements == PacketTemplate.variableSizedDirect) {
-							return getInt( rawData, offset + type.lengthPos, type.lengthField.type.size, TypeSpecifier.littleEndian);
+							return getInt( rawData, rawOffset, rawLength, offset + type.lengthPos, type.lengthField.type.size, TypeSpecifier.littleEndian);
 						}
 						if (att.elements == PacketTemplate.variableSizedIndirect) {
 							// get total (sub-)struct size
@@ -182,9 +268,9 @@ public class DecodedPacket {
 				}
 				// add offset of "the" array if accessing values behind
 				if (type.fixedLength == false && att.offset > type.lengthPos && att.elements > 0){
-					offset += getInt( rawData, offset + type.lengthPos, type.lengthField.type.size, TypeSpecifier.littleEndian) * type.lengthMultiply;
+					offset += getInt( rawData, rawOffset, rawLength, offset + type.lengthPos, type.lengthField.type.size, TypeSpecifier.littleEndian) * type.lengthMultiply;
 				}
-		    	return getInt( rawData, offset + att.offset, att.type.size, TypeSpecifier.littleEndian);
+		    	return getInt( rawData, rawOffset, rawLength, offset + att.offset, att.type.size, TypeSpecifier.littleEndian);
 			}
 		}
     	return null;
@@ -195,12 +281,21 @@ public class DecodedPacket {
 		return  getIntAttribute(template, 0, attribute) != null;
 	}
 	
+	/**
+	 * @return packet data. Copied, if packet is stored in a slice of a larger buffer
+	 */
 	public byte [] getRaw(){
-		return rawData;
+		assert !recycled : "DecodedPacket accessed after recycle()";
+		if (rawOffset == 0 && rawLength == rawData.length) {
+			return rawData;
+		}
+		byte raw[] = new byte[rawLength];
+		System.arraycopy(rawData, rawOffset, raw, 0, rawLength);
+		return raw;
 	}
 	
 	public int getLength() {
-		return rawData.length;
+		return rawLength;
 	}
 
 	/*** toString ******/
@@ -224,12 +319,12 @@ public class DecodedPacket {
 	private void appendData(StringBuffer result) {
 		result.append( "\n");
 		int offset = 0; 
-		if (rawData != null && rawData.length > 0 ) {
-			while (offset < rawData.length) {
+		if (rawData != null && rawLength > 0 ) {
+			while (offset < rawLength) {
 				result.append("    ");
 				appendHex(result, 4, ""+offset);
 				result.append(":");
-				int count = rawData.length - offset;
+				int count = rawLength - offset;
 				if (count > 16) { count = 16; };
 				for (int i = 0; i<count; i++) {
 					result.append(" ");
@@ -275,7 +370,7 @@ public class DecodedPacket {
 				// all information available.. do something with it
 				result.append ( "[" + type + "] " + prefix + att.name + " = " );
 				for (int i = 0; i < att.elements; i++) {
-					int value = getInt(rawData, byteOffset + att.offset + i * att.type.size, att.type.size,
+					int value = getInt(rawData, rawOffset, rawLength, byteOffset + att.offset + i * att.type.size, att.type.size,
 							TypeSpecifier.littleEndian);
 					result.append(value + " (0x"+Integer.toHexString(value)+")");
 				}
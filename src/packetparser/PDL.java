@@ -34,6 +34,9 @@ public class PDL {
 	// parser instance
 	static Parser parser = null;
 
+	// cached default packet
+	private PacketTemplate defaultPacket = null;
+
 	// Returns true if the given string is
 	// a typedef type.
 	boolean isType(String type) {
@@ -120,8 +123,27 @@ public class PDL {
 	}
 
 	public PacketTemplate getDefaultPacket() {
-		String defPackName = getStringValue("defaults.packet");
-		return structs.get(defPackName);
+		if (defaultPacket == null) {
+			String defPackName = getStringValue("defaults.packet");
+			defaultPacket = structs.get(defPackName);
+		}
+		return defaultPacket;
+	}
+
+	/**
+	 * @param name struct name
+	 * @return packet template or null
+	 */
+	public PacketTemplate getTemplate(String name) {
+		return structs.get(name);
+	}
+
+	// Build extension lookup tables for all structs
+	void buildDispatchTables() {
+		Enumeration<PacketTemplate> myEnum = structs.elements();
+		while (myEnum.hasMoreElements()) {
+			myEnum.nextElement().buildDispatchTable();
+		}
 	}
 
 	public PhyConfig getSnifferConfig() {
@@ -217,6 +239,9 @@ public class PDL {
 		if ( parser.getStringValue("defaults.endianness").equalsIgnoreCase("big") ) {
 			TypeSpecifier.setEndianess( false );
 		}
+		
+		// description complete, prepare packet type resolution 
+		parser.buildDispatchTables();
 		return parser;
 	}
 
@@ -0,0 +1,76 @@
+package packetparser;
+
+/**
+ * Pool of fixed-size receive buffers for sniffed packets.
+ * 
+ * Buffers are acquired by the packet source, wrapped by a DecodedPacket and
+ * returned by DecodedPacket.recycle() as soon as the packet is not referenced anymore.
+ * If the pool is empty, a new buffer is allocated. 
+ * 
+ * Used by the DSN receive thread and the scheduler thread, so access is synchronized.
+ *  
+ * @author mringwal
+ *
+ */
+public class PacketBufferPool {
+
+	/** max size of a sniffed packet including header */
+	public static final int BUFFER_SIZE = 255;
+	
+	/** max nr of buffers kept in pool */
+	private static final int MAX_FREE = 1024;
+
+	private byte freeBuffers[][] = new byte[MAX_FREE][];
+	private int nrFree = 0;
+	private int allocated = 0;
+	
+	/**
+	 * @return empty buffer of BUFFER_SIZE bytes
+	 */
+	public synchronized byte [] acquire() {
+		if (nrFree > 0) {
+			byte buffer[] = freeBuffers[--nrFree];
+			freeBuffers[nrFree] = null;
+			return buffer;
+		}
+		allocated++;
+		return new byte[BUFFER_SIZE];
+	}
+
+	/**
+	 * return buffer to pool. The buffer must not be used by the caller anymore
+	 * @param buffer
+	 */
+	public synchronized void recycle(byte buffer[]) {
+		if (buffer == null || buffer.length != BUFFER_SIZE || nrFree == MAX_FREE) return;
+		assert !isFree(buffer) : "PacketBufferPool: buffer recycled twice";
+		freeBuffers[nrFree++] = buffer;
+	}
+
+	/**
+	 * @return true, if buffer is in pool. Only used with assertions enabled
+	 */
+	private boolean isFree(byte buffer[]) {
+		for (int i = 0; i < nrFree; i++) {
+			if (freeBuffers[i] == buffer) return true;
+		}
+		return false;
+	}
+	
+	/**
+	 * @return nr of buffers allocated by the pool
+	 */
+	public synchronized int getAllocated() {
+		return allocated;
+	}
+	
+	/**
+	 * Provide global access to a single buffer pool 
+	 */
+	public static PacketBufferPool getInstance() {
+		return instance;
+	}
+
+	/** singleton */
+	private static final PacketBufferPool instance = new PacketBufferPool();
+}
@@ -1,5 +1,6 @@
 package packetparser;
 
+import java.util.HashMap;
 import java.util.Vector;
 
 class Attribute {
@@ -77,6 +78,103 @@ public class PacketTemplate extends TypeSpecifier {
 	/** TODO hack to support variable sized arrays which are NOT of a single byte type */
 	int lengthMultiply = 1;
 	
+	/** extensions can be looked up by the value of dispatchField */
+	boolean dispatchReady = false;
+	
+	/** common guard field of all extensions */
+	Attribute dispatchField;
+	
+	/** dense lookup table: extension for guard value dispatchMin + i */
+	PacketTemplate dispatchTable[];
+	
+	int dispatchMin;
+	
+	/** sparse lookup table */
+	HashMap<Integer,PacketTemplate> dispatchMap;
+
+	/** extension without guard */
+	PacketTemplate defaultExtension;
+	
+	/**
+	 * Build lookup table for extensions. 
+	 * 
+	 * Same semantics as checking the extensions in order: the first matching extension 
+	 * is used, an extension without guard matches always. If the extensions use different 
+	 * guard fields, no table is built.
+	 */
+	void buildDispatchTable() {
+		dispatchReady = false;
+		dispatchField = null;
+		dispatchTable = null;
+		dispatchMap = null;
+		defaultExtension = null;
+		
+		// collect guarded extensions before first unguarded one 
+		HashMap<Integer,PacketTemplate> guarded = new HashMap<Integer,PacketTemplate>();
+		int min = Integer.MAX_VALUE;
+		int max = Integer.MIN_VALUE;
+		for (PacketTemplate child : extensions) {
+			if (child.guardField == null) {
+				defaultExtension = child;
+				break;
+			}
+			if (dispatchField == null) {
+				dispatchField = child.guardField;
+			} else if (dispatchField.offset != child.guardField.offset 
+					|| dispatchField.type.size != child.guardField.type.size) {
+				// different guard fields, use linear search
+				dispatchField = null;
+				defaultExtension = null;
+				return;
+			}
+			Integer key = child.guardValue;
+			if (!guarded.containsKey(key)) {
+				guarded.put(key, child);
+			}
+			min = Math.min( min, child.guardValue);
+			max = Math.max( max, child.guardValue);
+		}
+		
+		if (guarded.size() > 0) {
+			long range = (long) max - min + 1;
+			if (range <= Math.max( 16, 4 * guarded.size())) {
+				dispatchMin = min;
+				dispatchTable = new PacketTemplate[(int) range];
+				for (Integer key : guarded.keySet()) {
+					dispatchTable[key - min] = guarded.get(key);
+				}
+			} else {
+				dispatchMap = guarded;
+			}
+		}
+		dispatchReady = true;
+	}
+	
+	/**
+	 * pre: dispatchReady
+	 * @param buffer
+	 * @param start of packet in buffer
+	 * @param length of packet
+	 * @return extension matching the packet in buffer, or null
+	 */
+	PacketTemplate getExtension(byte buffer[], int start, int length) {
+		if (dispatchField != null) {
+			int value = DecodedPacket.getInt(buffer, start, length, dispatchField.offset, dispatchField.type.size, 
+					TypeSpecifier.littleEndian);
+			PacketTemplate child = null;
+			if (dispatchTable != null) {
+				int index = value - dispatchMin;
+				if (index >= 0 && index < dispatchTable.length) {
+					child = dispatchTable[index];
+				}
+			} else {
+				child = dispatchMap.get(value);
+			}
+			if (child != null) return child;
+		}
+		return defaultExtension;
+	}
+	
 	int getSize() {
 		return packetSize;
 	}
@@ -35,12 +35,75 @@ public abstract class AbstractPipe<I,O> implements Pipe<I,O> {
 		return true;
 	}
 
+	/**
+	 * Remove all subscriptions of a sink
+	 * @param sink
+	 * @return true, if sink was subscribed
+	 */
+	@SuppressWarnings("unchecked")
+	public boolean unsubscribe(Sink<? super O> sink) {
+		if (sinks == null) return false;
+		int count = 0;
+		for (int i = 0; i < sinks.length; i++) {
+			if (sinks[i] != sink) count++;
+		}
+		if (count == sinks.length) return false;
+		if (count == 0) {
+			sinks = null;
+			sinkIDs = null;
+			return true;
+		}
+		Sink[] sinksTmp = new Sink[count];
+		int[] IDsTmp = new int[count];
+		int pos = 0;
+		for (int i = 0; i < sinks.length; i++) {
+			if (sinks[i] == sink) continue;
+			sinksTmp[pos] = sinks[i];
+			IDsTmp[pos] = sinkIDs[i];
+			pos++;
+		}
+		sinks = sinksTmp;
+		sinkIDs = IDsTmp;
+		return true;
+	}
+
+	/**
+	 * Replace all subscriptions of a sink by another sink, keeping position and sink ID
+	 * @param oldSink
+	 * @param newSink
+	 * @return true, if oldSink was subscribed
+	 */
+	public boolean replace(Sink<? super O> oldSink, Sink<? super O> newSink) {
+		if (sinks == null) return false;
+		boolean found = false;
+		for (int i = 0; i < sinks.length; i++) {
+			if (sinks[i] == oldSink) {
+				sinks[i] = newSink;
+				found = true;
+			}
+		}
+		return found;
+	}
+
 	public void transfer(O o, long timestamp) {
 		if (sinks != null) {
 			for (int i = 0; i < sinks.length; i++)
 				sinks[i].process(o, sinkIDs[i], timestamp);
 		}
 	}
+
+	/**
+	 * Pass n tuples to all sinks, see BatchSink
+	 * @param o
+	 * @param timestamps
+	 * @param n
+	 */
+	public void transferBatch(O o[], long timestamps[], int n) {
+		if (sinks != null) {
+			for (int i = 0; i < sinks.length; i++)
+				BatchAdapter.processBatch(sinks[i], o, timestamps, n, sinkIDs[i]);
+		}
+	}
 	
 	public Sink[] getSinks() {
 		return sinks;
@@ -1,5 +1,15 @@
 package stream;
 
+/**
+ * Source of tuples
+ * 
+ * Packet tuples of sources using the PacketBufferPool refer to pooled buffers. Sinks
+ * must not recycle them, unless the source documents that a sink takes ownership, e.g.
+ * DistinctInWindow behind the crc filter. Sinks keeping packets beyond process() have
+ * to copy them, see PacketTuple.copy().
+ * 
+ * @author mringwal
+ */
 public abstract class AbstractSource<O> implements Source<O> {
 
 	public String name ="NameNotSetFor_"+this.getClass().getName();
@@ -42,6 +52,19 @@ public abstract class AbstractSource<O> implements Source<O> {
 				sinks[i].process(o, sinkIDs[i], timestamp);
 		}
 	}
+
+	/**
+	 * Pass n tuples to all sinks, see BatchSink
+	 * @param o
+	 * @param timestamps
+	 * @param n
+	 */
+	public void transferBatch(O o[], long timestamps[], int n) {
+		if (sinks != null) {
+			for (int i = 0; i < sinks.length; i++)
+				BatchAdapter.processBatch(sinks[i], o, timestamps, n, sinkIDs[i]);
+		}
+	}
 	
 	/** 
 	 * Abstract method that is called by the thread simulating the activity of this source
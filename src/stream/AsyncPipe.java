@@ -0,0 +1,210 @@
+package stream;
+
+import java.util.concurrent.locks.LockSupport;
+
+import stream.tuple.PacketTuple;
+
+/**
+ * Run the subscribed operators on a separate thread
+ *
+ * Tuples and their timestamps are handed over by a lock-free ring buffer with a single
+ * producer, the thread calling process(), and a single consumer, the stage thread. The
+ * stage thread has its own Scheduler: before passing on a tuple, it processes the timers
+ * of the subscribed operators up to the tuple's timestamp, just as the Scheduler of the
+ * producer does. Time advancing without tuples, e.g. filtered packets or the watermark of
+ * a real-time source, is passed through the ring as well, so timers fire in the same
+ * order relative to the tuples as without the stage.
+ *
+ * This way, expensive stateless stages, e.g. packet decoding and crc check, run in parallel
+ * to the stateful operators behind the pipe. Stages can be chained. The stage thread uses
+ * a fork of the PipelineContext the pipe was created in.
+ *
+ * If the ring is full, process() waits, tuples are never dropped. Packet tuples are copied,
+ * as their buffers may be recycled upstream, e.g. by DistinctInWindow. Other tuples must not
+ * be modified after they have been passed on. Operators behind the pipe should not be
+ * registered with a Checkpoint, which runs on the producer thread.
+ *
+ * @author mringwal
+ *
+ * @param <I>
+ */
+public class AsyncPipe<I> extends AbstractPipe<I, I> implements TimeTriggered {
+
+	/** default size of ring buffer, power of two */
+	public static final int DEFAULT_CAPACITY = 4096;
+
+	/** busy waiting before parking an idle thread */
+	private static final int SPIN_TRIES = 100;
+	private static final long PARK_NANOS = 100000;
+
+	/** ring entry for time advancing without tuple */
+	private static final Object WATERMARK = new Object();
+	/** ring entry to stop stage thread */
+	private static final Object STOP = new Object();
+
+	private final Object items[];
+	private final long timestamps[];
+	private final int mask;
+
+	/** next entry to read, written by stage thread only */
+	private volatile long head = 0;
+	/** next entry to write, written by producer only */
+	private volatile long tail = 0;
+
+	/** producer state */
+	private boolean registered = false;
+	private long pendingWatermark = Long.MIN_VALUE;
+	private boolean stopped = false;
+
+	/** context of stage thread */
+	private final PipelineContext context;
+	private Thread stageThread;
+
+	public AsyncPipe() {
+		this(DEFAULT_CAPACITY);
+	}
+
+	/**
+	 * @param capacity max nr of queued tuples, rounded up to power of two
+	 */
+	public AsyncPipe(int capacity) {
+		int size = 1;
+		while (size < capacity) {
+			size <<= 1;
+		}
+		items = new Object[size];
+		timestamps = new long[size];
+		mask = size - 1;
+		// same schema as the operators behind the pipe
+		context = PipelineContext.getCurrent().fork();
+		stageThread = new Thread() {
+			public void run() {
+				stageLoop();
+			}
+		};
+		stageThread.setName("AsyncPipe");
+		stageThread.setDaemon(true);
+		stageThread.start();
+	}
+
+	public void process(I o, int srcID, long timestamp) {
+		if (!registered) {
+			// receive time of producer thread
+			Scheduler.getInstance().registerWatermarkListener(this);
+			registered = true;
+		}
+		if (timestamp >= pendingWatermark) {
+			// tuple advances time for the stage
+			pendingWatermark = Long.MIN_VALUE;
+		}
+		if (o instanceof PacketTuple) {
+			put(((PacketTuple) o).copy(), timestamp);
+		} else {
+			put(o, timestamp);
+		}
+	}
+
+	/**
+	 * Time of producer thread advanced. It is passed on with the next time advance
+	 * unless a tuple with a later timestamp arrives before, which usually happens
+	 * right after this call.
+	 */
+	public void handleTimerEvent(long timestamp) {
+		if (pendingWatermark != Long.MIN_VALUE) {
+			put(WATERMARK, pendingWatermark);
+		}
+		pendingWatermark = timestamp;
+	}
+
+	/**
+	 * @return nr of queued entries
+	 */
+	public int getQueueDepth() {
+		return (int) (tail - head);
+	}
+
+	/**
+	 * Process all queued tuples and stop stage thread. Has to be called by the producer,
+	 * or after an upstream AsyncPipe has been stopped
+	 */
+	public void stop() {
+		if (stopped) return;
+		stopped = true;
+		if (pendingWatermark != Long.MIN_VALUE) {
+			put(WATERMARK, pendingWatermark);
+			pendingWatermark = Long.MIN_VALUE;
+		}
+		put(STOP, 0);
+		try {
+			stageThread.join();
+		} catch (InterruptedException e) {
+			e.printStackTrace();
+		}
+	}
+
+	private void put(Object o, long timestamp) {
+		long t = tail;
+		int tries = 0;
+		while (t - head > mask) {
+			tries = idle(tries);
+		}
+		int slot = (int) t & mask;
+		items[slot] = o;
+		timestamps[slot] = timestamp;
+		// publish entry
+		tail = t + 1;
+	}
+
+	@SuppressWarnings("unchecked")
+	private void stageLoop() {
+		context.activate();
+		Scheduler scheduler = context.getScheduler();
+		long h = head;
+		int tries = 0;
+		while (true) {
+			long available = tail;
+			if (h == available) {
+				tries = idle(tries);
+				continue;
+			}
+			tries = 0;
+			// take all available entries, free their slots at once
+			while (h < available) {
+				int slot = (int) h & mask;
+				Object o = items[slot];
+				long timestamp = timestamps[slot];
+				items[slot] = null;
+				h++;
+				if (o == STOP) {
+					head = h;
+					return;
+				}
+				try {
+					scheduler.advanceTo(timestamp);
+					if (o != WATERMARK) {
+						transfer((I) o, timestamp);
+					}
+				} catch (RuntimeException e) {
+					e.printStackTrace();
+				}
+			}
+			head = h;
+		}
+	}
+
+	/**
+	 * spin, then yield, then park
+	 * @return tries
+	 */
+	private static int idle(int tries) {
+		if (tries < SPIN_TRIES) {
+			return tries + 1;
+		}
+		if (tries < 2 * SPIN_TRIES) {
+			Thread.yield();
+			return tries + 1;
+		}
+		LockSupport.parkNanos(PARK_NANOS);
+		return tries;
+	}
+}
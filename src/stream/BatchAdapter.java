@@ -0,0 +1,47 @@
+package stream;
+
+/**
+ * Pass a batch to a sink
+ *
+ * Sinks without batch support get the tuples one at a time. Before each tuple, timers due
+ * are processed, as they would be by the Scheduler without batches. This way, stateful
+ * operators see timers and tuples in the same order, even though a batch is only
+ * cut at timeouts that were registered before it was started.
+ *
+ * @author mringwal
+ *
+ */
+public class BatchAdapter {
+
+	/**
+	 * @param sink
+	 * @param o tuples
+	 * @param timestamps of tuples
+	 * @param n nr of tuples
+	 * @param srcID
+	 */
+	@SuppressWarnings("unchecked")
+	public static <I> void processBatch(Sink<? super I> sink, I o[], long timestamps[], int n, int srcID) {
+		if (sink instanceof BatchSink) {
+			((BatchSink) sink).processBatch(o, timestamps, n, srcID);
+			return;
+		}
+		processEach(sink, o, timestamps, n, srcID);
+	}
+
+	/**
+	 * Pass tuples of a batch one at a time, used by operators that cannot process a batch at once
+	 * @param sink
+	 * @param o tuples
+	 * @param timestamps of tuples
+	 * @param n nr of tuples
+	 * @param srcID
+	 */
+	public static <I> void processEach(Sink<? super I> sink, I o[], long timestamps[], int n, int srcID) {
+		Scheduler scheduler = Scheduler.getInstance();
+		for (int i = 0; i < n; i++) {
+			scheduler.advanceTo(timestamps[i]);
+			sink.process(o[i], srcID, timestamps[i]);
+		}
+	}
+}
@@ -0,0 +1,25 @@
+package stream;
+
+/**
+ * Sink that can process several tuples in one call
+ *
+ * Used for offline replay, see Scheduler.batchSize. Stateless operators implement it with
+ * a tight loop, so the cost of calling through the Sink interface is paid once per batch.
+ * Tuples are passed to sinks without batch support one at a time by BatchAdapter.
+ *
+ * The arrays are only valid during the call, they are reused by the caller.
+ *
+ * @author mringwal
+ *
+ * @param <I>
+ */
+public interface BatchSink<I> extends Sink<I> {
+
+	/**
+	 * @param o tuples
+	 * @param timestamps of tuples
+	 * @param n nr of tuples
+	 * @param srcID
+	 */
+	public void processBatch(I o[], long timestamps[], int n, int srcID);
+}
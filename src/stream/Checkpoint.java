@@ -0,0 +1,179 @@
+package stream;
+
+import java.io.BufferedInputStream;
+import java.io.BufferedOutputStream;
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.util.ArrayList;
+
+/**
+ * Periodically stores the state of all registered operators in a binary snapshot file.
+ * If requested, e.g. to continue an interrupted analysis, it is restored when the
+ * Scheduler is started. The snapshot is deleted when the source has been processed
+ * completely, so a finished run is never resumed.
+ * 
+ * Operators are identified by name, so a snapshot can also be restored into a graph with
+ * a different configuration. Operators not found in the snapshot start empty, unknown 
+ * entries in the snapshot are skipped.
+ * 
+ * If the source is registered, e.g. a LogReader, processing continues right after the
+ * last packet processed before the checkpoint. Otherwise, e.g. for live data, all 
+ * restored timestamps are shifted to the start of the new session.
+ * 
+ * @author mringwal
+ *
+ */
+public class Checkpoint implements TimeTriggered {
+
+	private static final int MAGIC = 0x534e4946; // "SNIF"
+	private static final short VERSION = 1;
+	
+	/** name of source entry */
+	public static final String SOURCE = "source";
+	
+	private File file;
+	private int interval;
+	private ArrayList<String> names = new ArrayList<String>();
+	private ArrayList<Checkpointable> operators = new ArrayList<Checkpointable>();
+	private boolean haveSource = false;
+	private boolean resume;
+	
+	/**
+	 * @param file snapshot file
+	 * @param interval between two snapshots in ms
+	 * @param resume restore operators from existing snapshot on start
+	 */
+	public Checkpoint(String file, int interval, boolean resume) {
+		this.file = new File(file);
+		this.interval = interval;
+		this.resume = resume;
+	}
+	
+	/**
+	 * @param name unique name of operator in graph
+	 * @param operator
+	 */
+	public void register(String name, Checkpointable operator) {
+		if (names.contains(name)) {
+			throw new RuntimeException("Checkpoint: operator " + name + " registered twice");
+		}
+		if (name.equals(SOURCE)) {
+			haveSource = true;
+		}
+		names.add(name);
+		operators.add(operator);
+	}
+	
+	/**
+	 * register packet source to continue after last packet processed
+	 * @param source
+	 */
+	public void registerSource(Checkpointable source) {
+		register(SOURCE, source);
+	}
+	
+	/**
+	 * restore operators, if requested, and start periodic checkpoints.
+	 * called by Scheduler.run after timers have been reset
+	 */
+	public void start() {
+		long time = 0;
+		if (resume && file.exists()) {
+			try {
+				time = restore();
+			} catch (IOException e) {
+				System.out.println("Checkpoint: could not restore " + file + ": " + e.getMessage());
+			}
+		}
+		Scheduler.getInstance().registerTimeout( time + interval, this);
+	}
+
+	/**
+	 * delete snapshot, called by Scheduler.run when the source has no more packets
+	 */
+	public void finish() {
+		if (file.exists() && !file.delete()) {
+			System.out.println("Checkpoint: could not delete " + file);
+		}
+	}
+
+	public void handleTimerEvent(long timestamp) {
+		try {
+			save(timestamp);
+		} catch (IOException e) {
+			e.printStackTrace();
+		}
+		Scheduler.getInstance().registerTimeout( timestamp + interval, this);
+	}
+	
+	/**
+	 * write snapshot of all registered operators
+	 * @param timestamp current time
+	 * @throws IOException
+	 */
+	public void save(long timestamp) throws IOException {
+		File tmpFile = new File( file.getPath() + ".tmp");
+		DataOutputStream out = new DataOutputStream( new BufferedOutputStream( new FileOutputStream(tmpFile)));
+		out.writeInt(MAGIC);
+		out.writeShort(VERSION);
+		out.writeLong(timestamp);
+		out.writeInt(operators.size());
+		ByteArrayOutputStream buffer = new ByteArrayOutputStream();
+		for (int i = 0; i < operators.size(); i++) {
+			buffer.reset();
+			DataOutputStream entry = new DataOutputStream(buffer);
+			operators.get(i).saveState(entry);
+			entry.flush();
+			out.writeUTF(names.get(i));
+			out.writeInt(buffer.size());
+			buffer.writeTo(out);
+		}
+		out.close();
+		// replace old snapshot
+		file.delete();
+		if (!tmpFile.renameTo(file)) {
+			throw new IOException("Cannot rename " + tmpFile + " to " + file);
+		}
+	}
+	
+	/**
+	 * restore all registered operators from snapshot
+	 * @return time of snapshot, in the time of the current session
+	 * @throws IOException
+	 */
+	public long restore() throws IOException {
+		long start = System.currentTimeMillis();
+		DataInputStream in = new DataInputStream( new BufferedInputStream( new FileInputStream(file)));
+		try {
+			if (in.readInt() != MAGIC || in.readShort() != VERSION) {
+				throw new IOException("Not a checkpoint file");
+			}
+			long timestamp = in.readLong();
+			// without source, the new session starts at time 0
+			long timeShift = haveSource ? 0 : -timestamp;
+			int count = in.readInt();
+			for (int i = 0; i < count; i++) {
+				String name = in.readUTF();
+				byte data[] = new byte[in.readInt()];
+				in.readFully(data);
+				int pos = names.indexOf(name);
+				if (pos < 0) {
+					System.out.println("Checkpoint: skipping unknown operator " + name);
+					continue;
+				}
+				operators.get(pos).restoreState( new DataInputStream( new ByteArrayInputStream(data)), timeShift);
+			}
+			System.out.println("Checkpoint: restored state at " + timestamp / 1000 + " s in " 
+					+ (System.currentTimeMillis() - start) + " ms");
+			return timestamp + timeShift;
+		} finally {
+			in.close();
+		}
+	}
+}
@@ -0,0 +1,30 @@
+package stream;
+
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.IOException;
+
+/**
+ * Operator or source that can store its state in a Checkpoint
+ * 
+ * @author mringwal
+ *
+ */
+public interface Checkpointable {
+
+	/**
+	 * write current state
+	 * @param out
+	 * @throws IOException
+	 */
+	void saveState(DataOutputStream out) throws IOException;
+	
+	/**
+	 * replace current state by stored state. Timers for restored items have to be re-registered.
+	 * 
+	 * @param in
+	 * @param timeShift to add to all stored timestamps
+	 * @throws IOException
+	 */
+	void restoreState(DataInputStream in, long timeShift) throws IOException;
+}
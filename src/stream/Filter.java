@@ -1,5 +1,7 @@
 package stream;
 
+import java.lang.reflect.Array;
+
 /**
  * generic filter 
  * 
@@ -8,10 +10,15 @@ package stream;
  *
  * @param <I>
  */
-public class Filter<I> extends AbstractPipe<I,I> {
+public class Filter<I> extends AbstractPipe<I,I> implements BatchSink<I> {
 	
 	private Predicate<? super I> predicate;
 
+	/** batch buffers */
+	private boolean results[] = new boolean[0];
+	private I passed[];
+	private long passedTimestamps[];
+
 	public Filter (Predicate<I> predicate) {
 		this.predicate = predicate;
 	}
@@ -25,4 +32,40 @@ public class Filter<I> extends AbstractPipe<I,I> {
 		}
 	}
 
+	@SuppressWarnings("unchecked")
+	public void processBatch(I o[], long timestamps[], int n, int srcID) {
+		if (!predicate.isStateless()) {
+			// each tuple has to be passed on before the predicate sees the next one
+			BatchAdapter.processEach(this, o, timestamps, n, srcID);
+			return;
+		}
+		if (results.length < n) {
+			results = new boolean[n];
+		}
+		int count = ((Predicate<I>) predicate).invokeBatch(o, timestamps, n, results);
+		if (count == 0) return;
+		if (count == n) {
+			transferBatch( o, timestamps, n);
+			return;
+		}
+		// same array type as input, sinks may expect it
+		if (passed == null || passed.length < count || passed.getClass() != o.getClass()) {
+			passed = (I[]) Array.newInstance(o.getClass().getComponentType(), n);
+			passedTimestamps = new long[n];
+		}
+		int pos = 0;
+		for (int i = 0; i < n; i++) {
+			if (results[i]) {
+				passed[pos] = o[i];
+				passedTimestamps[pos] = timestamps[i];
+				pos++;
+			}
+		}
+		transferBatch( passed, passedTimestamps, count);
+	}
+
+	public Predicate<? super I> getPredicate() {
+		return predicate;
+	}
+
 }
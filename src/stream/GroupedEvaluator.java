@@ -1,32 +1,115 @@
 package stream;
 
 import java.util.HashMap;
+import java.util.Iterator;
 
-public class GroupedEvaluator<I, J, K, O> extends AbstractPipe<I,O> {
+/**
+ * Evaluate the latest input per distinct key for each group
+ *
+ * The evaluator is only invoked if the input changed the group, see hasChanged().
+ * If a time to live is set, inputs not updated within it are removed, and groups
+ * without inputs are dropped, e.g. for crashed or removed nodes. Expired inputs
+ * are removed at most twice the time to live after their last update.
+ *
+ * @author mringwal
+ */
+public class GroupedEvaluator<I, J, K, O> extends AbstractPipe<I,O> implements TimeTriggered {
+
+	/** inputs of a group with time of last update */
+	private class Group {
+		HashMap<J,I> inputs = new HashMap<J,I>();
+		HashMap<J,Long> updated = new HashMap<J,Long>();
+		/** inputs expired since last evaluation */
+		boolean expired = false;
+	}
+
+	private HashMap<K,Group> groups = new HashMap<K,Group>();
 
-	private HashMap<K,HashMap<J,I>> groups = new HashMap<K,HashMap<J,I>>();
-	
 	protected Function<I,? extends J> distincter;
 	protected Function<I,? extends K> grouper;
 	protected GroupEvaluationFunction<I,J,K,O> evaluator;
 
+	/** in ms, 0: inputs don't expire */
+	private long timeToLive = 0;
+	private boolean expiryScheduled = false;
+
 	public void process(I o, int srcID, long timestamp) {
 		// get group id
 		K gID = grouper.invoke( o );
-		HashMap<J,I> group = groups.get(gID);
+		Group group = groups.get(gID);
 		if (group == null) {
-			group = new HashMap<J,I>();
+			group = new Group();
 			groups.put(gID, group);
 		}
 		// insert into HashMap
 		J distinctKey = distincter.invoke(o);
-		group.put( distinctKey, o);
-		O result = evaluator.process(gID, group);
+		I oldValue = group.inputs.put( distinctKey, o);
+		if (timeToLive > 0) {
+			group.updated.put( distinctKey, timestamp);
+			if (!expiryScheduled) {
+				Scheduler.getInstance().registerTimeout( timestamp + timeToLive, this);
+				expiryScheduled = true;
+			}
+		}
+		if (oldValue != null && !group.expired && !hasChanged(oldValue, o)) return;
+		group.expired = false;
+		O result = evaluator.process(gID, group.inputs);
 		if (result != null) {
 			transfer( result, timestamp);
 		}
 	}
-	
+
+	/**
+	 * Hook to skip evaluation if a new input does not differ from the previous one
+	 * with the same distinct key in any value relevant to the evaluator
+	 * @param oldValue
+	 * @param newValue
+	 * @return true if evaluator has to be invoked
+	 */
+	protected boolean hasChanged(I oldValue, I newValue) {
+		return !oldValue.equals(newValue);
+	}
+
+	/**
+	 * remove expired inputs
+	 */
+	public void handleTimerEvent(long timestamp) {
+		Iterator<Group> groupIterator = groups.values().iterator();
+		while (groupIterator.hasNext()) {
+			Group group = groupIterator.next();
+			Iterator<J> keys = group.updated.keySet().iterator();
+			while (keys.hasNext()) {
+				J distinctKey = keys.next();
+				if (group.updated.get(distinctKey) <= timestamp - timeToLive) {
+					keys.remove();
+					group.inputs.remove(distinctKey);
+					group.expired = true;
+				}
+			}
+			if (group.inputs.isEmpty()) {
+				groupIterator.remove();
+			}
+		}
+		expiryScheduled = !groups.isEmpty();
+		if (expiryScheduled) {
+			Scheduler.getInstance().registerTimeout( timestamp + timeToLive, this);
+		}
+	}
+
+	/**
+	 * @param timeToLive in ms after last update of an input, 0: inputs don't expire
+	 */
+	public void setTimeToLive(long timeToLive) {
+		this.timeToLive = timeToLive;
+	}
+
+	/**
+	 * @return nr of groups with inputs
+	 */
+	public int getNrGroups() {
+		return groups.size();
+	}
+
 	/**
 	 * @param grouper
 	 * @param distincter
@@ -0,0 +1,96 @@
+package stream;
+
+import stream.tuple.TupleSchema;
+
+/**
+ * Tuple schema and scheduler of an analysis graph
+ *
+ * Operators use the context that is current on the thread they are created and run on:
+ * tuple types are registered with its schema, and timers with its scheduler. Graphs built
+ * in different contexts are independent, e.g. they can register the same tuple type with
+ * different fields. To feed several graphs from one packet source, each graph is built
+ * with its context activated behind its own AsyncPipe:
+ *
+ *   PipelineContext previous = new PipelineContext("debugger").activate();
+ *   AsyncPipe<PacketTuple> input = new AsyncPipe<PacketTuple>();
+ *   ... operators subscribed to input ...
+ *   previous.activate();
+ *   source.subscribe(input, 0);
+ *
+ * A scheduler must only be used by one thread. To run parts of a graph on other threads,
+ * fork() creates a context with the same schema and its own scheduler. Threads without an
+ * activated context use a fork of the default context, so they all share the default schema.
+ *
+ * @author mringwal
+ *
+ */
+public class PipelineContext {
+
+	private static final PipelineContext defaultContext = new PipelineContext("default");
+
+	private static ThreadLocal<PipelineContext> current = new ThreadLocal<PipelineContext>() {
+		protected PipelineContext initialValue() {
+			return defaultContext.fork();
+		}
+	};
+
+	private String name;
+	private TupleSchema schema;
+	private Scheduler scheduler = new Scheduler();
+
+	/**
+	 * New context with empty schema
+	 * @param name
+	 */
+	public PipelineContext(String name) {
+		this(name, new TupleSchema());
+	}
+
+	private PipelineContext(String name, TupleSchema schema) {
+		this.name = name;
+		this.schema = schema;
+	}
+
+	/**
+	 * @return context with the same schema and its own scheduler
+	 */
+	public PipelineContext fork() {
+		return new PipelineContext(name, schema);
+	}
+
+	/**
+	 * @return context of calling thread
+	 */
+	public static PipelineContext getCurrent() {
+		return current.get();
+	}
+
+	/**
+	 * Make this the context of the calling thread
+	 * @return previous context of calling thread
+	 */
+	public PipelineContext activate() {
+		PipelineContext previous = current.get();
+		current.set(this);
+		return previous;
+	}
+
+	public String getName() {
+		return name;
+	}
+
+	public TupleSchema getSchema() {
+		return schema;
+	}
+
+	public Scheduler getScheduler() {
+		return scheduler;
+	}
+
+	/**
+	 * drop all timers
+	 */
+	void resetScheduler() {
+		scheduler = new Scheduler();
+	}
+}
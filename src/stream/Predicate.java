@@ -2,4 +2,31 @@ package stream;
 
 public abstract class Predicate<P> {
 	public abstract boolean invoke(P o, long timestamp );
+
+	/**
+	 * A stateless predicate only depends on the object it is invoked with, so it can be
+	 * evaluated for a whole batch before any object is passed on. Stateful predicates,
+	 * e.g. DistinctInWindow which recycles packets, are invoked one tuple at a time
+	 * @return true, if invokeBatch() can be used
+	 */
+	public boolean isStateless() {
+		return false;
+	}
+
+	/**
+	 * Evaluate stateless predicate for n objects. Can be overridden with a tight loop
+	 * @param o
+	 * @param timestamps
+	 * @param n
+	 * @param result predicate value per object
+	 * @return nr of objects for which the predicate holds
+	 */
+	public int invokeBatch(P o[], long timestamps[], int n, boolean result[]) {
+		int count = 0;
+		for (int i = 0; i < n; i++) {
+			result[i] = invoke(o[i], timestamps[i]);
+			if (result[i]) count++;
+		}
+		return count;
+	}
 }
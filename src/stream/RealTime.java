@@ -7,4 +7,12 @@ public interface RealTime {
 	 * @return true, if packets available
 	 */
 	boolean ready();
+
+	/**
+	 * Tuples with a timestamp older than the watermark have already been delivered 
+	 * or will not be delivered anymore. Used to fire timers while no tuples arrive.
+	 * 
+	 * @return watermark, Long.MIN_VALUE if unknown
+	 */
+	long getWatermark();
 }
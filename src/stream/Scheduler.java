@@ -1,5 +1,7 @@
 package stream;
 
+import java.lang.reflect.Array;
+import java.util.ArrayList;
 import java.util.Random;
 import java.util.TreeMap;
 
@@ -30,27 +32,66 @@ public class Scheduler {
 	}
 	private TreeMap<Long,TimerCallback> timers = new TreeMap<Long,TimerCallback>();
 
+	/** notified when time advances, e.g. to pass it to operators on other threads */
+	private ArrayList<TimeTriggered> watermarkListeners = new ArrayList<TimeTriggered>();
+	private long watermark = Long.MIN_VALUE;
+
+	/** nr of batches passed by runBatch(), 0: tuples are passed one at a time */
+	private long batchNr = 0;
+
 	private static TimeTriggered clockCallback = null; 
 	
-	private static Scheduler instance = null;
-
+	private static Checkpoint checkpoint = null;
+	
 	public static float packetloss = -1; // no loss
 
-	public static float speed = 1;
+	/** 
+	 * replay speed for non real-time sources:
+	 * > 0 : multiple of real-time, 0: paused, < 0: batch processing as fast as possible.
+	 * At every speed, timers fire with their deadline as current time, see processTimers()
+	 */
+	public static volatile float speed = 1;
+
+	/** nr of packets passed at once by runBatch(), see BatchSink. 1: no batches */
+	public static int batchSize = 1;
+	public static final int DEFAULT_BATCH_SIZE = 256;
 	
-	private static boolean stop = false;
+	private static volatile boolean stop = false;
 	
+	/**
+	 * Timers have to be registered on the thread that runs the graph, e.g. in process() or
+	 * handleTimerEvent(). Other threads, e.g. receive threads of a source, get the scheduler
+	 * of their own context, which is never run, so their timers would never fire.
+	 * @return scheduler of the current PipelineContext, so that independent graphs can be run in parallel
+	 */
 	public static Scheduler getInstance() {
-		if (instance == null) {
-			instance = new Scheduler();
-		}
-		return instance;
+		return PipelineContext.getCurrent().getScheduler();
+	}
+	
+	/**
+	 * drop all timers registered in the current PipelineContext
+	 */
+	public static void reset() {
+		PipelineContext.getCurrent().resetScheduler();
 	}
 	
 	public static void registerClockView(TimeTriggered callee) {
 		clockCallback = callee;
 	}
 	
+	/**
+	 * Checkpoint is started on next run and finished when a non real-time source has no more packets
+	 * @param newCheckpoint or null
+	 */
+	public static void registerCheckpoint(Checkpoint newCheckpoint) {
+		checkpoint = newCheckpoint;
+	}
+	
+	/**
+	 * Not thread-safe, see getInstance()
+	 * @param timeout
+	 * @param callee
+	 */
 	public void registerTimeout( long timeout, TimeTriggered callee) {
 		TimerCallback oldT = timers.get( timeout );
 		TimerCallback newT = new TimerCallback( timeout, callee);
@@ -62,19 +103,77 @@ public class Scheduler {
 	}
 	
 	/**
-	 * invoke timerHandler on registered timeouts
+	 * Callee is invoked with the new time whenever all timers before it have been processed
+	 * by this scheduler. Tuples transferred afterwards do not have an earlier timestamp, except
+	 * for out-of-order packets.
+	 * @param callee
+	 */
+	public void registerWatermarkListener(TimeTriggered callee) {
+		watermarkListeners.add(callee);
+	}
+
+	/**
+	 * notify watermark listeners, if time has advanced
+	 * @param timestamp
+	 */
+	public void advanceWatermark(long timestamp) {
+		if (timestamp <= watermark) return;
+		watermark = timestamp;
+		for (int i = 0; i < watermarkListeners.size(); i++) {
+			watermarkListeners.get(i).handleTimerEvent(timestamp);
+		}
+	}
+
+	/**
+	 * Process timers before timestamp, then notify watermark listeners
+	 * @param timestamp
+	 */
+	public void advanceTo(long timestamp) {
+		processTimers(timestamp);
+		advanceWatermark(timestamp);
+	}
+
+	/**
+	 * A batch is passed to all sinks of the source before the next one is started. Operators
+	 * that release resources of tuples they have seen, e.g. packet buffers, have to wait for the
+	 * next batch, as sinks later in the chain may not have processed the batch yet.
+	 * @return nr of current batch, 0 if tuples are not passed in batches
+	 */
+	public long getBatchNr() {
+		return batchNr;
+	}
+
+	/**
+	 * @return earliest registered timeout, Long.MAX_VALUE if none
+	 */
+	public long getNextTimeout() {
+		if (timers.isEmpty()) return Long.MAX_VALUE;
+		return timers.firstKey();
+	}
+	
+	/**
+	 * invoke timerHandler on all timers registered for the earliest timeout
+	 * using the timeout as current time
+	 */
+	public void processNextTimeout() {
+		if (timers.isEmpty()) return;
+		long timeout = timers.firstKey();
+		TimerCallback next = timers.remove(timeout);
+		while (next != null){
+			next.callee.handleTimerEvent(timeout);
+			next = next.next;
+		}
+	}
+	
+	/**
+	 * invoke timerHandler on registered timeouts before timestamp in order,
+	 * each with its timeout as current time
 	 * 
 	 * @param timestamp
 	 */
 	public void processTimers( long timestamp) {
-		while ( !timers.isEmpty() && timers.firstKey() < timestamp){
-			long timeout = timers.firstKey();
-			TimerCallback next = timers.get(timeout);
-			while (next != null){
-				next.callee.handleTimerEvent(timestamp);
-				next = next.next;
-			}
-			timers.remove( timeout );
+		while (getNextTimeout() < timestamp) {
+			processNextTimeout();
 		}
 	}
 	
@@ -86,7 +185,12 @@ public class Scheduler {
 	public static void run(AbstractSource<? extends ITimeStampedObject> source) {
 
 		// reset all data
-		instance = null;
+		reset();
+		
+		// restore operator state
+		if (checkpoint != null) {
+			checkpoint.start();
+		}
 		
 		ITimeStampedObject packet;
 		AbstractSource<ITimeStampedObject> src2 = (AbstractSource<ITimeStampedObject>) source;
@@ -95,6 +199,7 @@ public class Scheduler {
 
 		if (source instanceof RealTime) {
 			RealTime realTimeSrc = (RealTime) source;
+			long clockTime = Long.MIN_VALUE;
 			while (!stop) {
 				if (realTimeSrc.ready()) {
 					packet = src2.next();
@@ -103,11 +208,16 @@ public class Scheduler {
 					
 					// process timeouts
 					long timestamp = packet.getTime();
-					Scheduler.getInstance().processTimers(timestamp);
+					Scheduler scheduler = Scheduler.getInstance();
+					while (scheduler.getNextTimeout() < timestamp) {
+						scheduler.processNextTimeout();
+					}
+					scheduler.advanceWatermark(timestamp);
 
 					// update clock
-					if (clockCallback != null) {
+					if (clockCallback != null && timestamp > clockTime) {
 						clockCallback.handleTimerEvent( timestamp );
+						clockTime = timestamp;
 					}
 					// simulate packet loss..
 					Random random = new Random();
@@ -118,8 +228,28 @@ public class Scheduler {
 						src2.transfer(packet, timestamp);
 					}
 				} else {
+					// no packets, process timeouts up to watermark
+					long watermark = realTimeSrc.getWatermark();
+					Scheduler scheduler = Scheduler.getInstance();
+					while (scheduler.getNextTimeout() < watermark) {
+						scheduler.processNextTimeout();
+					}
+					scheduler.advanceWatermark(watermark);
+					
+					// update clock
+					if (clockCallback != null && watermark > clockTime) {
+						clockCallback.handleTimerEvent( watermark );
+						clockTime = watermark;
+					}
+
+					// sleep until next timeout, but not longer than 100 ms
+					long sleepTime = 100;
+					long nextTimeout = scheduler.getNextTimeout();
+					if (watermark != Long.MIN_VALUE && nextTimeout != Long.MAX_VALUE && nextTimeout - watermark < sleepTime) {
+						sleepTime = Math.max( 10, nextTimeout - watermark);
+					}
 					try {
-						Thread.sleep(100);
+						Thread.sleep(sleepTime);
 					} catch (InterruptedException e) {
 						// TODO Auto-generated catch block
 						e.printStackTrace();
@@ -127,7 +257,7 @@ public class Scheduler {
 				}
 			}
 		} else {
-			long simulationTime = 0;
+			VirtualClock clock = new VirtualClock(clockCallback);
 			while (( packet = (ITimeStampedObject) src2.next()) != null && !stop) {
 				packetCounter++;
 				
@@ -135,39 +265,36 @@ public class Scheduler {
 				Random random = new Random();
 				if ( random.nextFloat() < packetloss) continue;
 
-				// process timeouts
 				long timestamp = packet.getTime();
 
-				// wait for packet time, if not batch processing
 				if (speed >= 0) {
-					int sleepTime = 20;
-					while (simulationTime < timestamp) {
-						try {
-							Thread.sleep(20);
-							simulationTime += sleepTime * speed;
-
-							// update clock
-							if (clockCallback != null) {
-								clockCallback.handleTimerEvent( simulationTime );
-							}
-							
-						} catch (InterruptedException e) {
-							// TODO Auto-generated catch block
-							e.printStackTrace();
-						}
+					// replay: jump from timer to timer until packet time, wait for wall clock if required
+					Scheduler scheduler = Scheduler.getInstance();
+					while (scheduler.getNextTimeout() < timestamp) {
+						clock.advanceTo( scheduler.getNextTimeout());
+						scheduler.processNextTimeout();
 					}
-				}
-				
-				Scheduler.getInstance().processTimers(timestamp);
+					clock.advanceTo(timestamp);
+					scheduler.advanceWatermark(timestamp);
+				} else {
+					// batch processing: process timeouts
+					Scheduler.getInstance().processTimers(timestamp);
+					Scheduler.getInstance().advanceWatermark(timestamp);
 
-				// update clock
-				if (clockCallback != null) {
-					clockCallback.handleTimerEvent( timestamp );
+					// update clock
+					if (clockCallback != null) {
+						clockCallback.handleTimerEvent( timestamp );
+					}
 				}
 	
 				// process packet
 				src2.transfer(packet, timestamp);
 			}
+			clock.flush();
+			// source completely processed, don't resume from snapshot
+			if (packet == null && checkpoint != null) {
+				checkpoint.finish();
+			}
 		}
 		stop = false;
 		long end = System.currentTimeMillis();
@@ -175,6 +302,76 @@ public class Scheduler {
 				+ packetCounter + " packets");
 	}
 
+	/**
+	 * Process all data of a non real-time source on the calling thread as fast as possible.
+	 * There is no clock view, checkpoint or packet loss. Timers are handled as in run(),
+	 * with their timeout as current time.
+	 * 
+	 * If batchSize > 1, packets are passed in batches. A batch ends before the next
+	 * registered timeout.
+	 * 
+	 * @param source
+	 * @return nr of packets
+	 */
+	@SuppressWarnings("unchecked")
+	public static int runBatch(AbstractSource<? extends ITimeStampedObject> source) {
+		reset();
+		ITimeStampedObject packet;
+		AbstractSource<ITimeStampedObject> src2 = (AbstractSource<ITimeStampedObject>) source;
+		Scheduler scheduler = getInstance();
+		int packetCounter = 0;
+		if (batchSize > 1) {
+			return runBatches(src2, scheduler);
+		}
+		while (( packet = src2.next()) != null) {
+			packetCounter++;
+			long timestamp = packet.getTime();
+			scheduler.advanceTo(timestamp);
+			src2.transfer(packet, timestamp);
+		}
+		return packetCounter;
+	}
+
+	private static int runBatches(AbstractSource<ITimeStampedObject> source, Scheduler scheduler) {
+		ITimeStampedObject batch[] = null;
+		long timestamps[] = new long[batchSize];
+		int n = 0;
+		int packetCounter = 0;
+		ITimeStampedObject packet;
+		while (( packet = source.next()) != null) {
+			packetCounter++;
+			long timestamp = packet.getTime();
+			if (n > 0 && (n == batchSize || scheduler.getNextTimeout() < timestamp
+					|| !batch.getClass().getComponentType().isInstance(packet))) {
+				scheduler.batchNr++;
+				source.transferBatch(batch, timestamps, n);
+				n = 0;
+			}
+			if (n == 0) {
+				scheduler.advanceTo(timestamp);
+				// array of packet class, as sinks may expect e.g. PacketTuple[]
+				if (batch == null || !batch.getClass().getComponentType().isInstance(packet)) {
+					batch = (ITimeStampedObject[]) Array.newInstance(packet.getClass(), batchSize);
+				}
+			}
+			batch[n] = packet;
+			timestamps[n] = timestamp;
+			n++;
+		}
+		if (n > 0) {
+			scheduler.batchNr++;
+			source.transferBatch(batch, timestamps, n);
+		}
+		return packetCounter;
+	}
+
+	/**
+	 * @return true, if stop() has been called during run()
+	 */
+	static boolean isStopping() {
+		return stop;
+	}
+
 	public static void stop() {
 		// TODO Auto-generated method stub
 		stop = true;
@@ -0,0 +1,77 @@
+package stream;
+
+import java.util.ArrayList;
+
+import util.SelfCheck;
+
+/**
+ * Self-check: timers fire in order with their deadline as current time, also in batch mode
+ * (speed < 0), where they got the time of the next packet before
+ * 
+ * @author mringwal
+ *
+ */
+public class SchedulerTest {
+
+	private static final long TIMES[] = { 0, 1000, 1000, 5000 };
+	/** with timers registered 1500 ms after each packet */
+	private static final String EXPECTED = "[packet 0, packet 1000, packet 1000, timer 1500, timer 2500, timer 2500, packet 5000]";
+
+	private static class Item implements ITimeStampedObject {
+		long time;
+
+		Item(long time) {
+			this.time = time;
+		}
+
+		public long getTime() {
+			return time;
+		}
+	}
+
+	private static class ItemSource extends AbstractSource<Item> {
+		private int next = 0;
+
+		public Item next() {
+			if (next == TIMES.length) return null;
+			return new Item(TIMES[next++]);
+		}
+	}
+
+	private static class Recorder extends AbstractSink<Item> implements TimeTriggered {
+		ArrayList<String> events = new ArrayList<String>();
+
+		public void process(Item o, int srcID, long timestamp) {
+			events.add("packet " + timestamp);
+			Scheduler.getInstance().registerTimeout(timestamp + 1500, this);
+		}
+
+		public void handleTimerEvent(long timestamp) {
+			events.add("timer " + timestamp);
+		}
+	}
+
+	private static void check(String name, Recorder recorder) {
+		SelfCheck.check( EXPECTED.equals(recorder.events.toString()), name + ": " + recorder.events);
+	}
+
+	public static void main(String[] args) {
+		float speed = Scheduler.speed;
+		Scheduler.speed = -1;
+
+		ItemSource source = new ItemSource();
+		Recorder recorder = new Recorder();
+		source.subscribe(recorder, 0);
+		Scheduler.run(source);
+		check("run", recorder);
+
+		source = new ItemSource();
+		recorder = new Recorder();
+		source.subscribe(recorder, 0);
+		Scheduler.runBatch(source);
+		check("runBatch", recorder);
+
+		Scheduler.speed = speed;
+		System.out.println("SchedulerTest: OK");
+	}
+}
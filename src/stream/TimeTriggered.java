@@ -1,5 +1,11 @@
 package stream;
 
+/**
+ * Callback for Scheduler timers. Timers must be registered on the thread that
+ * runs the graph, see Scheduler.getInstance()
+ *
+ * @author mringwal
+ */
 public abstract interface TimeTriggered {
 	public void handleTimerEvent(long timestamp);
 }
@@ -1,7 +1,11 @@
 package stream;
 
-public class Union<I> extends AbstractPipe<I, I> {
+public class Union<I> extends AbstractPipe<I, I> implements BatchSink<I> {
 	public void process(I o, int srcID, long timestamp) {
 		transfer( o, timestamp);
 	}
+
+	public void processBatch(I o[], long timestamps[], int n, int srcID) {
+		transferBatch( o, timestamps, n);
+	}
 }
@@ -0,0 +1,132 @@
+package stream;
+
+/**
+ * Clock for log replays.
+ * 
+ * The clock jumps from event to event. If a replay speed > 0 is requested,
+ * it waits until the wall clock catches up with the event time. With speed 0,
+ * the replay is paused until the speed is changed or the Scheduler is stopped.
+ * With speed < 0, it runs as fast as possible. The registered clock view is
+ * updated with at most FRAME_RATE updates per second.
+ * 
+ * @author mringwal
+ *
+ */
+public class VirtualClock {
+
+	/** max updates of the clock view per second */
+	public static int FRAME_RATE = 25;
+	
+	/** re-synchronize with wall clock, if replay is late by more than this */
+	private static final int MAX_LAG = 1000;
+	
+	private TimeTriggered clockView;
+	
+	private long time;
+	private boolean started = false;
+	private boolean anchored = false;
+	private long anchorTime;
+	private long anchorMillis;
+	private float anchorSpeed;
+	
+	private long lastFrameMillis = 0;
+	private long lastFrameTime = -1;
+	
+	/**
+	 * @param clockView receives time updates, may be null
+	 */
+	public VirtualClock(TimeTriggered clockView) {
+		this.clockView = clockView;
+	}
+
+	/**
+	 * @return current time of the virtual clock
+	 */
+	public long getTime() {
+		return time;
+	}
+	
+	/**
+	 * advance virtual clock to given time. 
+	 * 
+	 * @param timestamp
+	 */
+	public void advanceTo(long timestamp) {
+		if (!started) {
+			// start replay at first event
+			time = timestamp;
+			started = true;
+		}
+		// paused
+		while (Scheduler.speed == 0 && !Scheduler.isStopping()) {
+			anchored = false;
+			try {
+				Thread.sleep( 1000 / FRAME_RATE);
+			} catch (InterruptedException e) {
+				e.printStackTrace();
+			}
+		}
+		float speed = Scheduler.speed;
+		if (speed > 0) {
+			if (!anchored || speed != anchorSpeed) {
+				anchor(speed);
+			}
+			long due = anchorMillis + (long) ((timestamp - anchorTime) / speed);
+			long now = System.currentTimeMillis();
+			if (now - due > MAX_LAG) {
+				// we cannot keep up, don't try to catch up later
+				anchor(speed);
+			}
+			while (now < due) {
+				long frameMillis = 1000 / FRAME_RATE;
+				try {
+					Thread.sleep( Math.min( due - now, frameMillis ));
+				} catch (InterruptedException e) {
+					e.printStackTrace();
+				}
+				now = System.currentTimeMillis();
+				if (Scheduler.speed != anchorSpeed) {
+					// speed changed while waiting
+					time = Math.min( timestamp, anchorTime + (long) ((now - anchorMillis) * anchorSpeed));
+					anchor(Scheduler.speed);
+					advanceTo(timestamp);
+					return;
+				}
+				if (now < due) {
+					updateView( anchorTime + (long) ((now - anchorMillis) * anchorSpeed), now);
+				}
+			}
+		} else {
+			anchored = false;
+		}
+		if (timestamp > time) {
+			time = timestamp;
+		}
+		updateView( time, System.currentTimeMillis());
+	}
+
+	/**
+	 * show current time on clock view, regardless of frame rate
+	 */
+	public void flush() {
+		if (clockView != null && lastFrameTime != time) {
+			clockView.handleTimerEvent(time);
+			lastFrameTime = time;
+		}
+	}
+	
+	private void anchor(float speed) {
+		anchored = true;
+		anchorSpeed = speed;
+		anchorTime = time;
+		anchorMillis = System.currentTimeMillis();
+	}
+	
+	private void updateView(long viewTime, long now) {
+		if (clockView == null) return;
+		if (now - lastFrameMillis < 1000 / FRAME_RATE) return;
+		lastFrameMillis = now;
+		lastFrameTime = viewTime;
+		clockView.handleTimerEvent(viewTime);
+	}
+}
@@ -0,0 +1,270 @@
+package stream.tuple;
+
+import java.io.BufferedOutputStream;
+import java.io.BufferedWriter;
+import java.io.DataOutputStream;
+import java.io.IOException;
+import java.io.OutputStream;
+import java.io.Writer;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.ArrayBlockingQueue;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
+
+import stream.AbstractSink;
+
+/**
+ * Log tuples on a background thread
+ *
+ * process() only stores a copy of the tuple in a bounded queue. A writer thread
+ * formats the tuples and writes them with large buffered writes. If the queue
+ * is full, the tuple is dropped and counted, so the analysis thread never waits
+ * for the disk. This is meant for diagnostics. Loggers created as lossless, e.g.
+ * for the packet log, wait for space instead.
+ *
+ * If writing fails, the writer thread stops and all further tuples are dropped,
+ * so that lossless loggers do not block the analysis thread either.
+ *
+ * Text mode writes one line per tuple as returned by format(), which can be overridden.
+ * Binary mode writes the timestamp followed by the TupleCodec encoding.
+ *
+ * @author mringwal
+ *
+ */
+public class AsyncTupleLogger extends AbstractSink<Tuple> {
+
+	/** size of write buffer */
+	private static final int BUFFER_SIZE = 64 * 1024;
+
+	/** default nr of queued tuples */
+	public static final int DEFAULT_CAPACITY = 4096;
+
+	/** max wait for space in queue before checking the writer again */
+	private static final long WAIT_MILLIS = 100;
+
+	private static class Entry {
+		Tuple tuple;
+		long timestamp;
+	}
+
+	/** marks end of log */
+	private final Entry stopEntry = new Entry();
+
+	private ArrayBlockingQueue<Entry> queue;
+
+	private BufferedWriter textWriter;
+	private DataOutputStream binaryOut;
+	private TupleCodec codec;
+
+	private Thread writerThread;
+	private AtomicInteger dropped = new AtomicInteger();
+	/** writer thread stopped after an error */
+	private volatile boolean failed = false;
+	private boolean stopped = false;
+	private boolean lossless;
+
+	/**
+	 * Text log, drops tuples if queue is full
+	 * @param writer
+	 * @param capacity max nr of queued tuples
+	 */
+	public AsyncTupleLogger(Writer writer, int capacity) {
+		this(writer, capacity, false);
+	}
+
+	/**
+	 * Text log
+	 * @param writer
+	 * @param capacity max nr of queued tuples
+	 * @param lossless wait for space in queue instead of dropping tuples
+	 */
+	public AsyncTupleLogger(Writer writer, int capacity, boolean lossless) {
+		textWriter = new BufferedWriter(writer, BUFFER_SIZE);
+		init(capacity, lossless);
+	}
+
+	/**
+	 * Binary log, drops tuples if queue is full
+	 * @param out
+	 * @param capacity max nr of queued tuples
+	 */
+	public AsyncTupleLogger(OutputStream out, int capacity) {
+		this(out, capacity, false);
+	}
+
+	/**
+	 * Binary log
+	 * @param out
+	 * @param capacity max nr of queued tuples
+	 * @param lossless wait for space in queue instead of dropping tuples
+	 */
+	public AsyncTupleLogger(OutputStream out, int capacity, boolean lossless) {
+		binaryOut = new DataOutputStream(new BufferedOutputStream(out, BUFFER_SIZE));
+		codec = new TupleCodec();
+		init(capacity, lossless);
+	}
+
+	private void init(int capacity, boolean lossless) {
+		this.lossless = lossless;
+		queue = new ArrayBlockingQueue<Entry>(capacity);
+		writerThread = new Thread() {
+			public void run() {
+				writeLoop();
+			}
+		};
+		writerThread.setName("AsyncTupleLogger");
+		writerThread.setDaemon(true);
+		writerThread.start();
+	}
+
+	public void process(Tuple o, int srcID, long timestamp) {
+		if (failed) {
+			dropped.incrementAndGet();
+			return;
+		}
+		Entry entry = new Entry();
+		// tuples and packet buffers may be reused after process() returns
+		entry.tuple = o.copy();
+		entry.timestamp = timestamp;
+		if (lossless) {
+			try {
+				while (!queue.offer(entry, WAIT_MILLIS, TimeUnit.MILLISECONDS)) {
+					if (failed) {
+						dropped.incrementAndGet();
+						return;
+					}
+				}
+			} catch (InterruptedException e) {
+				dropped.incrementAndGet();
+			}
+		} else if (!queue.offer(entry)) {
+			dropped.incrementAndGet();
+		}
+	}
+
+	/**
+	 * Format log line (without newline). Called on the writer thread
+	 * @param tuple
+	 * @param timestamp
+	 * @return text
+	 */
+	protected String format(Tuple tuple, long timestamp) {
+		return "" + timestamp / 1000 + " -- " + tuple.toString();
+	}
+
+	/**
+	 * @return nr of tuples dropped as queue was full, as a lossless logger was interrupted
+	 * or as writing failed
+	 */
+	public int getDropped() {
+		return dropped.get();
+	}
+
+	/**
+	 * @return true, if writer thread stopped after an error
+	 */
+	public boolean hasFailed() {
+		return failed;
+	}
+
+	/**
+	 * Write remaining tuples and stop writer thread.
+	 * The underlying writer or stream is flushed but not closed
+	 */
+	public void stop() {
+		if (stopped) return;
+		stopped = true;
+		try {
+			while (!failed && !queue.offer(stopEntry, WAIT_MILLIS, TimeUnit.MILLISECONDS)) {
+			}
+			writerThread.join();
+		} catch (InterruptedException e) {
+			e.printStackTrace();
+		}
+		if (dropped.get() > 0) {
+			System.out.println("AsyncTupleLogger: dropped " + dropped.get() + " tuples");
+		}
+	}
+
+	/**
+	 * Write remaining tuples, stop writer thread and close underlying writer or stream
+	 */
+	public void close() {
+		stop();
+		try {
+			if (textWriter != null) {
+				textWriter.close();
+			} else {
+				binaryOut.close();
+			}
+		} catch (IOException e) {
+			e.printStackTrace();
+		}
+	}
+
+	private void writeLoop() {
+		ArrayList<Entry> batch = new ArrayList<Entry>();
+		// entries of batch written so far
+		int written = 0;
+		try {
+			while (true) {
+				// wait for first entry, then take all available
+				batch.add(queue.take());
+				queue.drainTo(batch);
+				for (written = 0; written < batch.size(); written++) {
+					Entry entry = batch.get(written);
+					if (entry == stopEntry) {
+						flush();
+						return;
+					}
+					write(entry);
+				}
+				batch.clear();
+				written = 0;
+				// idle: make log visible
+				if (queue.isEmpty()) {
+					flush();
+				}
+			}
+		} catch (InterruptedException e) {
+			e.printStackTrace();
+		} catch (IOException e) {
+			System.out.println("AsyncTupleLogger: write failed, dropping all further tuples: " + e.getMessage());
+		}
+		fail(batch.subList(written, batch.size()));
+	}
+
+	/**
+	 * writer thread stops: unblock producer and drop unwritten tuples
+	 * @param unwritten entries taken from queue
+	 */
+	private void fail(List<Entry> unwritten) {
+		failed = true;
+		ArrayList<Entry> entries = new ArrayList<Entry>(unwritten);
+		queue.drainTo(entries);
+		for (Entry entry : entries) {
+			if (entry != stopEntry) {
+				dropped.incrementAndGet();
+			}
+		}
+	}
+
+	private void write(Entry entry) throws IOException {
+		if (textWriter != null) {
+			textWriter.write(format(entry.tuple, entry.timestamp));
+			textWriter.newLine();
+		} else {
+			binaryOut.writeLong(entry.timestamp);
+			codec.writeValue(binaryOut, entry.tuple);
+		}
+	}
+
+	private void flush() throws IOException {
+		if (textWriter != null) {
+			textWriter.flush();
+		} else {
+			binaryOut.flush();
+		}
+	}
+}
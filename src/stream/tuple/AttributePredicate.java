@@ -21,6 +21,19 @@ public class AttributePredicate extends Predicate<Tuple> {
 		return packet.getAttribute(attribute).equals(attributeValue);
 	}
 	
+	@Override
+	public boolean isStateless() {
+		return true;
+	}
+
+	public TupleAttribute getAttribute() {
+		return attribute;
+	}
+
+	public Object getAttributeValue() {
+		return attributeValue;
+	}
+
 	TupleAttribute attribute;
 	Object attributeValue;
 }
@@ -0,0 +1,173 @@
+package stream.tuple;
+
+import java.util.ArrayList;
+import java.util.Random;
+
+import packetparser.DecodedPacket;
+import packetparser.PDL;
+import packetparser.PacketBufferPool;
+import packetparser.Parser;
+import stream.AbstractSink;
+import stream.AbstractSource;
+import stream.Filter;
+import stream.PipelineContext;
+import stream.Predicate;
+import stream.Scheduler;
+import util.SelfCheck;
+
+/**
+ * Self-check: a graph with stateful and stateless operators produces the same output
+ * with batches as with one tuple at a time
+ * 
+ * @author mringwal
+ *
+ */
+public class BatchTest {
+
+	private static final int PACKETS = 5000;
+	private static final int DUPLICATE_TIMEOUT = 500;
+
+	private static PDL parser;
+	private static byte raws[][] = new byte[PACKETS][];
+	private static long times[] = new long[PACKETS];
+
+	/** packets from the pool, as read from a log */
+	private static class PacketSource extends AbstractSource<PacketTuple> {
+		private int next = 0;
+
+		public PacketTuple next() {
+			if (next == PACKETS) return null;
+			byte buffer[] = PacketBufferPool.getInstance().acquire();
+			System.arraycopy(raws[next], 0, buffer, 0, raws[next].length);
+			DecodedPacket packet = DecodedPacket.createPacketFromPooledBuffer(parser, buffer, 0, raws[next].length);
+			PacketTuple tuple = new PacketTuple(packet, times[next]);
+			tuple.setDsnNode("dsn" + (next % 3));
+			next++;
+			return tuple;
+		}
+	}
+
+	/** records tuples as text, tuples are not kept */
+	private static class Recorder extends AbstractSink<Tuple> {
+		ArrayList<String> output = new ArrayList<String>();
+		private TupleAttribute attributes[];
+
+		Recorder(String... fields) {
+			attributes = new TupleAttribute[fields.length];
+			for (int i = 0; i < fields.length; i++) {
+				attributes[i] = new TupleAttribute(fields[i]);
+			}
+		}
+
+		public void process(Tuple o, int srcID, long timestamp) {
+			StringBuffer line = new StringBuffer();
+			line.append(timestamp);
+			for (TupleAttribute attribute : attributes) {
+				line.append(" " + o.getAttribute(attribute));
+			}
+			output.add(line.toString());
+		}
+	}
+
+	/**
+	 * basic packets: count 2, array[0] is the source, array[1] a sequence number. Duplicates
+	 * are received within DUPLICATE_TIMEOUT, retransmissions later
+	 */
+	private static void createPackets() {
+		Random random = new Random(1);
+		long time = 1000;
+		int seqNr = 0;
+		for (int i = 0; i < PACKETS; i++) {
+			time += random.nextInt(4) * random.nextInt(10);
+			int type = random.nextInt(10);
+			if (i > 0 && type < 3) {
+				raws[i] = raws[i - 1];
+			} else if (i > 100 && type == 3) {
+				raws[i] = raws[i - 100];
+			} else {
+				byte raw[] = new byte[7];
+				raw[0] = 2;
+				raw[2] = (byte) random.nextInt(5);
+				raw[3] = (byte) (seqNr >> 8);
+				raw[4] = (byte) seqNr;
+				raw[6] = (byte) random.nextInt(256);
+				seqNr++;
+				raws[i] = raw;
+			}
+			times[i] = time;
+		}
+	}
+
+	/**
+	 * @return outputs of graph
+	 */
+	private static Recorder[] run(int batchSize) {
+		PipelineContext previous = new PipelineContext("BatchTest" + batchSize).activate();
+		PacketSource source = new PacketSource();
+
+		// stateful predicate recycling packets, followed by timer driven operator
+		Filter<PacketTuple> distinct = new Filter<PacketTuple>(new DistinctInWindow(DUPLICATE_TIMEOUT));
+		source.subscribe(distinct, 0);
+		Recorder distinctOutput = new Recorder("array[0]", "array[1]");
+		distinct.subscribe(distinctOutput, 0);
+		Mapper mapper = new Mapper("BatchOut", "array[0]", "from", "array[1]", "nr", "count", "to");
+		distinct.subscribe(mapper, 0);
+		LinkMetricStore links = new LinkMetricStore(1000, "from", "to", "LinkCount", "count");
+		mapper.subscribe(links, 0);
+		Recorder linkOutput = new Recorder(LinkMetricStore.LINK_ID_FIELD, "count");
+		links.subscribe(linkOutput, 0);
+
+		// stateless filter and mapper, evaluated per batch
+		FusedPipe stateless = new FusedPipe();
+		stateless.addPredicate(new AttributePredicate("array[0]", 2));
+		stateless.addMapper(new Mapper("BatchOut", "array[0]", "from", "array[1]", "nr", "count", "to"));
+		source.subscribe(stateless, 0);
+		Recorder statelessOutput = new Recorder("from", "nr");
+		stateless.subscribe(statelessOutput, 0);
+
+		// stateful predicate in fused pipe
+		FusedPipe stateful = new FusedPipe();
+		stateful.addPredicate(new Predicate<Tuple>() {
+			private int counter = 0;
+			public boolean invoke(Tuple o, long timestamp) {
+				return counter++ % 3 == 0;
+			}
+		});
+		stateful.addMapper(new Mapper("BatchOut", "array[0]", "from", "array[1]", "nr", "count", "to"));
+		source.subscribe(stateful, 0);
+		Recorder statefulOutput = new Recorder("from", "nr");
+		stateful.subscribe(statefulOutput, 0);
+
+		Scheduler.batchSize = batchSize;
+		int packets = Scheduler.runBatch(source);
+		SelfCheck.check( packets == PACKETS, "nr of packets " + packets);
+		long batches = Scheduler.getInstance().getBatchNr();
+		SelfCheck.check( batchSize == 1 ? batches == 0 : batches > 1 && batches < PACKETS / 2, "nr of batches " + batches);
+		// expire all windows
+		Scheduler.getInstance().advanceTo(times[PACKETS - 1] + 10 * DUPLICATE_TIMEOUT);
+		Scheduler.batchSize = 1;
+		previous.activate();
+		return new Recorder[] { distinctOutput, linkOutput, statelessOutput, statefulOutput };
+	}
+
+	public static void main(String[] args) {
+		parser = Parser.readDescription("packetdefinitions/test.h");
+		createPackets();
+		Recorder single[] = run(1);
+		Recorder batched[] = run(Scheduler.DEFAULT_BATCH_SIZE);
+		String names[] = { "distinct", "link", "stateless", "stateful" };
+		for (int i = 0; i < single.length; i++) {
+			ArrayList<String> expected = single[i].output;
+			ArrayList<String> output = batched[i].output;
+			SelfCheck.check( expected.size() > 0, "no " + names[i] + " output");
+			SelfCheck.check( expected.size() == output.size(), names[i] + " output has " + output.size()
+					+ " tuples instead of " + expected.size());
+			for (int j = 0; j < expected.size(); j++) {
+				SelfCheck.check( expected.get(j).equals(output.get(j)), names[i] + " output " + j + ": "
+						+ output.get(j) + " instead of " + expected.get(j));
+			}
+		}
+		SelfCheck.check( single[0].output.size() < PACKETS * 9 / 10, "no duplicates dropped");
+		System.out.println("BatchTest: OK");
+	}
+}
@@ -0,0 +1,330 @@
+package stream.tuple;
+
+import java.io.ByteArrayInputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.zip.DataFormatException;
+import java.util.zip.Inflater;
+
+import packetparser.DecodedPacket;
+import packetparser.PDL;
+import packetparser.PacketBufferPool;
+import packetparser.PacketTemplate;
+import stream.AbstractSource;
+import stream.Checkpointable;
+
+/**
+ * Read packets from a compressed capture file written by CaptureWriter
+ *
+ * The block index at the end of the file allows to seek to a point in time and to
+ * restore a checkpoint without decoding earlier blocks. If the index is missing,
+ * e.g. because the writer did not terminate properly, the block headers are scanned
+ * instead.
+ *
+ * @author mringwal
+ *
+ */
+public class CaptureReader extends AbstractSource<PacketTuple> implements Checkpointable {
+
+	private RandomAccessFile file;
+	private PDL parser;
+	private int packetsRead = 0;
+	/** packet returned by next() has not been transferred yet */
+	private boolean inFlight = false;
+
+	/** min time, max time, offset, packets */
+	private ArrayList<long[]> index = new ArrayList<long[]>();
+	private int nextBlock = 0;
+
+	/** current block */
+	private byte block[];
+	private int position;
+	private int remaining = 0;
+	private String dsnNodes[];
+	private PacketTemplate templates[];
+	private long lastTimes[];
+	private HashMap<Long, byte[]> previous = new HashMap<Long, byte[]>();
+
+	/** first packet after seek */
+	private PacketTuple pending = null;
+
+	public CaptureReader(String fileName, PDL parser) throws IOException {
+		this.parser = parser;
+		file = new RandomAccessFile(fileName, "r");
+		if (file.length() < 8 || file.readInt() != CaptureWriter.MAGIC) {
+			throw new IOException("CaptureReader: " + fileName + " is not a capture file");
+		}
+		if (file.readInt() != CaptureWriter.VERSION) {
+			throw new IOException("CaptureReader: unsupported version of " + fileName);
+		}
+		if (!readIndex()) {
+			scanBlocks();
+		}
+	}
+
+	public PacketTuple next() {
+		PacketTuple packet = pending;
+		pending = null;
+		if (packet == null) {
+			try {
+				packet = readPacket(true);
+			} catch (IOException e) {
+				e.printStackTrace();
+			}
+		}
+		inFlight = packet != null;
+		return packet;
+	}
+
+	/**
+	 * The packet returned by next() counts as processed once it has been transferred
+	 */
+	public void transfer(PacketTuple o, long timestamp) {
+		inFlight = false;
+		super.transfer(o, timestamp);
+	}
+
+	/**
+	 * Continue reading with the first packet at or after time - warmup
+	 * @param time in ms
+	 * @param warmup in ms
+	 * @throws IOException
+	 */
+	public void seek(long time, long warmup) throws IOException {
+		long start = time - warmup;
+		pending = null;
+		inFlight = false;
+		remaining = 0;
+		packetsRead = 0;
+		nextBlock = index.size();
+		for (int i = 0; i < index.size(); i++) {
+			long entry[] = index.get(i);
+			if (entry[1] >= start) {
+				nextBlock = i;
+				break;
+			}
+			packetsRead += (int) entry[3];
+		}
+		PacketTuple packet;
+		while ((packet = readPacket(true)) != null) {
+			if (packet.getTime() >= start) {
+				pending = packet;
+				break;
+			}
+			packet.getPacket().recycle();
+		}
+	}
+
+	/**
+	 * @return time of first and last packet, null if capture is empty
+	 */
+	public long[] getTimeRange() {
+		if (index.size() == 0) return null;
+		long range[] = { Long.MAX_VALUE, Long.MIN_VALUE };
+		for (long entry[] : index) {
+			range[0] = Math.min(range[0], entry[0]);
+			range[1] = Math.max(range[1], entry[1]);
+		}
+		return range;
+	}
+
+	/**
+	 * @return nr of blocks
+	 */
+	public int getNrBlocks() {
+		return index.size();
+	}
+
+	public void close() {
+		try {
+			file.close();
+		} catch (IOException e) {
+			e.printStackTrace();
+		}
+	}
+
+	/**
+	 * Store number of packets processed. Neither the packet found by seek() nor a packet
+	 * returned by next() but not transferred yet, e.g. when a timer takes the checkpoint,
+	 * has been seen by the operators
+	 */
+	public void saveState(DataOutputStream out) throws IOException {
+		out.writeInt(pending != null || inFlight ? packetsRead - 1 : packetsRead);
+	}
+
+	/**
+	 * Skip packets read before checkpoint, whole blocks are skipped using the index
+	 */
+	public void restoreState(DataInputStream in, long timeShift) throws IOException {
+		int position = in.readInt();
+		pending = null;
+		inFlight = false;
+		remaining = 0;
+		packetsRead = 0;
+		nextBlock = 0;
+		while (nextBlock < index.size() && packetsRead + index.get(nextBlock)[3] <= position) {
+			packetsRead += (int) index.get(nextBlock)[3];
+			nextBlock++;
+		}
+		while (packetsRead < position && readPacket(false) != null) {
+		}
+	}
+
+	/**
+	 * @param decode create packet tuple, otherwise only update delta state
+	 * @return next packet or null at end of file
+	 */
+	private PacketTuple readPacket(boolean decode) throws IOException {
+		while (remaining == 0) {
+			if (nextBlock >= index.size()) return null;
+			readBlock(index.get(nextBlock++));
+		}
+		remaining--;
+		packetsRead++;
+
+		int dsnID = readVarInt();
+		long time = lastTimes[dsnID] + CaptureWriter.unzigzag(readVarLong());
+		lastTimes[dsnID] = time;
+		int templateID = readVarInt();
+		int source = (int) CaptureWriter.unzigzag(readVarLong());
+		int length = readVarInt();
+
+		Long key = CaptureWriter.getContext(templateID, source);
+		byte last[] = previous.get(key);
+		byte raw[] = (last != null && last.length == length) ? last : new byte[length];
+		for (int i = 0; i < length; i++) {
+			if (last != null && i < last.length) {
+				raw[i] = (byte) (block[position++] ^ last[i]);
+			} else {
+				raw[i] = block[position++];
+			}
+		}
+		if (raw != last) {
+			previous.put(key, raw);
+		}
+		if (!decode) return null;
+
+		byte buffer[] = PacketBufferPool.getInstance().acquire();
+		System.arraycopy(raw, 0, buffer, 0, length);
+		DecodedPacket packet;
+		if (templates[templateID] != null) {
+			packet = DecodedPacket.createPacketFromPooledBuffer(templates[templateID], buffer, 0, length);
+		} else {
+			// packet definition changed since capture
+			packet = DecodedPacket.createPacketFromPooledBuffer(parser, buffer, 0, length);
+		}
+		PacketTuple packetTuple = new PacketTuple(packet, time);
+		packetTuple.setDsnNode(dsnNodes[dsnID]);
+		return packetTuple;
+	}
+
+	private void readBlock(long entry[]) throws IOException {
+		file.seek(entry[2]);
+		int compressedLength = file.readInt();
+		int rawLength = file.readInt();
+		long firstTime = file.readLong();
+		file.readLong();
+		remaining = file.readInt();
+		byte compressed[] = new byte[compressedLength];
+		file.readFully(compressed);
+
+		block = new byte[rawLength];
+		Inflater inflater = new Inflater();
+		inflater.setInput(compressed);
+		try {
+			if (inflater.inflate(block) != rawLength) {
+				throw new IOException("CaptureReader: block at " + entry[2] + " truncated");
+			}
+		} catch (DataFormatException e) {
+			throw new IOException("CaptureReader: block at " + entry[2] + " corrupt");
+		} finally {
+			inflater.end();
+		}
+
+		position = 0;
+		dsnNodes = new String[readVarInt()];
+		for (int i = 0; i < dsnNodes.length; i++) {
+			dsnNodes[i] = readString();
+		}
+		templates = new PacketTemplate[readVarInt()];
+		for (int i = 0; i < templates.length; i++) {
+			templates[i] = parser.getTemplate(readString());
+		}
+
+		lastTimes = new long[dsnNodes.length];
+		for (int i = 0; i < lastTimes.length; i++) {
+			lastTimes[i] = firstTime;
+		}
+		previous.clear();
+	}
+
+	/**
+	 * @return true if index was found at end of file
+	 */
+	private boolean readIndex() throws IOException {
+		long length = file.length();
+		if (length < 8 + 4 + 8 + 4) return false;
+		file.seek(length - 12);
+		long indexOffset = file.readLong();
+		if (file.readInt() != CaptureWriter.TRAILER_MAGIC || indexOffset < 8 || indexOffset > length - 16) {
+			return false;
+		}
+		file.seek(indexOffset);
+		int entries = file.readInt();
+		for (int i = 0; i < entries; i++) {
+			index.add(new long[] { file.readLong(), file.readLong(), file.readLong(), file.readInt() });
+		}
+		return true;
+	}
+
+	/**
+	 * build index from block headers, ignoring a partially written block
+	 */
+	private void scanBlocks() throws IOException {
+		long length = file.length();
+		long offset = 8;
+		while (offset + CaptureWriter.BLOCK_HEADER_SIZE <= length) {
+			file.seek(offset);
+			int compressedLength = file.readInt();
+			file.readInt();
+			long firstTime = file.readLong();
+			long lastTime = file.readLong();
+			int packets = file.readInt();
+			long next = offset + CaptureWriter.BLOCK_HEADER_SIZE + compressedLength;
+			if (compressedLength < 0 || next > length) break;
+			// first time of block is not necessarily the minimum, keep seek conservative
+			index.add(new long[] { Math.min(firstTime, lastTime), lastTime, offset, packets });
+			offset = next;
+		}
+		System.out.println("CaptureReader: no block index, found " + index.size() + " blocks");
+	}
+
+	/**
+	 * @return string written by DataOutputStream.writeUTF
+	 */
+	private String readString() throws IOException {
+		int length = ((block[position] & 0xff) << 8) | (block[position+1] & 0xff);
+		DataInputStream in = new DataInputStream(new ByteArrayInputStream(block, position, 2 + length));
+		position += 2 + length;
+		return in.readUTF();
+	}
+
+	private int readVarInt() {
+		return (int) readVarLong();
+	}
+
+	private long readVarLong() {
+		long value = 0;
+		int shift = 0;
+		while (true) {
+			int b = block[position++];
+			value |= (long) (b & 0x7f) << shift;
+			if ((b & 0x80) == 0) return value;
+			shift += 7;
+		}
+	}
+}
@@ -0,0 +1,195 @@
+package stream.tuple;
+
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.File;
+import java.io.RandomAccessFile;
+import java.util.Random;
+
+import packetparser.DecodedPacket;
+import packetparser.PDL;
+import packetparser.Parser;
+import util.SelfCheck;
+
+/**
+ * Self-check: CaptureWriter/CaptureReader round-trip, seek, checkpoint and missing block index
+ * 
+ * @author mringwal
+ *
+ */
+public class CaptureTest {
+
+	/** more than two blocks */
+	private static final int PACKETS = 2 * CaptureWriter.BLOCK_PACKETS + 1808;
+	private static final int DSN_NODES = 3;
+
+	private static byte raws[][] = new byte[PACKETS][];
+	private static long times[] = new long[PACKETS];
+	private static String dsnNodes[] = new String[PACKETS];
+	private static PDL parser;
+
+	/**
+	 * basic packet: count, array[count], crc. array[0] is the source, array[1] a counter
+	 */
+	private static void createPackets() {
+		Random random = new Random(1);
+		for (int i = 0; i < PACKETS; i++) {
+			int count = 2 + i % 4;
+			byte raw[] = new byte[1 + 2 * count + 2];
+			raw[0] = (byte) count;
+			raw[2] = (byte) (i % 5);
+			raw[3] = (byte) (i >> 8);
+			raw[4] = (byte) i;
+			for (int j = 5; j < raw.length; j++) {
+				raw[j] = (byte) random.nextInt(4);
+			}
+			raws[i] = raw;
+			// roughly ordered, DSN nodes report with different delays
+			times[i] = 1000000 + i * 10 + (i % 7) * 3 - (i % DSN_NODES) * 20;
+			dsnNodes[i] = "dsn" + (i % DSN_NODES);
+		}
+	}
+
+	private static void checkPacket(PacketTuple tuple, int nr) {
+		SelfCheck.check( tuple != null, "packet " + nr + " missing");
+		DecodedPacket packet = tuple.getPacket();
+		SelfCheck.check( tuple.getTime() == times[nr], "time of packet " + nr);
+		SelfCheck.check( dsnNodes[nr].equals(tuple.getDsnNode()), "dsn node of packet " + nr);
+		SelfCheck.check( packet.getTemplate() == parser.getDefaultPacket(), "template of packet " + nr);
+		byte raw[] = packet.getRaw();
+		SelfCheck.check( raw.length == raws[nr].length, "length of packet " + nr);
+		for (int i = 0; i < raw.length; i++) {
+			SelfCheck.check( raw[i] == raws[nr][i], "byte " + i + " of packet " + nr);
+		}
+		SelfCheck.check( tuple.getIntAttribute("array[0]") == nr % 5, "field of packet " + nr);
+		packet.recycle();
+	}
+
+	/**
+	 * @return nr of first packet at or after start read by seek()
+	 */
+	private static int expectedSeek(long start) {
+		for (int block = 0; block * CaptureWriter.BLOCK_PACKETS < PACKETS; block++) {
+			int first = block * CaptureWriter.BLOCK_PACKETS;
+			int end = Math.min(PACKETS, first + CaptureWriter.BLOCK_PACKETS);
+			long maxTime = Long.MIN_VALUE;
+			for (int i = first; i < end; i++) {
+				maxTime = Math.max(maxTime, times[i]);
+			}
+			if (maxTime < start) continue;
+			for (int i = first; i < end; i++) {
+				if (times[i] >= start) return i;
+			}
+		}
+		return -1;
+	}
+
+	private static void checkSeek(CaptureReader reader, long time, long warmup) throws Exception {
+		reader.seek(time, warmup);
+		int nr = expectedSeek(time - warmup);
+		if (nr < 0) {
+			SelfCheck.check( reader.next() == null, "packet after seek(" + time + ", " + warmup + ")");
+			return;
+		}
+		for (int i = nr; i < Math.min(PACKETS, nr + 10); i++) {
+			checkPacket(reader.next(), i);
+		}
+	}
+
+	/**
+	 * @return next packet, after passing it on as the Scheduler does
+	 */
+	private static PacketTuple transferNext(CaptureReader reader) {
+		PacketTuple tuple = reader.next();
+		reader.transfer(tuple, tuple.getTime());
+		return tuple;
+	}
+
+	private static CaptureReader checkpointRoundTrip(CaptureReader reader, String fileName) throws Exception {
+		ByteArrayOutputStream state = new ByteArrayOutputStream();
+		reader.saveState(new DataOutputStream(state));
+		reader.close();
+		CaptureReader restored = new CaptureReader(fileName, parser);
+		restored.restoreState(new DataInputStream(new ByteArrayInputStream(state.toByteArray())), 0);
+		return restored;
+	}
+
+	public static void main(String[] args) throws Exception {
+		parser = Parser.readDescription("packetdefinitions/test.h");
+		createPackets();
+
+		File captureFile = File.createTempFile("CaptureTest", CaptureWriter.SUFFIX);
+		captureFile.deleteOnExit();
+		String fileName = captureFile.getPath();
+		CaptureWriter writer = new CaptureWriter(fileName, "array[0]");
+		for (int i = 0; i < PACKETS; i++) {
+			PacketTuple tuple = new PacketTuple(DecodedPacket.createPacketFromBuffer(parser, raws[i]), times[i]);
+			tuple.setDsnNode(dsnNodes[i]);
+			writer.process(tuple, 0, times[i]);
+		}
+		writer.close();
+		SelfCheck.check( captureFile.length() < PACKETS * 8, "capture not compressed: " + captureFile.length() + " bytes");
+
+		// round-trip
+		CaptureReader reader = new CaptureReader(fileName, parser);
+		SelfCheck.check( reader.getNrBlocks() == 3, "nr of blocks " + reader.getNrBlocks());
+		long range[] = reader.getTimeRange();
+		long minTime = Long.MAX_VALUE;
+		long maxTime = Long.MIN_VALUE;
+		for (int i = 0; i < PACKETS; i++) {
+			minTime = Math.min(minTime, times[i]);
+			maxTime = Math.max(maxTime, times[i]);
+		}
+		SelfCheck.check( range[0] == minTime && range[1] == maxTime, "time range");
+		for (int i = 0; i < PACKETS; i++) {
+			checkPacket(reader.next(), i);
+		}
+		SelfCheck.check( reader.next() == null, "packet after end of capture");
+
+		// seek within blocks, at block borders, before start and behind end
+		checkSeek(reader, times[5000], 0);
+		checkSeek(reader, times[1234], 0);
+		checkSeek(reader, times[CaptureWriter.BLOCK_PACKETS], 0);
+		checkSeek(reader, times[9000], 5000);
+		checkSeek(reader, 0, 0);
+		checkSeek(reader, maxTime + 1, 0);
+
+		// checkpoint in the middle of a block and right after seek
+		reader.seek(0, 0);
+		for (int i = 0; i < 5000; i++) {
+			transferNext(reader).getPacket().recycle();
+		}
+		reader = checkpointRoundTrip(reader, fileName);
+		checkPacket(reader.next(), 5000);
+		reader.seek(times[7000], 0);
+		reader = checkpointRoundTrip(reader, fileName);
+		int nr = expectedSeek(times[7000]);
+		checkPacket(reader.next(), nr);
+		reader.seek(times[7000], 0);
+		checkPacket(transferNext(reader), nr);
+		reader = checkpointRoundTrip(reader, fileName);
+		checkPacket(reader.next(), nr + 1);
+		// packet not transferred yet, e.g. checkpoint taken by a timer
+		reader = checkpointRoundTrip(reader, fileName);
+		checkPacket(reader.next(), nr + 1);
+		reader.close();
+
+		// writer did not terminate: drop index and part of the last block
+		long indexSize = 4 + 3 * (8 + 8 + 8 + 4) + 8 + 4;
+		RandomAccessFile file = new RandomAccessFile(captureFile, "rw");
+		file.setLength(file.length() - indexSize - 1);
+		file.close();
+		reader = new CaptureReader(fileName, parser);
+		SelfCheck.check( reader.getNrBlocks() == 2, "nr of scanned blocks " + reader.getNrBlocks());
+		for (int i = 0; i < 2 * CaptureWriter.BLOCK_PACKETS; i++) {
+			checkPacket(reader.next(), i);
+		}
+		SelfCheck.check( reader.next() == null, "packet from partial block");
+		reader.close();
+
+		captureFile.delete();
+		System.out.println("CaptureTest: OK");
+	}
+}
@@ -0,0 +1,274 @@
+package stream.tuple;
+
+import java.io.BufferedOutputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.DataOutputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.zip.Deflater;
+
+import packetparser.DecodedPacket;
+import packetparser.PDL;
+import packetparser.Parser;
+import stream.AbstractSink;
+
+/**
+ * Write packets to a compressed capture file, read by CaptureReader
+ *
+ * Packets are collected in blocks of BLOCK_PACKETS packets. Each block can be decoded on
+ * its own: it starts with dictionaries for the DSN node names and the names of the resolved
+ * packet templates used in the block. For each packet, the timestamp is stored as difference
+ * to the previous packet of the same DSN node, and the payload is XORed with the previous
+ * packet with the same template and source. As most fields do not change, the result are
+ * mostly zeros, which are then removed by deflating the block.
+ *
+ * At the end of the file, an index with time range and file offset of all blocks is written.
+ *
+ * File:    MAGIC VERSION block* index-count (first last offset packets)* index-offset TRAILER_MAGIC
+ * Block:   compressed-length raw-length first-time last-time packets deflate(body)
+ * Body:    nr-dsn-nodes name* nr-templates name* packet*
+ * Packet:  dsn-node zigzag(time delta) template zigzag(source) length xor-payload
+ *
+ * @author mringwal
+ *
+ */
+public class CaptureWriter extends AbstractSink<PacketTuple> {
+
+	public static final String SUFFIX = ".snc";
+
+	static final int MAGIC = 0x534e5043; // "SNPC"
+	static final int TRAILER_MAGIC = 0x534e5049; // "SNPI"
+	static final int VERSION = 1;
+	/** compressed-length raw-length first-time last-time packets */
+	static final int BLOCK_HEADER_SIZE = 4 + 4 + 8 + 8 + 4;
+
+	/** nr of packets per block */
+	public static final int BLOCK_PACKETS = 4096;
+
+	private DataOutputStream out;
+	private long offset;
+	private TupleAttribute sourceAttribute = null;
+	private ArrayList<long[]> index = new ArrayList<long[]>();
+
+	/** current block */
+	private ByteArrayOutputStream records = new ByteArrayOutputStream();
+	private int packets = 0;
+	private long firstTime;
+	private long minTime;
+	private long maxTime;
+	private HashMap<String, Integer> dsnNodes = new HashMap<String, Integer>();
+	private ArrayList<String> dsnNodeNames = new ArrayList<String>();
+	private HashMap<String, Integer> templates = new HashMap<String, Integer>();
+	private ArrayList<String> templateNames = new ArrayList<String>();
+	private ArrayList<Long> lastTimes = new ArrayList<Long>();
+	private HashMap<Long, byte[]> previous = new HashMap<Long, byte[]>();
+
+	/**
+	 * @param fileName
+	 * @param sourceField packet field with node address used to find previous packet, or null
+	 * @throws IOException
+	 */
+	public CaptureWriter(String fileName, String sourceField) throws IOException {
+		out = new DataOutputStream(new BufferedOutputStream(new FileOutputStream(fileName), 64 * 1024));
+		if (sourceField != null) {
+			sourceAttribute = new TupleAttribute(sourceField);
+		}
+		out.writeInt(MAGIC);
+		out.writeInt(VERSION);
+		offset = 8;
+	}
+
+	public void process(PacketTuple o, int srcID, long timestamp) {
+		try {
+			DecodedPacket packet = o.getPacket();
+			if (packet == null) return;
+			long time = o.getTime();
+			if (packets == 0) {
+				firstTime = time;
+				minTime = time;
+				maxTime = time;
+			}
+			minTime = Math.min(minTime, time);
+			maxTime = Math.max(maxTime, time);
+
+			// time delta per DSN node
+			String dsnNode = o.getDsnNode() == null ? "" : o.getDsnNode();
+			Integer dsnID = dsnNodes.get(dsnNode);
+			if (dsnID == null) {
+				dsnID = dsnNodeNames.size();
+				dsnNodes.put(dsnNode, dsnID);
+				dsnNodeNames.add(dsnNode);
+				lastTimes.add(firstTime);
+			}
+			writeVarInt(records, dsnID);
+			writeVarLong(records, zigzag(time - lastTimes.get(dsnID)));
+			lastTimes.set(dsnID, time);
+
+			// template dictionary
+			String template = packet.getTemplate().getTypeName();
+			Integer templateID = templates.get(template);
+			if (templateID == null) {
+				templateID = templateNames.size();
+				templates.put(template, templateID);
+				templateNames.add(template);
+			}
+			writeVarInt(records, templateID);
+			int source = getSource(o);
+			writeVarLong(records, zigzag(source));
+
+			// payload XOR previous packet of same type and source
+			byte raw[] = o.getRaw();
+			writeVarInt(records, raw.length);
+			Long key = getContext(templateID, source);
+			byte last[] = previous.get(key);
+			for (int i = 0; i < raw.length; i++) {
+				if (last != null && i < last.length) {
+					records.write(raw[i] ^ last[i]);
+				} else {
+					records.write(raw[i]);
+				}
+			}
+			if (last != null && last.length == raw.length) {
+				System.arraycopy(raw, 0, last, 0, raw.length);
+			} else {
+				previous.put(key, raw.clone());
+			}
+
+			packets++;
+			if (packets == BLOCK_PACKETS) {
+				writeBlock();
+			}
+		} catch (IOException e) {
+			e.printStackTrace();
+		}
+	}
+
+	/**
+	 * write pending packets, index and close file
+	 */
+	public void close() {
+		try {
+			if (packets > 0) {
+				writeBlock();
+			}
+			long indexOffset = offset;
+			out.writeInt(index.size());
+			for (long entry[] : index) {
+				out.writeLong(entry[0]);
+				out.writeLong(entry[1]);
+				out.writeLong(entry[2]);
+				out.writeInt((int) entry[3]);
+			}
+			out.writeLong(indexOffset);
+			out.writeInt(TRAILER_MAGIC);
+			out.close();
+		} catch (IOException e) {
+			e.printStackTrace();
+		}
+	}
+
+	private int getSource(PacketTuple tuple) {
+		if (sourceAttribute == null) return 0;
+		Object value = tuple.getAttribute(sourceAttribute);
+		if (value instanceof Integer) {
+			return (Integer) value;
+		}
+		return 0;
+	}
+
+	static Long getContext(int templateID, int source) {
+		return ((long) templateID << 32) | (source & 0xffffffffL);
+	}
+
+	private void writeBlock() throws IOException {
+		ByteArrayOutputStream body = new ByteArrayOutputStream(records.size() + 1024);
+		DataOutputStream bodyOut = new DataOutputStream(body);
+		writeVarInt(body, dsnNodeNames.size());
+		for (String name : dsnNodeNames) {
+			bodyOut.writeUTF(name);
+		}
+		writeVarInt(body, templateNames.size());
+		for (String name : templateNames) {
+			bodyOut.writeUTF(name);
+		}
+		bodyOut.flush();
+		records.writeTo(body);
+
+		byte raw[] = body.toByteArray();
+		Deflater deflater = new Deflater();
+		deflater.setInput(raw);
+		deflater.finish();
+		ByteArrayOutputStream compressed = new ByteArrayOutputStream(raw.length / 4 + 64);
+		byte buffer[] = new byte[8192];
+		while (!deflater.finished()) {
+			int len = deflater.deflate(buffer);
+			compressed.write(buffer, 0, len);
+		}
+		deflater.end();
+
+		out.writeInt(compressed.size());
+		out.writeInt(raw.length);
+		out.writeLong(firstTime);
+		out.writeLong(maxTime);
+		out.writeInt(packets);
+		compressed.writeTo(out);
+		index.add(new long[] { minTime, maxTime, offset, packets });
+		offset += BLOCK_HEADER_SIZE + compressed.size();
+
+		// blocks are decoded independently
+		records.reset();
+		packets = 0;
+		dsnNodes.clear();
+		dsnNodeNames.clear();
+		templates.clear();
+		templateNames.clear();
+		lastTimes.clear();
+		previous.clear();
+	}
+
+	static long zigzag(long value) {
+		return (value << 1) ^ (value >> 63);
+	}
+
+	static long unzigzag(long value) {
+		return (value >>> 1) ^ -(value & 1);
+	}
+
+	static void writeVarInt(ByteArrayOutputStream out, int value) {
+		writeVarLong(out, value & 0xffffffffL);
+	}
+
+	static void writeVarLong(ByteArrayOutputStream out, long value) {
+		while ((value & ~0x7fL) != 0) {
+			out.write((int) ((value & 0x7f) | 0x80));
+			value >>>= 7;
+		}
+		out.write((int) value);
+	}
+
+	/**
+	 * convert text log into compressed capture
+	 * @param args pdl log capture [source field]
+	 */
+	public static void main(String args[]) throws Exception {
+		if (args.length < 3) {
+			System.out.println("Usage: CaptureWriter packetdefinition.h log_file capture" + SUFFIX + " [source field]");
+			return;
+		}
+		PDL parser = Parser.readDescription(args[0]);
+		LogReader reader = LogReader.createLogReaderFromFile(args[1]);
+		reader.setParser(parser);
+		CaptureWriter writer = new CaptureWriter(args[2], args.length > 3 ? args[3] : null);
+		PacketTuple packet;
+		int count = 0;
+		while ((packet = reader.next()) != null) {
+			writer.process(packet, 0, packet.getTime());
+			packet.getPacket().recycle();
+			count++;
+		}
+		writer.close();
+		System.out.println("CaptureWriter: " + count + " packets written to " + args[2]);
+	}
+}
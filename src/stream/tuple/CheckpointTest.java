@@ -0,0 +1,159 @@
+package stream.tuple;
+
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.File;
+import java.io.FileWriter;
+import java.io.IOException;
+import java.io.PrintWriter;
+
+import packetparser.DecodedPacket;
+import packetparser.PDL;
+import packetparser.Parser;
+import stream.AbstractSink;
+import stream.AbstractSource;
+import stream.Checkpoint;
+import stream.Checkpointable;
+import stream.Scheduler;
+import util.SelfCheck;
+import util.TimeIndex;
+
+/**
+ * Self-check: a run of Scheduler.run() interrupted and resumed from its checkpoint passes
+ * each packet exactly once to the operators, for LogReader and CaptureReader
+ * 
+ * @author mringwal
+ *
+ */
+public class CheckpointTest {
+
+	private static final int PACKETS = 3000;
+	private static final int STEP = 100;
+	private static final int INTERVAL = 1000;
+	/** interrupt first run after this nr of packets, not at a checkpoint */
+	private static final int STOP_AFTER = 1234;
+
+	/** operator expecting packets in order, stops the Scheduler after stopAfter packets */
+	private static class Counter extends AbstractSink<PacketTuple> implements Checkpointable {
+		int seen = 0;
+		int restored = -1;
+		private int stopAfter;
+
+		Counter(int stopAfter) {
+			this.stopAfter = stopAfter;
+		}
+
+		public void process(PacketTuple o, int srcID, long timestamp) {
+			int nr = o.getIntAttribute("array[0]");
+			SelfCheck.check( nr == seen, "got packet " + nr + " instead of " + seen);
+			o.getPacket().recycle();
+			seen++;
+			if (seen == stopAfter) {
+				Scheduler.stop();
+			}
+		}
+
+		public void saveState(DataOutputStream out) throws IOException {
+			out.writeInt(seen);
+		}
+
+		public void restoreState(DataInputStream in, long timeShift) throws IOException {
+			seen = in.readInt();
+			restored = seen;
+		}
+	}
+
+	/**
+	 * basic packet: count 2, array[0] is the packet nr
+	 */
+	private static byte[] createPacket(int nr) {
+		return new byte[] { 2, (byte) (nr >> 8), (byte) nr, 0, 0, 0, 0 };
+	}
+
+	private static void writeLog(File file) throws IOException {
+		PrintWriter out = new PrintWriter(new FileWriter(file));
+		for (int i = 0; i < PACKETS; i++) {
+			out.println((i * STEP) + " dsn0 data");
+			out.print("0000:");
+			for (byte value : createPacket(i)) {
+				out.print(" " + Integer.toHexString(value & 0xff));
+			}
+			out.println();
+			out.println();
+		}
+		out.close();
+	}
+
+	private static void writeCapture(File file, PDL parser) throws IOException {
+		CaptureWriter writer = new CaptureWriter(file.getPath(), null);
+		for (int i = 0; i < PACKETS; i++) {
+			PacketTuple tuple = new PacketTuple(DecodedPacket.createPacketFromBuffer(parser, createPacket(i)), i * STEP);
+			tuple.setDsnNode("dsn0");
+			writer.process(tuple, 0, i * STEP);
+		}
+		writer.close();
+	}
+
+	private static Counter run(AbstractSource<PacketTuple> source, Checkpointable position, File snapshot,
+			boolean resume, int stopAfter) {
+		Counter counter = new Counter(stopAfter);
+		source.subscribe(counter, 0);
+		Checkpoint checkpoint = new Checkpoint(snapshot.getPath(), INTERVAL, resume);
+		checkpoint.registerSource(position);
+		checkpoint.register("counter", counter);
+		Scheduler.registerCheckpoint(checkpoint);
+		try {
+			Scheduler.run(source);
+		} finally {
+			Scheduler.registerCheckpoint(null);
+		}
+		return counter;
+	}
+
+	private static void checkResume(String name, AbstractSource<PacketTuple> first, Checkpointable firstPosition,
+			AbstractSource<PacketTuple> second, Checkpointable secondPosition) throws IOException {
+		File snapshot = File.createTempFile("CheckpointTest", ".snapshot");
+		snapshot.delete();
+		snapshot.deleteOnExit();
+
+		Counter interrupted = run(first, firstPosition, snapshot, false, STOP_AFTER);
+		SelfCheck.check( interrupted.seen == STOP_AFTER, name + ": first run not stopped");
+		SelfCheck.check( snapshot.exists(), name + ": no snapshot after interrupted run");
+
+		Counter resumed = run(second, secondPosition, snapshot, true, -1);
+		SelfCheck.check( resumed.restored > 0 && resumed.restored < STOP_AFTER, name + ": restored "
+				+ resumed.restored + " packets");
+		SelfCheck.check( resumed.seen == PACKETS, name + ": " + resumed.seen + " packets after resume");
+		SelfCheck.check( !snapshot.exists(), name + ": snapshot not deleted after complete run");
+	}
+
+	public static void main(String[] args) throws Exception {
+		PDL parser = Parser.readDescription("packetdefinitions/test.h");
+		float speed = Scheduler.speed;
+		Scheduler.speed = -1;
+
+		File logFile = File.createTempFile("CheckpointTest", ".log");
+		logFile.deleteOnExit();
+		TimeIndex.getIndexFile(logFile).deleteOnExit();
+		writeLog(logFile);
+		LogReader first = LogReader.createLogReaderFromFile(logFile.getPath());
+		first.setParser(parser);
+		LogReader second = LogReader.createLogReaderFromFile(logFile.getPath());
+		second.setParser(parser);
+		checkResume("LogReader", first, first, second, second);
+
+		File captureFile = File.createTempFile("CheckpointTest", CaptureWriter.SUFFIX);
+		captureFile.deleteOnExit();
+		writeCapture(captureFile, parser);
+		CaptureReader firstCapture = new CaptureReader(captureFile.getPath(), parser);
+		CaptureReader secondCapture = new CaptureReader(captureFile.getPath(), parser);
+		checkResume("CaptureReader", firstCapture, firstCapture, secondCapture, secondCapture);
+		firstCapture.close();
+		secondCapture.close();
+
+		Scheduler.speed = speed;
+		logFile.delete();
+		captureFile.delete();
+		System.out.println("CheckpointTest: OK");
+	}
+}
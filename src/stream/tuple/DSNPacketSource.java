@@ -1,31 +1,265 @@
 package stream.tuple;
 
+import java.nio.ByteBuffer;
+import java.util.ArrayList;
+import java.util.HashMap;
 import java.util.TreeMap;
+import java.util.TreeSet;
 
 import dsn.DSNConnector;
 import dsn.PacketListener;
 import packetparser.DecodedPacket;
 import packetparser.PDL;
+import packetparser.PacketBufferPool;
 import stream.AbstractSource;
+import stream.Predicate;
 import stream.RealTime;
+import stream.Scheduler;
+import stream.TimeTriggered;
+import util.ClockSkewEstimator;
 
-public class DSNPacketSource extends AbstractSource<PacketTuple> implements RealTime, PacketListener {
+/**
+ * Real-time source for packets received from one or more DSN gateways
+ *
+ * Each gateway connection receives on its own thread. Packets of all gateways are merged
+ * by timestamp. The first gateway added is the time reference. Each other gateway has its
+ * own sniffer clock, its timestamps are mapped to the reference clock by an offset. The
+ * offset is estimated from the tick packets and data packets received: the sniffer time
+ * of the packet minus the current sniffer time of the reference, extrapolated from its
+ * last tick, gives a sample that is lower than the true offset by the transmission delay.
+ * The offset is the maximum of the last OFFSET_SAMPLES samples. Packets of other gateways
+ * are dropped until the reference gateway has sent a tick.
+ *
+ * In addition, offset and drift of each DSN node clock are estimated by a ClockSkewEstimator
+ * from packets overheard by several DSN nodes, and packet timestamps are corrected. The
+ * ticks of the reference gateway are fitted against the local clock to extrapolate the
+ * current sniffer time for the watermark. With more accurate timestamps, a shorter de-jitter
+ * delay can be used, see setDejitterDelay(), and the window for duplicates can be reduced,
+ * see getMaxClockError().
+ *
+ * The ingest queue is bounded by a high-water mark. If it is exceeded, the newest packet
+ * with the lowest priority is dropped: first duplicates of queued packets, i.e. the same
+ * packet overheard by several DSN nodes, then packets with the default PRIORITY_DATA, and
+ * then packets with the priorities given by setPriority(). Time ticks are never dropped.
+ * In blocking mode, the receive threads wait instead, so that e.g. a DSNReplayServer is
+ * slowed down over TCP.
+ *
+ * Every STATUS_INTERVAL ms, an "IngestStatus" tuple with queue depth, dropped packets and
+ * max lag of processing behind the sniffer clock is emitted on getStatusStream().
+ *
+ * @author mringwal
+ */
+public class DSNPacketSource extends AbstractSource<PacketTuple> implements RealTime, PacketListener, TimeTriggered {
+
+	/** default de-jitter delay in ms */
+	public static final int De_JITTER_DELAY = 5000;
+
+	/** nr of samples for gateway clock offset */
+	public static final int OFFSET_SAMPLES = 32;
+
+	/** default high-water mark of the ingest queue */
+	public static final int DEFAULT_CAPACITY = 20000;
+
+	/** duplicates of queued packets, dropped first */
+	public static final int PRIORITY_DUPLICATE = 0;
+	/** default priority */
+	public static final int PRIORITY_DATA = 1;
+	public static final int MAX_PRIORITY = 7;
+
+	/** interval of status tuples in ms */
+	public static final int STATUS_INTERVAL = 10000;
+
+	/** queue key = timestamp << SEQ_BITS | sequence nr, to keep packets with equal timestamps */
+	private static final int SEQ_BITS = 10;
+	private static final int SEQ_MASK = (1 << SEQ_BITS) - 1;
+
+	private static class QueueEntry {
+		PacketTuple tuple;
+		int priority;
+	}
+
+	/** clock of one gateway */
+	private static class Gateway {
+		/** sniffer time of gateway - sniffer time of reference gateway */
+		long offset;
+		long samples[] = new long[OFFSET_SAMPLES];
+		int nrSamples = 0;
+		int nextSample = 0;
+
+		void addSample(long sample) {
+			samples[nextSample] = sample;
+			nextSample = (nextSample + 1) % OFFSET_SAMPLES;
+			if (nrSamples < OFFSET_SAMPLES) {
+				nrSamples++;
+			}
+			offset = samples[0];
+			for (int i = 1; i < nrSamples; i++) {
+				offset = Math.max(offset, samples[i]);
+			}
+		}
+	}
+
+	/** first gateway is time reference */
+	private ArrayList<DSNConnector> gatewayList = new ArrayList<DSNConnector>();
+	private HashMap<DSNConnector, Gateway> gateways = new HashMap<DSNConnector, Gateway>();
 
-	private static final int De_JITTER_DELAY = 5000;
 	private PDL parser;
-	private TreeMap<Long,PacketTuple> packets = new TreeMap<Long,PacketTuple>(); 
+	private TreeMap<Long,QueueEntry> packets = new TreeMap<Long,QueueEntry>(); 
+	private int seqNr = 0;
+
+	/** ingest queue limit */
+	private int capacity = DEFAULT_CAPACITY;
+	private boolean blocking = false;
+	/** queue keys of droppable packets by priority */
+	private ArrayList<TreeSet<Long>> priorityClasses = new ArrayList<TreeSet<Long>>();
+	/** nr of queued copies of each packet */
+	private HashMap<DecodedPacket, Integer> queuedPackets = new HashMap<DecodedPacket, Integer>();
+	private ArrayList<Predicate<PacketTuple>> priorityPredicates = new ArrayList<Predicate<PacketTuple>>();
+	private ArrayList<Integer> priorities = new ArrayList<Integer>();
+
+	/** ingest status */
+	private int dropped = 0;
+	private int droppedDuplicates = 0;
+	private long maxLag = 0;
+	private boolean statusTimer = false;
+	private TupleAttribute queueDepthField = new TupleAttribute("queueDepth");
+	private TupleAttribute droppedField = new TupleAttribute("dropped");
+	private TupleAttribute droppedDuplicatesField = new TupleAttribute("droppedDuplicates");
+	private TupleAttribute lagField = new TupleAttribute("lag");
+	private int statusTupleTypeID;
+	private AbstractSource<Tuple> statusStream = new AbstractSource<Tuple>() {
+		public Tuple next() {
+			return null;
+		}
+	};
 	private boolean haveTime = false;
 
 	private long firstPacketMillis = 0;
 	private long refTimestamp = 0;
+	/** ratio of sniffer time to wall clock, > 1 for accelerated replays */
+	private float timeScale = 1;
+
+	/** time tick received from the reference gateway */
+	private boolean haveTick = false;
+	private ClockSkewEstimator clockSkew = new ClockSkewEstimator();
+	private int dejitterDelay = De_JITTER_DELAY;
+	
+	/** all packets older than watermark have been received */
+	private long watermark = Long.MIN_VALUE;
+	
 	/**
-	 * @param dsnConnection2
+	 * @param dsnConnection
 	 * @param parser
 	 */
 	public DSNPacketSource(DSNConnector dsnConnection, PDL parser) {
+		this(parser);
+		addGateway(dsnConnection);
+	}
+
+	/**
+	 * Source without gateway, use addGateway()
+	 * @param parser
+	 */
+	public DSNPacketSource(PDL parser) {
 		this.parser = parser;
+		for (int i = 0; i <= MAX_PRIORITY; i++) {
+			priorityClasses.add(new TreeSet<Long>());
+		}
+		statusTupleTypeID = Tuple.registerTupleType("IngestStatus", "queueDepth", "dropped", "droppedDuplicates", "lag");
+	}
+
+	/**
+	 * @param capacity high-water mark of ingest queue in packets
+	 * @param blocking wait for space instead of dropping packets
+	 */
+	public void setCapacity(int capacity, boolean blocking) {
+		synchronized (packets) {
+			this.capacity = capacity;
+			this.blocking = blocking;
+			packets.notifyAll();
+		}
+	}
+
+	/**
+	 * Packets matching predicate get priority, the first matching rule is used.
+	 * Predicates are invoked by the receive threads.
+	 * @param predicate
+	 * @param priority PRIORITY_DATA+1 .. MAX_PRIORITY, packets with lower priority are dropped first
+	 */
+	public void setPriority(Predicate<PacketTuple> predicate, int priority) {
+		if (priority <= PRIORITY_DATA || priority > MAX_PRIORITY) {
+			throw new RuntimeException("DSNPacketSource: priority " + priority + " out of range");
+		}
+		synchronized (priorityPredicates) {
+			priorityPredicates.add(predicate);
+			priorities.add(priority);
+		}
+	}
+
+	/**
+	 * @param dejitterDelay packets are passed on after this delay in ms, later packets are out of order
+	 */
+	public void setDejitterDelay(int dejitterDelay) {
+		synchronized (packets) {
+			this.dejitterDelay = dejitterDelay;
+		}
+	}
+
+	/**
+	 * @return true, once clocks of all gateways and DSN nodes are calibrated, see getMaxClockError()
+	 */
+	public boolean isClockCalibrated() {
+		synchronized (packets) {
+			return clockSkew.isCalibrated();
+		}
+	}
+
+	/**
+	 * @return max deviation of corrected timestamps of duplicates in ms
+	 */
+	public long getMaxClockError() {
+		synchronized (packets) {
+			return clockSkew.getMaxResidual();
+		}
+	}
+
+	/**
+	 * @return stream of "IngestStatus" tuples
+	 */
+	public AbstractSource<Tuple> getStatusStream() {
+		return statusStream;
+	}
+
+	/**
+	 * Merge packets received by the gateway. The first gateway is used as time reference
+	 * @param dsnConnection
+	 */
+	public void addGateway(DSNConnector dsnConnection) {
+		synchronized (packets) {
+			gatewayList.add(dsnConnection);
+			gateways.put(dsnConnection, new Gateway());
+		}
 		dsnConnection.registerPacketListener(this);
-		// start thread
+	}
+
+	/**
+	 * @param dsnConnection
+	 * @return sniffer time of gateway - sniffer time of reference gateway
+	 */
+	public long getGatewayOffset(DSNConnector dsnConnection) {
+		synchronized (packets) {
+			Gateway gateway = gateways.get(dsnConnection);
+			return gateway == null ? 0 : gateway.offset;
+		}
+	}
+
+	/**
+	 * Set ratio of sniffer time to wall clock time. Used when a log is replayed faster 
+	 * than real-time, e.g. by a DSNReplayServer
+	 * @param timeScale
+	 */
+	public void setTimeScale(float timeScale) {
+		this.timeScale = timeScale;
 	}
 
 	@Override
@@ -33,14 +267,38 @@ public class DSNPacketSource extends AbstractSource<PacketTuple> implements Real
 		PacketTuple packet;
 		synchronized (packets) {
 			long key = packets.firstKey();
-			// System.out.println("Packet Time: ("+key + ") " + (key - refTimestamp) );
-			packet = packets.get(key);
-			packets.remove(key);
+			// System.out.println("Packet Time: ("+key + ") " + ((key >> SEQ_BITS) - refTimestamp) );
+			QueueEntry entry = removeEntry(key);
+			packet = entry.tuple;
 			packet.setTime(packet.getTime() - refTimestamp);
+			maxLag = Math.max( maxLag, getSnifferTime() - packet.getTime());
+			if (blocking) {
+				packets.notifyAll();
+			}
+		}
+		if (!statusTimer) {
+			// timers are only available on scheduler thread
+			statusTimer = true;
+			Scheduler.getInstance().registerTimeout( packet.getTime() + STATUS_INTERVAL, this);
 		}
 		return packet;
 	}
 
+	public void handleTimerEvent(long timestamp) {
+		Tuple status = Tuple.createTuple(statusTupleTypeID);
+		synchronized (packets) {
+			status.setIntAttribute(queueDepthField, packets.size());
+			status.setIntAttribute(droppedField, dropped);
+			status.setIntAttribute(droppedDuplicatesField, droppedDuplicates);
+			status.setAttribute(lagField, maxLag);
+			dropped = 0;
+			droppedDuplicates = 0;
+			maxLag = 0;
+		}
+		statusStream.transfer(status, timestamp);
+		Scheduler.getInstance().registerTimeout( timestamp + STATUS_INTERVAL, this);
+	}
+
 	public boolean ready() {
 		if (haveTime == false )
 			return false;
@@ -49,38 +307,127 @@ public class DSNPacketSource extends AbstractSource<PacketTuple> implements Real
 			if (packets.isEmpty())
 				return false;
 
-			long key = packets.firstKey();
-			// time in simulation
-			long simulationTime = System.currentTimeMillis() - firstPacketMillis ; 
-			long packetTime = key - refTimestamp;
-			return (simulationTime - packetTime > De_JITTER_DELAY);
+			long packetTime = (packets.firstKey() >> SEQ_BITS) - refTimestamp;
+			return packetTime < updateWatermark();
+		}
+	}
+
+	public long getWatermark() {
+		if (haveTime == false)
+			return Long.MIN_VALUE;
+		
+		synchronized (packets) {
+			long currentWatermark = updateWatermark();
+			// don't pass packets which are still queued
+			if (!packets.isEmpty()) {
+				return Math.min( currentWatermark, (packets.firstKey() >> SEQ_BITS) - refTimestamp);
+			}
+			return currentWatermark;
+		}
+	}
+	
+	/**
+	 * current sniffer time relative to refTimestamp. Extrapolated from the 
+	 * time ticks, or from the local clock if no tick has been received yet
+	 */
+	private long getSnifferTime() {
+		if (haveTick) {
+			return getReferenceTime() - refTimestamp;
+		}
+		long now = System.currentTimeMillis();
+		return (long) ((now - firstPacketMillis) * timeScale);
+	}
+
+	/**
+	 * pre: lock on packets held, haveTick
+	 * @return current sniffer time of reference gateway
+	 */
+	private long getReferenceTime() {
+		return clockSkew.getReferenceTime( getScaledMillis());
+	}
+
+	/**
+	 * @return local clock at speed of sniffer clock
+	 */
+	private long getScaledMillis() {
+		return (long) (System.currentTimeMillis() * (double) timeScale);
+	}
+
+	/**
+	 * pre: lock on packets held
+	 * @return watermark, packets with an older timestamp are considered complete
+	 */
+	private long updateWatermark() {
+		long clockWatermark = getSnifferTime() - dejitterDelay;
+		if (clockWatermark > watermark) {
+			watermark = clockWatermark;
 		}
+		return watermark;
 	}
 
-	public void handlePacket(int len, byte[] data) {
+	public void handlePacket(DSNConnector dsnConnection, int len, byte[] data) {
 		// get timestamp and dns address
 		String btAddress = Integer.toHexString( unsigned16LE( data, 0));
 		long timestamp = (long) unsigned32LE( data, 6);
-		// strip header
-		byte[] packetRaw = new byte[len-11];
-		System.arraycopy(data, 11, packetRaw, 0, len-11);
+		boolean reference;
+		synchronized (packets) {
+			reference = gatewayList.isEmpty() || gatewayList.get(0) == dsnConnection;
+			if (!reference) {
+				if (!haveTick) {
+					// reference clock unknown
+					PacketBufferPool.getInstance().recycle(data);
+					return;
+				}
+				// map to reference clock
+				Gateway gateway = gateways.get(dsnConnection);
+				gateway.addSample(timestamp - getReferenceTime());
+				timestamp -= gateway.offset;
+			}
+		}
+		// strip header, packet refers to payload in receive buffer
 		DecodedPacket packet = null;
 		if (len > 11){
 			// if len <= 11 we just received a timestamp
-			packet = DecodedPacket.createPacketFromBuffer(parser, packetRaw);
+			packet = DecodedPacket.createPacketFromPooledBuffer(parser, data, 11, len-11);
+		} else {
+			PacketBufferPool.getInstance().recycle(data);
 		}
 		PacketTuple tuple = new PacketTuple(packet, timestamp);
 		tuple.setDsnNode(btAddress);
+		QueueEntry entry = new QueueEntry();
+		entry.tuple = tuple;
+		entry.priority = packet == null ? -1 : getPriority(tuple);
 		synchronized (packets) {
-			packets.put(timestamp, tuple);
+			while (blocking && packets.size() >= capacity) {
+				try {
+					packets.wait();
+				} catch (InterruptedException e) {
+					break;
+				}
+			}
+			if (packet != null) {
+				// correct node clock
+				// packet contents without copy. If the pooled buffer is recycled while it is kept
+				// for matching, the observation is not matched anymore, but still expired
+				clockSkew.addObservation(btAddress, timestamp, ByteBuffer.wrap(data, 11, len - 11));
+				tuple.setTime(clockSkew.correct(btAddress, timestamp));
+			} else if (reference) {
+				// time tick
+				haveTick = true;
+				clockSkew.addTick(btAddress, timestamp, getScaledMillis());
+			}
+			addEntry(entry);
+			if (packets.size() > capacity) {
+				shed();
+			}
 
 			// check for time
 			if (haveTime == false) {
 				if (firstPacketMillis == 0) {
 					firstPacketMillis = System.currentTimeMillis();
 				} else {
-					if (System.currentTimeMillis() - firstPacketMillis > De_JITTER_DELAY) {
-						refTimestamp = packets.firstKey();
+					if ((System.currentTimeMillis() - firstPacketMillis) * timeScale > dejitterDelay) {
+						refTimestamp = packets.firstKey() >> SEQ_BITS;
 						System.out.println("refTimestamp "+ refTimestamp);
 						haveTime = true;
 					}
@@ -89,6 +436,74 @@ public class DSNPacketSource extends AbstractSource<PacketTuple> implements Real
 		}		
 	}
 
+	/**
+	 * @return priority of packet by rules given by setPriority
+	 */
+	private int getPriority(PacketTuple tuple) {
+		synchronized (priorityPredicates) {
+			for (int i = 0; i < priorityPredicates.size(); i++) {
+				if (priorityPredicates.get(i).invoke(tuple, tuple.getTime())) {
+					return priorities.get(i);
+				}
+			}
+		}
+		return PRIORITY_DATA;
+	}
+
+	/**
+	 * pre: lock on packets held
+	 */
+	private void addEntry(QueueEntry entry) {
+		long key = (entry.tuple.getTime() << SEQ_BITS) | (seqNr++ & SEQ_MASK);
+		packets.put(key, entry);
+		DecodedPacket packet = entry.tuple.getPacket();
+		if (packet == null) return;
+		Integer copies = queuedPackets.get(packet);
+		if (copies == null) {
+			queuedPackets.put(packet, 1);
+		} else {
+			queuedPackets.put(packet, copies + 1);
+			entry.priority = PRIORITY_DUPLICATE;
+		}
+		priorityClasses.get(entry.priority).add(key);
+	}
+
+	/**
+	 * pre: lock on packets held
+	 */
+	private QueueEntry removeEntry(long key) {
+		QueueEntry entry = packets.remove(key);
+		DecodedPacket packet = entry.tuple.getPacket();
+		if (packet != null) {
+			priorityClasses.get(entry.priority).remove(key);
+			int copies = queuedPackets.get(packet);
+			if (copies == 1) {
+				queuedPackets.remove(packet);
+			} else {
+				queuedPackets.put(packet, copies - 1);
+			}
+		}
+		return entry;
+	}
+
+	/**
+	 * drop newest packet with lowest priority
+	 * pre: lock on packets held
+	 */
+	private void shed() {
+		for (int priority = 0; priority <= MAX_PRIORITY; priority++) {
+			TreeSet<Long> keys = priorityClasses.get(priority);
+			if (keys.isEmpty()) continue;
+			QueueEntry entry = removeEntry(keys.last());
+			entry.tuple.getPacket().recycle();
+			dropped++;
+			if (priority == PRIORITY_DUPLICATE) {
+				droppedDuplicates++;
+			}
+			return;
+		}
+	}
+
 	static private int unsignedByteToInt(byte value) {
 		if (value >= 0) return value;
 		return value+256;
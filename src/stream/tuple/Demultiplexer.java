@@ -0,0 +1,208 @@
+package stream.tuple;
+
+import java.util.ArrayList;
+import java.util.HashMap;
+
+import stream.AbstractPipe;
+import stream.Filter;
+import stream.Sink;
+
+/**
+ * Switch on a single tuple attribute
+ * 
+ * The attribute is read once per tuple and the tuple is passed on to the 
+ * sinks registered for its value via addCase(). Small integer values are looked
+ * up in an array, all others in a hash map. Tuples which don't match any case
+ * are passed on to the sinks subscribed with subscribe().
+ * 
+ * foldAttributeFilters() replaces adjacent sibling Filters with an AttributePredicate
+ * on the same attribute by a single Demultiplexer.
+ *
+ * @author mringwal
+ *
+ */
+public class Demultiplexer extends AbstractPipe<Tuple, Tuple> {
+
+	/** integer values in [0..MAX_ARRAY_VALUE[ are looked up in an array */
+	private static final int MAX_ARRAY_VALUE = 256;
+
+	/** sinks registered for a single value */
+	private static class Case {
+		Sink[] sinks = new Sink[0];
+		int[] sinkIDs = new int[0];
+		/** folded filters, forward to their sinks */
+		Filter[] filters = new Filter[0];
+
+		void add(Filter filter) {
+			Filter[] filtersTmp = new Filter[filters.length+1];
+			System.arraycopy(filters, 0, filtersTmp, 0, filters.length);
+			filtersTmp[filters.length] = filter;
+			filters = filtersTmp;
+		}
+
+		void add(Sink sink, int sinkID) {
+			Sink[] sinksTmp = new Sink[sinks.length+1];
+			int[] IDsTmp = new int[sinkIDs.length+1];
+			System.arraycopy(sinks, 0, sinksTmp, 0, sinks.length);
+			System.arraycopy(sinkIDs, 0, IDsTmp, 0, sinkIDs.length);
+			sinksTmp[sinks.length] = sink;
+			IDsTmp[sinks.length] = sinkID;
+			sinks = sinksTmp;
+			sinkIDs = IDsTmp;
+		}
+	}
+	
+	private TupleAttribute attribute;
+	
+	private Case[] smallCases = new Case[MAX_ARRAY_VALUE];
+	
+	private HashMap<Object, Case> otherCases = new HashMap<Object, Case>();
+	
+	/**
+	 * @param attributeName to switch on
+	 */
+	public Demultiplexer(String attributeName) {
+		this(new TupleAttribute(attributeName));
+	}
+
+	public Demultiplexer(TupleAttribute attribute) {
+		this.attribute = attribute;
+	}
+
+	/**
+	 * Pass tuples with attribute == value to sink
+	 * @param value
+	 * @param sink
+	 * @param sinkID
+	 */
+	public void addCase(Object value, Sink<? super Tuple> sink, int sinkID) {
+		getOrCreateCase(value).add(sink, sinkID);
+	}
+
+	/**
+	 * Pass tuples with attribute == value of filter to the current and future sinks of filter
+	 * @param filter with AttributePredicate on attribute
+	 */
+	public void addFoldedFilter(Filter filter) {
+		AttributePredicate predicate = (AttributePredicate) filter.getPredicate();
+		if (!predicate.getAttribute().equals(attribute)) {
+			throw new RuntimeException("Demultiplexer: filter on " + predicate.getAttribute().getName()
+					+ " cannot be folded into switch on " + attribute.getName());
+		}
+		getOrCreateCase(predicate.getAttributeValue()).add(filter);
+	}
+
+	private Case getOrCreateCase(Object value) {
+		Case theCase = getCase(value);
+		if (theCase == null) {
+			theCase = new Case();
+			if (isSmall(value)) {
+				smallCases[(Integer) value] = theCase;
+			} else {
+				otherCases.put(value, theCase);
+			}
+		}
+		return theCase;
+	}
+
+	public TupleAttribute getAttribute() {
+		return attribute;
+	}
+	
+	private static boolean isSmall(Object value) {
+		if (!(value instanceof Integer)) return false;
+		int intValue = (Integer) value;
+		return intValue >= 0 && intValue < MAX_ARRAY_VALUE;
+	}
+
+	private Case getCase(Object value) {
+		if (isSmall(value)) {
+			return smallCases[(Integer) value];
+		}
+		return otherCases.get(value);
+	}
+
+	@SuppressWarnings("unchecked")
+	public void process(Tuple o, int srcID, long timestamp) {
+		Case theCase = getCase(o.getAttribute(attribute));
+		if (theCase == null) {
+			transfer(o, timestamp);
+			return;
+		}
+		Sink[] caseSinks = theCase.sinks;
+		int[] caseIDs = theCase.sinkIDs;
+		for (int i = 0; i < caseSinks.length; i++) {
+			caseSinks[i].process(o, caseIDs[i], timestamp);
+		}
+		Filter[] caseFilters = theCase.filters;
+		for (int i = 0; i < caseFilters.length; i++) {
+			caseFilters[i].transfer(o, timestamp);
+		}
+	}
+
+	/**
+	 * Rewrite pass: fold adjacent Filters subscribed to source which test the same attribute
+	 * for equality into a Demultiplexer. Each folded Filter is registered as case for its value,
+	 * tuples are forwarded to its sinks without evaluating its predicate. This includes sinks
+	 * subscribed to the Filter later on. The Demultiplexer replaces the Filters at their position
+	 * in the sinks of source, so the order in which sinks see a tuple is not changed.
+	 * 
+	 * Filters fused into a FusedPipe, see GraphPlanner, are not Filters anymore and never folded.
+	 *  
+	 * @param source
+	 * @return nr of folded filters
+	 */
+	@SuppressWarnings("unchecked")
+	public static int foldAttributeFilters(AbstractPipe<?, ? extends Tuple> source) {
+		if (source.getSinks() == null) return 0;
+		AbstractPipe<?, Tuple> tupleSource = (AbstractPipe<?, Tuple>) source;
+		Sink[] sinks = source.getSinks();
+		
+		// find runs of adjacent equality filters on the same attribute
+		int folded = 0;
+		ArrayList<Filter> run = new ArrayList<Filter>();
+		TupleAttribute runAttribute = null;
+		for (int i = 0; i <= sinks.length; i++) {
+			TupleAttribute filterAttribute = null;
+			if (i < sinks.length) {
+				filterAttribute = getFilterAttribute(sinks[i]);
+			}
+			if (filterAttribute != null && filterAttribute.equals(runAttribute)) {
+				if (!run.contains(sinks[i])) {
+					run.add((Filter) sinks[i]);
+				}
+				continue;
+			}
+			if (run.size() >= 2) {
+				Demultiplexer demux = new Demultiplexer(runAttribute);
+				for (Filter filter : run) {
+					demux.addFoldedFilter(filter);
+				}
+				// demux takes position of first filter
+				tupleSource.replace(run.get(0), demux);
+				for (int j = 1; j < run.size(); j++) {
+					tupleSource.unsubscribe(run.get(j));
+				}
+				folded += run.size();
+				System.out.println("Demultiplexer: folded " + run.size() + " filters on " + runAttribute.getName());
+			}
+			run.clear();
+			runAttribute = filterAttribute;
+			if (filterAttribute != null) {
+				run.add((Filter) sinks[i]);
+			}
+		}
+		return folded;
+	}
+
+	/**
+	 * @param sink
+	 * @return attribute tested by an equality Filter, null for other sinks
+	 */
+	private static TupleAttribute getFilterAttribute(Sink sink) {
+		if (!(sink instanceof Filter)) return null;
+		Filter filter = (Filter) sink;
+		if (!(filter.getPredicate() instanceof AttributePredicate)) return null;
+		return ((AttributePredicate) filter.getPredicate()).getAttribute();
+	}
+}
@@ -1,8 +1,10 @@
 package stream.tuple;
 
+import java.util.ArrayList;
 import java.util.LinkedList;
 
 import stream.Predicate;
+import stream.Scheduler;
 
 
 /** 
@@ -14,6 +16,11 @@ import stream.Predicate;
  * implemenetation detail:
  * - all packets are kept in a linked list
  * - upon process(), packets older than duplicate_timeout are removed from list
+ * - packet buffers are recycled when packets are removed from the list or
+ *   when a duplicate was dropped. As other sinks of the same source may still
+ *   process a dropped duplicate, it is recycled on the next call
+ * - if packets are passed in batches, see Scheduler.getBatchNr(), buffers are
+ *   recycled with the next batch, after all sinks have processed the batch
  * 
  * @author mringwal
  *
@@ -25,6 +32,12 @@ public class DistinctInWindow extends Predicate<PacketTuple> {
 	
 	private LinkedList<PacketTuple> window = new LinkedList<PacketTuple>();
 	
+	private PacketTuple droppedDuplicate = null;
+
+	/** packets to recycle after batch has been processed */
+	private ArrayList<PacketTuple> pendingRecycle = new ArrayList<PacketTuple>();
+	private long pendingBatchNr = 0;
+	
 	private int duplicate_timeout;
 
 	private int item_counter = 0;
@@ -44,9 +57,25 @@ public class DistinctInWindow extends Predicate<PacketTuple> {
 	public boolean invoke(PacketTuple p, long timestamp) {
 		if (p == null) return false;
 
+		// release packets of previous batch
+		long batchNr = Scheduler.getInstance().getBatchNr();
+		if (batchNr != pendingBatchNr) {
+			for (int i = 0; i < pendingRecycle.size(); i++) {
+				recycle(pendingRecycle.get(i));
+			}
+			pendingRecycle.clear();
+			pendingBatchNr = batchNr;
+		}
+
+		// release last duplicate
+		if (droppedDuplicate != null) {
+			release(droppedDuplicate);
+			droppedDuplicate = null;
+		}
+		
 		// remove outdated elements
 		while (window.size()>0 && window.getFirst().time_ms < timestamp - duplicate_timeout) {
-			window.removeFirst();
+			release(window.removeFirst());
 		}
 		
 		item_counter++;
@@ -59,6 +88,7 @@ public class DistinctInWindow extends Predicate<PacketTuple> {
 				maxTimeBetweenDups = (int) (delta);
 			}
 			System.out.println("Dup, time="+delta+", max="+maxTimeBetweenDups+" old_t "+old.time_ms + ", new_t "+p.time_ms);
+			droppedDuplicate = p;
 			return false;
 		}
 
@@ -73,6 +103,41 @@ public class DistinctInWindow extends Predicate<PacketTuple> {
 		return true;
 	}
 
+	/**
+	 * @return time in ms within which equal packets are duplicates
+	 */
+	public int getDuplicateTimeout() {
+		return duplicate_timeout;
+	}
+
+	/**
+	 * Adapt window, e.g. to the clock error after timestamp correction
+	 * @param duplicate_timeout in ms
+	 */
+	public void setDuplicateTimeout(int duplicate_timeout) {
+		this.duplicate_timeout = duplicate_timeout;
+	}
+
+	/**
+	 * recycle packet now or, if in a batch, with the next batch
+	 */
+	private void release(PacketTuple p) {
+		if (pendingBatchNr != 0) {
+			pendingRecycle.add(p);
+		} else {
+			recycle(p);
+		}
+	}
+
+	/**
+	 * return packet buffer to pool
+	 */
+	private void recycle(PacketTuple p) {
+		if (p.getPacket() != null) {
+			p.getPacket().recycle();
+		}
+	}
+
 	public void dump() {
 		for (int i=0;i<dup_history.length;i++) {
 			System.out.println("value = " + i + ", count "+dup_history[i]);
@@ -0,0 +1,119 @@
+package stream.tuple;
+
+import java.lang.reflect.Array;
+import java.util.ArrayList;
+
+import stream.AbstractPipe;
+import stream.BatchAdapter;
+import stream.BatchSink;
+import stream.Predicate;
+
+/**
+ * Chain of stateless filters and mappers executed as a single operator
+ * 
+ * Each stage is either a Predicate or a Mapper. A tuple is passed through
+ * all stages without intermediate transfers. If a predicate fails, processing
+ * of the tuple stops.
+ * 
+ * @author mringwal
+ *
+ */
+public class FusedPipe extends AbstractPipe<Tuple, Tuple> implements BatchSink<Tuple> {
+
+	private ArrayList<Object> stageList = new ArrayList<Object>();
+	
+	private Predicate[] predicates = new Predicate[0];
+	private Mapper[] mappers = new Mapper[0];
+	private boolean hasMapper = false;
+	private boolean stateless = true;
+
+	/** batch buffers */
+	private Tuple[] passed;
+	private long[] passedTimestamps;
+	
+	/**
+	 * append filter stage
+	 * @param predicate
+	 */
+	public void addPredicate(Predicate<? extends Tuple> predicate) {
+		stageList.add(predicate);
+		updateStages();
+	}
+
+	/**
+	 * append map stage
+	 * @param mapper
+	 */
+	public void addMapper(Mapper mapper) {
+		stageList.add(mapper);
+		updateStages();
+	}
+	
+	public int getNrStages() {
+		return stageList.size();
+	}
+	
+	private void updateStages() {
+		int nrStages = stageList.size();
+		predicates = new Predicate[nrStages];
+		mappers = new Mapper[nrStages];
+		hasMapper = false;
+		stateless = true;
+		for (int i = 0; i < nrStages; i++) {
+			Object stage = stageList.get(i);
+			if (stage instanceof Predicate) {
+				predicates[i] = (Predicate) stage;
+				stateless &= predicates[i].isStateless();
+			} else {
+				mappers[i] = (Mapper) stage;
+				hasMapper = true;
+			}
+		}
+	}
+	
+	public void process(Tuple o, int srcID, long timestamp) {
+		o = apply(o, timestamp);
+		if (o != null) {
+			transfer(o, timestamp);
+		}
+	}
+
+	public void processBatch(Tuple o[], long timestamps[], int n, int srcID) {
+		if (!stateless) {
+			BatchAdapter.processEach(this, o, timestamps, n, srcID);
+			return;
+		}
+		if (passed == null || passed.length < n || (!hasMapper && passed.getClass() != o.getClass())) {
+			// without mappers, sinks may expect the input array type
+			passed = (Tuple[]) Array.newInstance(hasMapper ? Tuple.class : o.getClass().getComponentType(), n);
+			passedTimestamps = new long[n];
+		}
+		int count = 0;
+		for (int i = 0; i < n; i++) {
+			Tuple result = apply(o[i], timestamps[i]);
+			if (result != null) {
+				passed[count] = result;
+				passedTimestamps[count] = timestamps[i];
+				count++;
+			}
+		}
+		if (count > 0) {
+			transferBatch(passed, passedTimestamps, count);
+		}
+	}
+
+	/**
+	 * @return result of all stages, null if a predicate failed
+	 */
+	@SuppressWarnings("unchecked")
+	private Tuple apply(Tuple o, long timestamp) {
+		for (int i = 0; i < predicates.length; i++) {
+			if (predicates[i] != null) {
+				if (!predicates[i].invoke(o, timestamp)) return null;
+			} else {
+				o = mappers[i].map(o);
+			}
+		}
+		return o;
+	}
+}
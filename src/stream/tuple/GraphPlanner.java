@@ -0,0 +1,471 @@
+package stream.tuple;
+
+import java.io.BufferedReader;
+import java.io.File;
+import java.io.FileReader;
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.LinkedHashMap;
+import java.util.List;
+
+import packetparser.PDL;
+import packetparser.Parser;
+import stream.AbstractPipe;
+import stream.AsyncPipe;
+import stream.Filter;
+import stream.Predicate;
+import stream.Scheduler;
+import stream.Sink;
+import stream.Source;
+import stream.Union;
+
+/**
+ * Creates analysis graphs from graph definition files
+ *
+ * A graph definition contains one statement per line:
+ *
+ *   input packets
+ *   name = operator(arg, arg, ...) <- input[:srcID], input[:srcID] ...
+ *   output name
+ *
+ * Lines starting with '#' are comments. Inputs have to be defined before use.
+ * Inputs are global, all graphs declaring the same input share its source.
+ * Supported operators:
+ *
+ *   crc()                                     drop packets with invalid crc
+ *   distinct(timeout)                         drop duplicate packets
+ *   filter(attribute, value)                  attribute == value, value can be a PDL constant
+ *   nonzero(attribute)                        attribute != 0
+ *   map(type, from, to, ...)                  Mapper
+ *   extract(type, size, array, from, to, ...) ArrayExtractor
+ *   union()                                   merge inputs
+ *   count(window, groupField, type, result)   counter per group in time window
+ *   dump()                                    print tuples
+ *   async()                                   run following operators on own thread, see AsyncPipe
+ *
+ * Several graphs can be loaded into one planner. Their operator names are prefixed
+ * by the graph name, i.e. the file name without extension.
+ *
+ * Planning:
+ * - operators with identical type, arguments and (recursively) identical inputs
+ *   are created only once and shared among all graphs
+ * - chains of stateless operators (crc, filter, nonzero, map), where each but the last
+ *   has a single consumer and is not an output, are fused into one FusedPipe
+ * - remaining sibling filters on the same attribute are folded into a Demultiplexer
+ *
+ * @author mringwal
+ *
+ */
+public class GraphPlanner {
+
+	/** operator as defined in graph definition */
+	private static class OperatorDef {
+		String name;
+		String type;
+		String args[];
+		ArrayList<OperatorDef> inputs = new ArrayList<OperatorDef>();
+		ArrayList<Integer> inputIDs = new ArrayList<Integer>();
+		ArrayList<OperatorDef> consumers = new ArrayList<OperatorDef>();
+		String signature;
+		boolean exported = false;
+		/** chain this operator is part of */
+		ArrayList<OperatorDef> chain;
+		/** created operator */
+		Object operator;
+
+		boolean isInput() {
+			return type.equals("input");
+		}
+
+		boolean isStateless() {
+			return type.equals("crc") || type.equals("filter") || type.equals("nonzero") || type.equals("map");
+		}
+	}
+
+	private PDL parser;
+
+	/** all operators by qualified name */
+	private HashMap<String, OperatorDef> operators = new HashMap<String, OperatorDef>();
+
+	/** shared operators by signature in definition order */
+	private LinkedHashMap<String, OperatorDef> shared = new LinkedHashMap<String, OperatorDef>();
+
+	private HashMap<String, Source<?>> inputBindings = new HashMap<String, Source<?>>();
+
+	private int nrDefined = 0;
+
+	private boolean built = false;
+
+	public GraphPlanner(PDL parser) {
+		this.parser = parser;
+	}
+
+	/**
+	 * Load graph definition file
+	 * @param fileName
+	 * @throws IOException
+	 */
+	public void load(String fileName) throws IOException {
+		String graphName = new File(fileName).getName();
+		int dotPos = graphName.indexOf(".");
+		if (dotPos > 0) {
+			graphName = graphName.substring(0, dotPos);
+		}
+		BufferedReader reader = new BufferedReader(new FileReader(fileName));
+		String line;
+		int lineNr = 0;
+		try {
+			while ((line = reader.readLine()) != null) {
+				lineNr++;
+				line = line.trim();
+				if (line.length() == 0 || line.startsWith("#")) continue;
+				try {
+					parseStatement(graphName, line);
+				} catch (RuntimeException e) {
+					throw new IOException(fileName + ":" + lineNr + ": " + e.getMessage());
+				}
+			}
+		} finally {
+			reader.close();
+		}
+	}
+
+	private void parseStatement(String graphName, String line) {
+		if (line.startsWith("input ")) {
+			String name = line.substring(6).trim();
+			if (operators.containsKey(name)) return;
+			OperatorDef def = new OperatorDef();
+			def.name = name;
+			def.type = "input";
+			def.args = new String[0];
+			define(def);
+			return;
+		}
+		if (line.startsWith("output ")) {
+			resolve(graphName, line.substring(7).trim()).exported = true;
+			return;
+		}
+		int assignPos = line.indexOf("=");
+		int openPos = line.indexOf("(");
+		int closePos = line.lastIndexOf(")");
+		int arrowPos = line.indexOf("<-");
+		if (assignPos < 0 || openPos < assignPos || closePos < openPos || arrowPos < closePos) {
+			throw new RuntimeException("syntax error '" + line + "'");
+		}
+		OperatorDef def = new OperatorDef();
+		def.name = graphName + "." + line.substring(0, assignPos).trim();
+		def.type = line.substring(assignPos+1, openPos).trim();
+		String argString = line.substring(openPos+1, closePos).trim();
+		if (argString.length() == 0) {
+			def.args = new String[0];
+		} else {
+			def.args = argString.split(",");
+			for (int i = 0; i < def.args.length; i++) {
+				def.args[i] = def.args[i].trim();
+			}
+		}
+		for (String input : line.substring(arrowPos+2).split(",")) {
+			input = input.trim();
+			int srcID = 0;
+			int colonPos = input.indexOf(":");
+			if (colonPos > 0) {
+				srcID = Integer.parseInt(input.substring(colonPos+1).trim());
+				input = input.substring(0, colonPos).trim();
+			}
+			def.inputs.add(resolve(graphName, input));
+			def.inputIDs.add(srcID);
+		}
+		define(def);
+	}
+
+	/**
+	 * find operator in current graph or global input
+	 */
+	private OperatorDef resolve(String graphName, String name) {
+		OperatorDef def = operators.get(graphName + "." + name);
+		if (def == null) {
+			def = operators.get(name);
+		}
+		if (def == null) {
+			throw new RuntimeException("unknown operator '" + name + "'");
+		}
+		return def;
+	}
+
+	/**
+	 * register operator, share it, if an identical one exists
+	 */
+	private void define(OperatorDef def) {
+		if (built) {
+			throw new RuntimeException("GraphPlanner: graph already built");
+		}
+		if (operators.containsKey(def.name)) {
+			throw new RuntimeException("duplicate operator '" + def.name + "'");
+		}
+		nrDefined++;
+		StringBuffer signature = new StringBuffer();
+		if (def.isInput()) {
+			signature.append("input:" + def.name);
+		} else {
+			signature.append(def.type);
+			signature.append("(");
+			for (int i = 0; i < def.args.length; i++) {
+				if (i > 0) signature.append(",");
+				signature.append(def.args[i]);
+			}
+			signature.append(")<-[");
+			for (int i = 0; i < def.inputs.size(); i++) {
+				if (i > 0) signature.append(",");
+				signature.append(def.inputs.get(i).signature);
+				signature.append(":");
+				signature.append(def.inputIDs.get(i));
+			}
+			signature.append("]");
+		}
+		def.signature = signature.toString();
+		OperatorDef existing = shared.get(def.signature);
+		if (existing != null) {
+			operators.put(def.name, existing);
+			return;
+		}
+		shared.put(def.signature, def);
+		operators.put(def.name, def);
+		for (OperatorDef input : def.inputs) {
+			if (!input.consumers.contains(def)) {
+				input.consumers.add(def);
+			}
+		}
+	}
+
+	/**
+	 * Provide source for input statement
+	 * @param name
+	 * @param source
+	 */
+	public void bindInput(String name, Source<?> source) {
+		inputBindings.put(name, source);
+	}
+
+	/**
+	 * Create and connect operators
+	 */
+	@SuppressWarnings("unchecked")
+	public void build() {
+		if (built) return;
+		built = true;
+
+		// determine stateless chains
+		for (OperatorDef def : shared.values()) {
+			if (!def.isStateless() || def.inputs.size() != 1) continue;
+			OperatorDef input = def.inputs.get(0);
+			if (input.chain != null && input.consumers.size() == 1 && !input.exported) {
+				def.chain = input.chain;
+			} else {
+				def.chain = new ArrayList<OperatorDef>();
+			}
+			def.chain.add(def);
+		}
+
+		// create operators at the end of chains
+		int nrCreated = 0;
+		int nrFused = 0;
+		HashSet<AbstractPipe> pipes = new HashSet<AbstractPipe>();
+		for (OperatorDef def : shared.values()) {
+			if (def.isInput()) {
+				def.operator = inputBindings.get(def.name);
+				if (def.operator == null) {
+					throw new RuntimeException("GraphPlanner: no source bound to input '" + def.name + "'");
+				}
+				continue;
+			}
+			ArrayList<OperatorDef> inputs = def.inputs;
+			ArrayList<Integer> inputIDs = def.inputIDs;
+			if (def.chain != null) {
+				if (def.chain.get(def.chain.size()-1) != def) continue;
+				if (def.chain.size() > 1) {
+					FusedPipe fusedPipe = new FusedPipe();
+					for (OperatorDef stage : def.chain) {
+						if (stage.type.equals("map")) {
+							fusedPipe.addMapper(createMapper(stage));
+						} else {
+							fusedPipe.addPredicate(createPredicate(stage));
+						}
+					}
+					def.operator = fusedPipe;
+					nrFused += def.chain.size();
+					inputs = def.chain.get(0).inputs;
+					inputIDs = def.chain.get(0).inputIDs;
+				}
+			}
+			if (def.operator == null) {
+				def.operator = createOperator(def);
+			}
+			nrCreated++;
+			for (int i = 0; i < inputs.size(); i++) {
+				((Source) inputs.get(i).operator).subscribe((Sink) def.operator, inputIDs.get(i));
+			}
+			if (def.operator instanceof AbstractPipe) {
+				pipes.add((AbstractPipe) def.operator);
+			}
+		}
+
+		// dispatch filters on same attribute
+		for (AbstractPipe pipe : pipes) {
+			Demultiplexer.foldAttributeFilters(pipe);
+		}
+
+		System.out.println("GraphPlanner: " + nrDefined + " operators defined, " + shared.size() + " distinct, "
+				+ nrCreated + " created, " + nrFused + " fused");
+	}
+
+	/**
+	 * Process tuples queued by async operators and stop their threads.
+	 * Has to be called on the thread that ran the graph
+	 */
+	public void stop() {
+		// definition order, so that upstream stages are flushed first
+		for (OperatorDef def : shared.values()) {
+			if (def.operator instanceof AsyncPipe) {
+				((AsyncPipe) def.operator).stop();
+			}
+		}
+	}
+
+	/**
+	 * @param name of operator, prefixed with graph name
+	 * @return created operator. null for operators fused into a following one
+	 */
+	public Object getOperator(String name) {
+		OperatorDef def = operators.get(name);
+		if (def == null) return null;
+		return def.operator;
+	}
+
+	/**
+	 * @return names of operators declared as output, prefixed with graph name
+	 */
+	public List<String> getOutputs() {
+		ArrayList<String> outputs = new ArrayList<String>();
+		for (String name : operators.keySet()) {
+			if (operators.get(name).exported) {
+				outputs.add(name);
+			}
+		}
+		Collections.sort(outputs);
+		return outputs;
+	}
+
+	private Predicate<? extends Tuple> createPredicate(OperatorDef def) {
+		checkArgs(def, def.type.equals("filter") ? 2 : def.type.equals("nonzero") ? 1 : 0);
+		if (def.type.equals("crc")) {
+			return new PacketCrcPredicate(parser);
+		}
+		if (def.type.equals("filter")) {
+			return new AttributePredicate(def.args[0], getValue(def.args[1]));
+		}
+		final TupleAttribute attribute = new TupleAttribute(def.args[0]);
+		return new Predicate<Tuple>() {
+			public boolean invoke(Tuple o, long timestamp) {
+				return o.getIntAttribute(attribute) != 0;
+			}
+			public boolean isStateless() {
+				return true;
+			}
+		};
+	}
+
+	private Mapper createMapper(OperatorDef def) {
+		if (def.args.length < 3 || def.args.length % 2 != 1) {
+			throw new RuntimeException("GraphPlanner: map needs type and pairs of fields in " + def.name);
+		}
+		String mapping[] = new String[def.args.length-1];
+		System.arraycopy(def.args, 1, mapping, 0, mapping.length);
+		return new Mapper(def.args[0], mapping);
+	}
+
+	@SuppressWarnings("unchecked")
+	private Object createOperator(OperatorDef def) {
+		String type = def.type;
+		if (type.equals("crc") || type.equals("filter") || type.equals("nonzero")) {
+			return new Filter(createPredicate(def));
+		}
+		if (type.equals("map")) {
+			return createMapper(def);
+		}
+		if (type.equals("distinct")) {
+			checkArgs(def, 1);
+			return new Filter<PacketTuple>(new DistinctInWindow(Integer.parseInt(def.args[0])));
+		}
+		if (type.equals("extract")) {
+			if (def.args.length < 3) {
+				throw new RuntimeException("GraphPlanner: extract needs type, size and array field in " + def.name);
+			}
+			String mapped[] = new String[def.args.length-3];
+			System.arraycopy(def.args, 3, mapped, 0, mapped.length);
+			return new ArrayExtractor(def.args[0], def.args[1], def.args[2], mapped);
+		}
+		if (type.equals("union")) {
+			return new Union<Tuple>();
+		}
+		if (type.equals("count")) {
+			checkArgs(def, 4);
+			return new TupleTimeWindowGroupAggregator(Integer.parseInt(def.args[0]), def.args[1],
+					new Counter(def.args[2], def.args[3]), def.name);
+		}
+		if (type.equals("dump")) {
+			return new Dump();
+		}
+		if (type.equals("async")) {
+			checkArgs(def, 0);
+			return new AsyncPipe<Tuple>();
+		}
+		throw new RuntimeException("GraphPlanner: unknown operator type '" + type + "' in " + def.name);
+	}
+
+	private void checkArgs(OperatorDef def, int count) {
+		if (def.args.length != count) {
+			throw new RuntimeException("GraphPlanner: " + def.type + " needs " + count + " arguments in " + def.name);
+		}
+	}
+
+	/**
+	 * @return integer literal or PDL constant
+	 */
+	private Integer getValue(String value) {
+		try {
+			return Integer.decode(value);
+		} catch (NumberFormatException e) {
+			return parser.getValue(value);
+		}
+	}
+
+	/**
+	 * Run graph definitions on a packet log
+	 *
+	 * @param args packet definition, packet log, graph definition(s)
+	 * @throws Exception
+	 */
+	public static void main(String args[]) throws Exception {
+		if (args.length < 3) {
+			System.out.println("Usage: GraphPlanner packet_definition packet_log graph_definition [graph_definition ...]");
+			return;
+		}
+		PDL parser = Parser.readDescription(args[0]);
+		LogReader logReader = LogReader.createLogReaderFromFile(args[1]);
+		logReader.setParser(parser);
+
+		GraphPlanner planner = new GraphPlanner(parser);
+		for (int i = 2; i < args.length; i++) {
+			planner.load(args[i]);
+		}
+		planner.bindInput("packets", logReader);
+		planner.build();
+
+		int packets = Scheduler.runBatch(logReader);
+		planner.stop();
+		System.out.println("GraphPlanner: " + packets + " packets processed");
+	}
+}
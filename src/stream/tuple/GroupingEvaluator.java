@@ -68,6 +68,14 @@ public class GroupingEvaluator extends
 		groupAttribute = new TupleAttribute( groupField );
 	}
 
+	/**
+	 * Evaluate group only if a value of the metric changed. A tuple updated in place
+	 * cannot be compared with its previous state and is always evaluated
+	 */
+	protected boolean hasChanged(Tuple oldValue, Tuple newValue) {
+		return oldValue == newValue || !oldValue.equalValues(newValue);
+	}
+
 	public static GroupingEvaluator createBinaryTreeEvaluator(final BinaryDecisionTree theTree, final String groupField, final String name) {
 		// register result tuples
 		registerTreeResultTuples( theTree, groupField);
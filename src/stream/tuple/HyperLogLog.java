@@ -0,0 +1,97 @@
+package stream.tuple;
+
+/**
+ * HyperLogLog distinct count sketch
+ * 
+ * Uses 2^precision registers of one byte. The standard error is about 
+ * 1.04 / sqrt(2^precision). Sketches with the same precision can be merged.
+ * 
+ * @author mringwal
+ *
+ */
+public class HyperLogLog {
+
+	private int precision;
+	private byte registers[];
+	
+	/**
+	 * @param precision nr of index bits, 4..16
+	 */
+	public HyperLogLog(int precision) {
+		if (precision < 4 || precision > 16) {
+			throw new RuntimeException("HyperLogLog: precision must be in 4..16");
+		}
+		this.precision = precision;
+		registers = new byte[1 << precision];
+	}
+	
+	/**
+	 * add item by its hash value
+	 * @param hash
+	 */
+	public void add(int hash) {
+		int h = mix(hash);
+		int index = h >>> (32 - precision);
+		int rest = h << precision;
+		int rank = rest == 0 ? 32 - precision + 1 : Integer.numberOfLeadingZeros(rest) + 1;
+		if (rank > registers[index]) {
+			registers[index] = (byte) rank;
+		}
+	}
+
+	/**
+	 * add items of other sketch
+	 * @param other
+	 */
+	public void merge(HyperLogLog other) {
+		for (int i = 0; i < registers.length; i++) {
+			if (other.registers[i] > registers[i]) {
+				registers[i] = other.registers[i];
+			}
+		}
+	}
+	
+	public void clear() {
+		for (int i = 0; i < registers.length; i++) {
+			registers[i] = 0;
+		}
+	}
+	
+	/**
+	 * @return estimated nr of distinct items
+	 */
+	public long estimate() {
+		int m = registers.length;
+		double sum = 0;
+		int zeros = 0;
+		for (int i = 0; i < m; i++) {
+			sum += 1.0 / (1L << registers[i]);
+			if (registers[i] == 0) zeros++;
+		}
+		double alpha;
+		switch (m) {
+		case 16: alpha = 0.673; break;
+		case 32: alpha = 0.697; break;
+		case 64: alpha = 0.709; break;
+		default: alpha = 0.7213 / (1 + 1.079 / m);
+		}
+		double estimate = alpha * m * m / sum;
+		// small range correction
+		if (estimate <= 2.5 * m && zeros > 0) {
+			estimate = m * Math.log((double) m / zeros);
+		}
+		return Math.round(estimate);
+	}
+	
+	/**
+	 * spread bits of hash codes (murmur3 finalizer)
+	 */
+	private static int mix(int h) {
+		h ^= h >>> 16;
+		h *= 0x85ebca6b;
+		h ^= h >>> 13;
+		h *= 0xc2b2ae35;
+		h ^= h >>> 16;
+		return h;
+	}
+}
@@ -0,0 +1,276 @@
+package stream.tuple;
+
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.IOException;
+
+import stream.AbstractPipe;
+import stream.Checkpointable;
+import stream.Scheduler;
+import stream.TimeTriggered;
+
+/**
+ * Time window operator. COUNT per link
+ *
+ * Counts tuples per (from, to) link over a time window. Links are identified by an int
+ * linkID = from << 16 | to. All state is kept in primitive arrays: an open addressing
+ * table maps linkIDs to dense link indices, and each link has a ring of counters, one
+ * per sub window. When a sub window expires, its counter is subtracted from the total.
+ * Tuples stay up to one sub window, i.e. timewindow / SUB_WINDOWS rounded up, longer in the count.
+ * Late tuples older than the oldest sub window of their link are ignored.
+ *
+ * Emits tuples of type newTupleType with the fields "linkID" (Integer) and resultField
+ * for each processed tuple and each time a count of a link changes due to expiry.
+ * Use getFrom() and getTo() to split the linkID.
+ *
+ * @author mringwal
+ *
+ */
+public class LinkMetricStore extends AbstractPipe<Tuple, Tuple> implements TimeTriggered, Checkpointable {
+
+	public static final String LINK_ID_FIELD = "linkID";
+
+	/** nr of sub windows per time window */
+	public static final int SUB_WINDOWS = 8;
+
+	private static final int RING = SUB_WINDOWS + 1;
+	private static final int INITIAL_LINKS = 256;
+
+	private int timewindow;
+	private long slotLength;
+	private int tupleTypeID;
+	private TupleAttribute fromField;
+	private TupleAttribute toField;
+	private TupleAttribute linkIDField = new TupleAttribute(LINK_ID_FIELD);
+	private TupleAttribute resultField;
+
+	/** open addressing table: link index + 1, 0 = empty */
+	private int table[] = new int[2 * INITIAL_LINKS];
+
+	/** per link */
+	private int nrLinks = 0;
+	private int linkIDs[] = new int[INITIAL_LINKS];
+	private int totals[] = new int[INITIAL_LINKS];
+
+	/** per link and sub window, index = link * RING + slot mod RING. Unused if count is 0 */
+	private long slots[] = new long[INITIAL_LINKS * RING];
+	private int counts[] = new int[INITIAL_LINKS * RING];
+
+	private long lastTimeout = Long.MIN_VALUE;
+
+	/**
+	 * @param timewindow
+	 * @param fromField
+	 * @param toField
+	 * @param newTupleType
+	 * @param resultField
+	 */
+	public LinkMetricStore(int timewindow, String fromField, String toField, String newTupleType, String resultField) {
+		this.timewindow = timewindow;
+		// round up, so that a time window spans at most RING slots
+		this.slotLength = Math.max( 1, (timewindow + SUB_WINDOWS - 1) / SUB_WINDOWS);
+		this.fromField = new TupleAttribute(fromField);
+		this.toField = new TupleAttribute(toField);
+		this.resultField = new TupleAttribute(resultField);
+		tupleTypeID = Tuple.registerTupleType(newTupleType, LINK_ID_FIELD, resultField);
+	}
+
+	public static int getLinkID(int from, int to) {
+		return (from << 16) | (to & 0xffff);
+	}
+
+	public static int getFrom(int linkID) {
+		return linkID >>> 16;
+	}
+
+	public static int getTo(int linkID) {
+		return linkID & 0xffff;
+	}
+
+	public void process(Tuple o, int srcID, long timestamp) {
+		int linkID = getLinkID( o.getIntAttribute(fromField), o.getIntAttribute(toField));
+		int link = getLink(linkID);
+		long slot = getSlot(timestamp);
+		int index = getIndex(link, slot);
+		if (slots[index] != slot) {
+			if (counts[index] > 0 && slots[index] > slot) {
+				// late tuple, its sub window has already been replaced by a newer one
+				return;
+			}
+			// ring entry belongs to an old sub window, normally already expired
+			totals[link] -= counts[index];
+			counts[index] = 0;
+			slots[index] = slot;
+		}
+		counts[index]++;
+		totals[link]++;
+		transferCount(link, timestamp);
+
+		// one timeout per sub window
+		long timeout = (slot + 1) * slotLength + timewindow;
+		if (timeout > lastTimeout) {
+			lastTimeout = timeout;
+			Scheduler.getInstance().registerTimeout( timeout, this);
+		}
+	}
+
+	public void handleTimerEvent(long timestamp) {
+		for (int link = 0; link < nrLinks; link++) {
+			if (totals[link] == 0) continue;
+			boolean expired = false;
+			for (int index = link * RING; index < (link + 1) * RING; index++) {
+				if (counts[index] > 0 && (slots[index] + 1) * slotLength + timewindow <= timestamp) {
+					totals[link] -= counts[index];
+					counts[index] = 0;
+					expired = true;
+				}
+			}
+			if (expired) {
+				transferCount(link, timestamp);
+			}
+		}
+	}
+
+	/**
+	 * @param from
+	 * @param to
+	 * @return nr of tuples for link in current window
+	 */
+	public int getCount(int from, int to) {
+		int slot = find(getLinkID(from, to));
+		if (table[slot] == 0) return 0;
+		return totals[table[slot] - 1];
+	}
+
+	/**
+	 * @return nr of links seen so far
+	 */
+	public int getNrLinks() {
+		return nrLinks;
+	}
+
+	private void transferCount(int link, long timestamp) {
+		Tuple tuple = Tuple.createTuple(tupleTypeID);
+		tuple.setIntAttribute(linkIDField, linkIDs[link]);
+		tuple.setIntAttribute(resultField, totals[link]);
+		transfer(tuple, timestamp);
+	}
+
+	/**
+	 * @return sub window of timestamp, rounded down for negative timestamps, too
+	 */
+	private long getSlot(long timestamp) {
+		long slot = timestamp / slotLength;
+		if (timestamp < 0 && slot * slotLength != timestamp) {
+			slot--;
+		}
+		return slot;
+	}
+
+	/**
+	 * @return ring entry of sub window of link
+	 */
+	private static int getIndex(int link, long slot) {
+		return link * RING + (int) (((slot % RING) + RING) % RING);
+	}
+
+	/**
+	 * @return table slot containing linkID or empty slot where it should be inserted
+	 */
+	private int find(int linkID) {
+		int mask = table.length - 1;
+		int hash = linkID * 0x9e3779b9;
+		int slot = (hash ^ (hash >>> 16)) & mask;
+		while (table[slot] != 0 && linkIDs[table[slot] - 1] != linkID) {
+			slot = (slot + 1) & mask;
+		}
+		return slot;
+	}
+
+	/**
+	 * @return link index for linkID, new links are added
+	 */
+	private int getLink(int linkID) {
+		int slot = find(linkID);
+		if (table[slot] != 0) {
+			return table[slot] - 1;
+		}
+		if (nrLinks == linkIDs.length) {
+			growLinks();
+		}
+		int link = nrLinks++;
+		linkIDs[link] = linkID;
+		totals[link] = 0;
+		for (int index = link * RING; index < (link + 1) * RING; index++) {
+			slots[index] = -1;
+			counts[index] = 0;
+		}
+		if (2 * nrLinks > table.length) {
+			// keep load factor below 1/2
+			table = new int[table.length * 2];
+			for (int i = 0; i < nrLinks; i++) {
+				table[find(linkIDs[i])] = i + 1;
+			}
+		} else {
+			table[slot] = link + 1;
+		}
+		return link;
+	}
+
+	private void growLinks() {
+		int size = linkIDs.length * 2;
+		int newLinkIDs[] = new int[size];
+		System.arraycopy(linkIDs, 0, newLinkIDs, 0, nrLinks);
+		linkIDs = newLinkIDs;
+		int newTotals[] = new int[size];
+		System.arraycopy(totals, 0, newTotals, 0, nrLinks);
+		totals = newTotals;
+		long newSlots[] = new long[size * RING];
+		System.arraycopy(slots, 0, newSlots, 0, nrLinks * RING);
+		slots = newSlots;
+		int newCounts[] = new int[size * RING];
+		System.arraycopy(counts, 0, newCounts, 0, nrLinks * RING);
+		counts = newCounts;
+	}
+
+	public void saveState(DataOutputStream out) throws IOException {
+		out.writeInt(nrLinks);
+		for (int link = 0; link < nrLinks; link++) {
+			out.writeInt(linkIDs[link]);
+			for (int index = link * RING; index < (link + 1) * RING; index++) {
+				out.writeLong(slots[index] * slotLength);
+				out.writeInt(counts[index]);
+			}
+		}
+	}
+
+	public void restoreState(DataInputStream in, long timeShift) throws IOException {
+		table = new int[2 * INITIAL_LINKS];
+		nrLinks = 0;
+		lastTimeout = Long.MIN_VALUE;
+		int count = in.readInt();
+		for (int i = 0; i < count; i++) {
+			int link = getLink( in.readInt());
+			for (int j = 0; j < RING; j++) {
+				long start = in.readLong();
+				int linkCount = in.readInt();
+				if (linkCount == 0) continue;
+				long slot = getSlot(start + timeShift);
+				int index = getIndex(link, slot);
+				if (slots[index] != slot) {
+					if (counts[index] > 0 && slots[index] > slot) continue;
+					totals[link] -= counts[index];
+					slots[index] = slot;
+					counts[index] = 0;
+				}
+				counts[index] += linkCount;
+				totals[link] += linkCount;
+				long timeout = (slot + 1) * slotLength + timewindow;
+				if (timeout > lastTimeout) {
+					lastTimeout = timeout;
+				}
+				Scheduler.getInstance().registerTimeout( timeout, this);
+			}
+		}
+	}
+}
@@ -0,0 +1,80 @@
+package stream.tuple;
+
+import stream.AbstractSink;
+import stream.PipelineContext;
+import stream.Scheduler;
+import util.SelfCheck;
+
+/**
+ * Self-check: LinkMetricStore counts expire with the time window
+ * 
+ * @author mringwal
+ *
+ */
+public class LinkMetricStoreTest {
+
+	/** not a multiple of SUB_WINDOWS */
+	private static final int TIME_WINDOW = 1001;
+	private static final int SLOT_LENGTH = (TIME_WINDOW + LinkMetricStore.SUB_WINDOWS - 1) / LinkMetricStore.SUB_WINDOWS;
+
+	private static int inputTypeID;
+	private static TupleAttribute from = new TupleAttribute("from");
+	private static TupleAttribute to = new TupleAttribute("to");
+	private static Tuple last;
+
+	private static void send(LinkMetricStore store, int fromNode, int toNode, long timestamp) {
+		Tuple tuple = Tuple.createTuple(inputTypeID);
+		tuple.setIntAttribute(from, fromNode);
+		tuple.setIntAttribute(to, toNode);
+		Scheduler.getInstance().advanceTo(timestamp);
+		store.process(tuple, 0, timestamp);
+	}
+
+	public static void main(String[] args) {
+		PipelineContext previous = new PipelineContext("LinkMetricStoreTest").activate();
+		inputTypeID = Tuple.registerTupleType("LinkInput", "from", "to");
+		LinkMetricStore store = new LinkMetricStore(TIME_WINDOW, "from", "to", "LinkCount", "count");
+		store.subscribe(new AbstractSink<Tuple>() {
+			public void process(Tuple o, int srcID, long timestamp) {
+				last = o;
+			}
+		}, 0);
+		TupleAttribute linkID = new TupleAttribute(LinkMetricStore.LINK_ID_FIELD);
+		TupleAttribute count = new TupleAttribute("count");
+
+		// link 1 -> 2 every 50 ms. Tuples are counted for the time window
+		// and at most one more sub window
+		for (long time = 0; time <= 3000; time += 50) {
+			send(store, 1, 2, time);
+			long newest = time / 50 + 1;
+			long minCount = Math.min( newest, (TIME_WINDOW - 1) / 50 + 1);
+			long maxCount = Math.min( newest, (TIME_WINDOW + SLOT_LENGTH) / 50 + 1);
+			int current = store.getCount(1, 2);
+			SelfCheck.check( current >= minCount && current <= maxCount, "count " + current + " at " + time
+					+ ", expected " + minCount + ".." + maxCount);
+			SelfCheck.check( last.getIntAttribute(count) == current, "emitted count at " + time);
+			SelfCheck.check( last.getIntAttribute(linkID) == LinkMetricStore.getLinkID(1, 2), "emitted linkID at " + time);
+		}
+		SelfCheck.check( LinkMetricStore.getFrom( LinkMetricStore.getLinkID(1, 2)) == 1, "getFrom");
+		SelfCheck.check( LinkMetricStore.getTo( LinkMetricStore.getLinkID(1, 2)) == 2, "getTo");
+
+		// links are independent, also beyond initial table size
+		for (int node = 0; node < 300; node++) {
+			send(store, node, 1000, 3000);
+		}
+		SelfCheck.check( store.getNrLinks() == 301, "nr of links " + store.getNrLinks());
+		for (int node = 0; node < 300; node++) {
+			SelfCheck.check( store.getCount(node, 1000) == 1, "count of link " + node);
+		}
+		SelfCheck.check( store.getCount(2, 1) == 0, "count of unknown link");
+
+		// everything expires
+		Scheduler.getInstance().advanceTo(3000 + TIME_WINDOW + 2 * SLOT_LENGTH);
+		SelfCheck.check( store.getCount(1, 2) == 0, "count after expiry " + store.getCount(1, 2));
+		SelfCheck.check( store.getCount(0, 1000) == 0, "count of other link after expiry");
+		SelfCheck.check( last.getIntAttribute(count) == 0, "emitted count after expiry");
+
+		previous.activate();
+		System.out.println("LinkMetricStoreTest: OK");
+	}
+}
@@ -1,28 +1,47 @@
 package stream.tuple;
 
 import java.io.BufferedReader;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.File;
 import java.io.FileNotFoundException;
-import java.io.FileReader;
+import java.io.IOException;
 import java.io.StringReader;
 import java.util.StringTokenizer;
 
 import packetparser.DecodedPacket;
 import packetparser.PDL;
+import packetparser.PacketBufferPool;
 import stream.AbstractSource;
+import stream.Checkpointable;
+import util.SeekableLineReader;
+import util.TimeIndex;
 
-public class LogReader extends AbstractSource<PacketTuple> {
+public class LogReader extends AbstractSource<PacketTuple> implements Checkpointable {
 
-	private class Packet {
-		long timestamp;
-		String dsnNode;
-		String typeString;
-		byte data[];
-		int len;
+	/** raw packet as stored in the log */
+	public static class Packet {
+		public long timestamp;
+		public String dsnNode;
+		public String typeString;
+		public byte data[];
+		public int len;
+		/** file offset of packet header, -1 if not read from file */
+		public long offset = -1;
 	}
 	
 	/** private members */
 	private BufferedReader reader = null;
+	private SeekableLineReader fileReader = null;
+	private File logFile = null;
 	private PDL parser;
+	private int packetsRead = 0;
+	/** packet returned by next() has not been transferred yet */
+	private boolean inFlight = false;
+	
+	/** time index, built while reading the whole file if not stored yet */
+	private TimeIndex index = null;
+	private TimeIndex newIndex = null;
 	
 	/**
 	 * Constructor from BufferedReader
@@ -31,6 +50,18 @@ public class LogReader extends AbstractSource<PacketTuple> {
 		reader = input;
 	}
 
+	/**
+	 * Constructor from log file
+	 */
+	private LogReader( File file) throws IOException {
+		logFile = file;
+		fileReader = new SeekableLineReader(file);
+		index = TimeIndex.load(file);
+		if (index == null) {
+			newIndex = new TimeIndex();
+		}
+	}
+
 	public void setParser( PDL parser) {
 		this.parser = parser;
 		
@@ -42,14 +73,157 @@ public class LogReader extends AbstractSource<PacketTuple> {
 			packet = readPacket();
 		} catch (Exception e) {
 		}
-		if (packet == null) return null;
-		byte[] rawData = new byte[packet.len];
-		System.arraycopy(packet.data, 0, rawData, 0, packet.len);
-		PacketTuple packetTuple = new PacketTuple( DecodedPacket.createPacketFromBuffer(parser, rawData), packet.timestamp);
+		inFlight = packet != null;
+		if (packet == null) {
+			if (newIndex != null) {
+				// complete file read, store index for next time
+				newIndex.save(logFile);
+				index = newIndex;
+				newIndex = null;
+			}
+			return null;
+		}
+		if (newIndex != null) {
+			newIndex.add(packet.timestamp, packet.offset, packetsRead);
+		}
+		packetsRead++;
+		PacketTuple packetTuple = new PacketTuple( DecodedPacket.createPacketFromPooledBuffer(parser, packet.data, 0, packet.len), packet.timestamp);
 		packetTuple.setDsnNode(packet.dsnNode);
 		return packetTuple;
 	}
 
+	/**
+	 * The packet returned by next() counts as processed once it has been transferred
+	 */
+	public void transfer(PacketTuple o, long timestamp) {
+		inFlight = false;
+		super.transfer(o, timestamp);
+	}
+
+	/**
+	 * Store number of packets processed. A checkpoint taken by a timer between next() and
+	 * transfer() must not include the packet in flight, as the operators have not seen it yet
+	 */
+	public void saveState(DataOutputStream out) throws IOException {
+		out.writeInt(inFlight ? packetsRead - 1 : packetsRead);
+	}
+
+	/**
+	 * Skip packets read before checkpoint
+	 */
+	public void restoreState(DataInputStream in, long timeShift) throws IOException {
+		int position = in.readInt();
+		inFlight = false;
+		if (position > packetsRead) {
+			// index would miss skipped packets
+			newIndex = null;
+		}
+		// jump close to packet if possible
+		if (index != null && packetsRead == 0) {
+			int entry = index.findPacket(position);
+			if (entry >= 0) {
+				fileReader.seek(index.getOffset(entry));
+				packetsRead = index.getPacketNr(entry);
+			}
+		}
+		try {
+			Packet packet;
+			while (packetsRead < position && (packet = readPacket()) != null) {
+				PacketBufferPool.getInstance().recycle(packet.data);
+				packetsRead++;
+			}
+		} catch (Exception e) {
+			throw new IOException("LogReader: cannot skip to packet " + position);
+		}
+	}
+
+	/**
+	 * Continue reading with the first packet at or after time - warmup. The warm-up
+	 * packets allow windows and duplicate filters to reach their normal state at time.
+	 * 
+	 * If the log has not been indexed yet, the index is built first by reading the whole file.
+	 * 
+	 * @param time in ms
+	 * @param warmup in ms
+	 * @throws IOException
+	 */
+	public void seek(long time, long warmup) throws IOException {
+		if (fileReader == null) {
+			throw new IOException("LogReader: can only seek in log files");
+		}
+		if (index == null) {
+			buildIndex();
+		}
+		long start = time - warmup;
+		int entry = index.findTime(start);
+		if (entry >= 0) {
+			fileReader.seek(index.getOffset(entry));
+			packetsRead = index.getPacketNr(entry);
+		} else {
+			fileReader.seek(0);
+			packetsRead = 0;
+		}
+		newIndex = null;
+		inFlight = false;
+		// skip packets before start
+		try {
+			while (true) {
+				long offset = fileReader.getPosition();
+				Packet packet = readPacket();
+				if (packet == null) break;
+				PacketBufferPool.getInstance().recycle(packet.data);
+				if (packet.timestamp >= start) {
+					fileReader.seek(offset);
+					break;
+				}
+				packetsRead++;
+			}
+		} catch (Exception e) {
+			throw new IOException("LogReader: cannot seek to " + time);
+		}
+	}
+
+	/**
+	 * The index is built first if necessary. The last indexed packet can be up to
+	 * TimeIndex.DEFAULT_INTERVAL before the end of the log.
+	 * 
+	 * @return time of first and last indexed packet, null if log is empty
+	 * @throws IOException
+	 */
+	public long[] getTimeRange() throws IOException {
+		if (fileReader == null) {
+			throw new IOException("LogReader: time range only available for log files");
+		}
+		if (index == null) {
+			long position = fileReader.getPosition();
+			buildIndex();
+			fileReader.seek(position);
+			newIndex = null;
+		}
+		if (index.size() == 0) return null;
+		return new long[] { index.getTime(0), index.getTime(index.size() - 1) };
+	}
+
+	/**
+	 * read whole file once and store its time index
+	 */
+	private void buildIndex() throws IOException {
+		TimeIndex builtIndex = new TimeIndex();
+		fileReader.seek(0);
+		int packetNr = 0;
+		try {
+			Packet packet;
+			while ((packet = readPacket()) != null) {
+				PacketBufferPool.getInstance().recycle(packet.data);
+				builtIndex.add(packet.timestamp, packet.offset, packetNr++);
+			}
+		} catch (Exception e) {
+			// incomplete last packet
+		}
+		builtIndex.save(logFile);
+		index = builtIndex;
+	}
+
 	/**
 	 * Factory method to create a parser which is fed by a String
 	 * @param input
@@ -62,12 +236,19 @@ public class LogReader extends AbstractSource<PacketTuple> {
 	}
 
 	public static LogReader createLogReaderFromFile(String fileName) throws FileNotFoundException {
-		BufferedReader buffReader = new BufferedReader( new FileReader(fileName) );
-		return new LogReader(buffReader);
+		try {
+			return new LogReader(new File(fileName));
+		} catch (FileNotFoundException e) {
+			throw e;
+		} catch (IOException e) {
+			throw new FileNotFoundException("LogReader: cannot open " + fileName + ": " + e.getMessage());
+		}
 	}
 	
 	/**
 	 * Read an emstar link-dump packet from an input stream
+	 * 
+	 * packet.data is acquired from the PacketBufferPool and can be recycled by the caller
 	 * @param
 	 * @throws Exception 
 	 */
@@ -76,7 +257,11 @@ public class LogReader extends AbstractSource<PacketTuple> {
 		Packet packet = new Packet();
 		
 		// read header
-		lineBuffer = reader.readLine();		
+		if (fileReader != null) {
+			packet.offset = fileReader.getPosition();
+		}
+		lineBuffer = readLine();		
+		if (lineBuffer == null) return null;
 		StringTokenizer tokenizer = new StringTokenizer(lineBuffer);
 		packet.timestamp = Integer.parseInt( tokenizer.nextToken());
 		packet.dsnNode = tokenizer.nextToken();
@@ -84,9 +269,9 @@ public class LogReader extends AbstractSource<PacketTuple> {
 		
 		// read data
 		int offset = 0;
-		packet.data = new byte[255];
+		packet.data = PacketBufferPool.getInstance().acquire();
 		while (true) {
-			lineBuffer = reader.readLine();
+			lineBuffer = readLine();
 			if (lineBuffer.length() == 0) {
 				break;
 			}
@@ -100,4 +285,11 @@ public class LogReader extends AbstractSource<PacketTuple> {
 		packet.len = offset;
 		return packet;
 	}
+
+	private String readLine() throws IOException {
+		if (fileReader != null) {
+			return fileReader.readLine();
+		}
+		return reader.readLine();
+	}
 }
\ No newline at end of file
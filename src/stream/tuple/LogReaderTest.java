@@ -0,0 +1,118 @@
+package stream.tuple;
+
+import java.io.File;
+import java.io.FileWriter;
+import java.io.IOException;
+import java.io.PrintWriter;
+
+import packetparser.PacketBufferPool;
+import util.SelfCheck;
+import util.TimeIndex;
+
+/**
+ * Self-check: TimeIndex lookup and storage, LogReader.seek with and without stored index
+ * 
+ * @author mringwal
+ *
+ */
+public class LogReaderTest {
+
+	/** packets in log, one every STEP ms, larger than the read buffer */
+	private static final int PACKETS = 2000;
+	private static final int STEP = 100;
+
+	private static void writeLog(File file) throws IOException {
+		PrintWriter out = new PrintWriter(new FileWriter(file));
+		for (int i = 0; i < PACKETS; i++) {
+			out.println((i * STEP) + " dsn" + (i % 4) + " data");
+			// packet nr in first two bytes
+			out.print("0000:");
+			out.print(" " + Integer.toHexString(i >> 8) + " " + Integer.toHexString(i & 0xff));
+			for (int j = 2; j < 16; j++) {
+				out.print(" " + Integer.toHexString(j));
+			}
+			out.println();
+			out.println();
+		}
+		out.close();
+	}
+
+	/**
+	 * @return packet nr of next packet in log, -1 if log ended
+	 */
+	private static int nextPacketNr(LogReader reader) throws Exception {
+		LogReader.Packet packet = reader.readPacket();
+		if (packet == null) return -1;
+		SelfCheck.check( packet.len == 16, "packet length " + packet.len);
+		int nr = ((packet.data[0] & 0xff) << 8) | (packet.data[1] & 0xff);
+		SelfCheck.check( packet.timestamp == nr * STEP, "timestamp " + packet.timestamp + " of packet " + nr);
+		PacketBufferPool.getInstance().recycle(packet.data);
+		return nr;
+	}
+
+	private static void checkSeek(LogReader reader, long time, long warmup, int expectedNr) throws Exception {
+		reader.seek(time, warmup);
+		int nr = nextPacketNr(reader);
+		SelfCheck.check( nr == expectedNr, "seek(" + time + ", " + warmup + ") read packet " + nr + ", expected " + expectedNr);
+		if (nr >= 0 && nr + 1 < PACKETS) {
+			SelfCheck.check( nextPacketNr(reader) == nr + 1, "packet after seek(" + time + ", " + warmup + ")");
+		}
+	}
+
+	private static void checkTimeIndex() {
+		TimeIndex index = new TimeIndex(1000);
+		SelfCheck.check( index.findTime(0) == -1, "lookup in empty index");
+		for (int i = 0; i < 100; i++) {
+			index.add(i * 300, i * 50, i);
+		}
+		// one entry for packets 0, 4, 8, ... at least 1000 ms apart
+		SelfCheck.check( index.size() == 25, "index size " + index.size());
+		SelfCheck.check( index.findTime(-1) == -1, "time before first entry");
+		int entry = index.findTime(2500);
+		SelfCheck.check( index.getTime(entry) == 2400 && index.getPacketNr(entry) == 8, "entry for 2500");
+		SelfCheck.check( index.getOffset(index.findTime(2400)) == 8 * 50, "entry at exact time");
+		SelfCheck.check( index.findTime(1000000) == index.size() - 1, "time after last entry");
+		SelfCheck.check( index.getPacketNr(index.findPacket(9)) == 8, "entry for packet 9");
+		SelfCheck.check( index.findPacket(-1) == -1, "packet before first entry");
+	}
+
+	public static void main(String[] args) throws Exception {
+		checkTimeIndex();
+
+		File logFile = File.createTempFile("LogReaderTest", ".log");
+		File indexFile = TimeIndex.getIndexFile(logFile);
+		logFile.deleteOnExit();
+		indexFile.deleteOnExit();
+		writeLog(logFile);
+
+		// no index yet, seek builds and stores it
+		LogReader reader = LogReader.createLogReaderFromFile(logFile.getPath());
+		checkSeek(reader, 35050, 2000, 331);
+		SelfCheck.check( indexFile.exists(), "index not stored");
+		long range[] = reader.getTimeRange();
+		SelfCheck.check( range[0] == 0 && range[1] == (PACKETS * STEP) - TimeIndex.DEFAULT_INTERVAL, "time range");
+
+		// seek backwards and forwards, before start and behind end
+		checkSeek(reader, 12000, 0, 120);
+		checkSeek(reader, 150000, 500, 1495);
+		checkSeek(reader, 500, 1000, 0);
+		checkSeek(reader, 10 * PACKETS * STEP, 0, -1);
+		checkSeek(reader, (PACKETS - 1) * STEP, 0, PACKETS - 1);
+
+		// stored index is used
+		TimeIndex index = TimeIndex.load(logFile);
+		SelfCheck.check( index != null && index.size() == PACKETS * STEP / TimeIndex.DEFAULT_INTERVAL, "stored index");
+		reader = LogReader.createLogReaderFromFile(logFile.getPath());
+		checkSeek(reader, 77777, 0, 778);
+
+		// index older than log is ignored
+		SelfCheck.check( logFile.setLastModified(indexFile.lastModified() + 10000), "cannot touch log");
+		SelfCheck.check( TimeIndex.load(logFile) == null, "outdated index used");
+		reader = LogReader.createLogReaderFromFile(logFile.getPath());
+		checkSeek(reader, 77777, 0, 778);
+
+		logFile.delete();
+		indexFile.delete();
+		System.out.println("LogReaderTest: OK");
+	}
+}
@@ -1,8 +1,9 @@
 package stream.tuple;
 
 import stream.AbstractPipe;
+import stream.BatchSink;
 
-public class Mapper extends AbstractPipe<Tuple, Tuple> {
+public class Mapper extends AbstractPipe<Tuple, Tuple> implements BatchSink<Tuple> {
 
 	int newType;
 	int nrMappings;
@@ -10,12 +11,32 @@ public class Mapper extends AbstractPipe<Tuple, Tuple> {
 	TupleAttribute[] toAttributes;
 	
 	public void process(Tuple o, int srcID, long timestamp) {
+		transfer( map(o), timestamp );
+	}
+
+	/** batch buffer */
+	private Tuple mapped[] = new Tuple[0];
+
+	public void processBatch(Tuple o[], long timestamps[], int n, int srcID) {
+		if (mapped.length < n) {
+			mapped = new Tuple[n];
+		}
+		for (int i = 0; i < n; i++) {
+			mapped[i] = map(o[i]);
+		}
+		transferBatch( mapped, timestamps, n );
+	}
+
+	/**
+	 * @param o
+	 * @return new tuple with mapped attributes
+	 */
+	public Tuple map(Tuple o) {
 		Tuple newTuple = Tuple.createTuple(newType);
 		for (int i=0; i< nrMappings ; i++) {
 			newTuple.setAttribute( toAttributes[i], o.getAttribute(fromAttributes[i]));
 		}
-		transfer( newTuple, timestamp );
-
+		return newTuple;
 	}
 	public Mapper(String newType, String... mapping) {
 		nrMappings = mapping.length / 2;
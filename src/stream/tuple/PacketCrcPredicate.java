@@ -26,6 +26,11 @@ public class PacketCrcPredicate extends Predicate<PacketTuple> {
 		crcAttributeName = defPack.getTypeName()+".crc";
 	}
 	
+	@Override
+	public boolean isStateless() {
+		return true;
+	}
+
 	@Override
 	public boolean invoke(PacketTuple o, long timestamp) {
 		int crcInPacket = o.getIntAttribute(crcAttributeName);
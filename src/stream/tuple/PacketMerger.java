@@ -17,6 +17,16 @@ public class PacketMerger extends AbstractSource<PacketTuple> {
 		timebase = sorter.getTimeBase();
 	}
 	
+	/**
+	 * Continue with the first packets at or after time - warmup
+	 * @param time in ms
+	 * @param warmup in ms
+	 * @throws Exception
+	 */
+	public void seek(long time, long warmup) throws Exception {
+		sorter.seek(time, warmup);
+	}
+
 	@Override
 	public PacketTuple next() {
 		PacketTuple packetTuple = null;
@@ -94,6 +94,15 @@ public class PacketTuple extends Tuple implements ITimeStampedObject {
 	public DecodedPacket getPacket(){
 		return packet;
 	}
+
+	/**
+	 * @return packet tuple with a private copy of the packet data
+	 */
+	public Tuple copy() {
+		PacketTuple newTuple = new PacketTuple(packet == null ? null : packet.copy(), time_ms);
+		newTuple.dsnNode = dsnNode;
+		return newTuple;
+	}
 	
 	public byte [] getRaw(){
 		return packet.getRaw();
@@ -0,0 +1,353 @@
+package stream.tuple;
+
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.LinkedList;
+
+import stream.AbstractPipe;
+import stream.Checkpointable;
+import stream.Scheduler;
+import stream.TimeStampedObject;
+import stream.TimeTriggered;
+
+/**
+ * Time window operator. Ratio of observed sequence numbers per node
+ *
+ * Replacement for a TupleTimeWindowDistinctGroupAggregator with Ratio. For each node,
+ * the seen sequence numbers are stored in a circular bitmap together with the number
+ * of seen packets, so each packet is handled in O(1).
+ * Sequence numbers wrap around at maxSeqNr.
+ *
+ * The window is split into SUB_WINDOWS sub windows. For each sub window, only the
+ * highest sequence number is stored. When a sub window expires, all sequence numbers
+ * up to it are removed from the bitmap.
+ *
+ * Emits tuples with the same fields as Ratio. Like TupleTimeWindowGroupAggregator,
+ * a groupID tuple can be used to assert that an aggregate is emitted after time window time
+ *
+ * @author mringwal
+ *
+ */
+public class SeqNrCoverage extends AbstractPipe<Tuple, Tuple> implements TimeTriggered, Checkpointable {
+
+	private static final String GROUPID_TUPLE_NAME = "groupID";
+	private static final String GROUPID_FIELD_NAME = "groupID";
+
+	/** nr of sub windows per time window */
+	public static final int SUB_WINDOWS = 8;
+
+	/** default max nr of sequence numbers in a window */
+	public static final int DEFAULT_CAPACITY = 1024;
+
+	private class Node {
+		Object gID;
+		long bits[] = new long[capacity / 64];
+		/** unwrapped sequence numbers, window is empty if low > high */
+		long low;
+		long high;
+		int seen;
+		int last;
+		/** sub windows: expiry time and highest sequence number */
+		long expiry[] = new long[SUB_WINDOWS + 1];
+		long maxSeqNr[] = new long[SUB_WINDOWS + 1];
+		int first = 0;
+		int count = 0;
+
+		boolean isEmpty() {
+			return low > high;
+		}
+
+		long getExpected() {
+			return isEmpty() ? 0 : high - low + 1;
+		}
+	}
+
+	private int timewindow;
+	private long slotLength;
+	private int modulus;
+	private int capacity;
+	private int tupleTypeID;
+	private TupleAttribute groupField;
+	private TupleAttribute seqNrField;
+	private TupleAttribute groupTupleGroupField;
+	private TupleAttribute ratioField = new TupleAttribute("ratio");
+	private TupleAttribute countField = new TupleAttribute("count");
+	private TupleAttribute minField = new TupleAttribute("min");
+	private TupleAttribute maxField = new TupleAttribute("max");
+	private TupleAttribute lastField = new TupleAttribute("last");
+
+	private HashMap<Object, Node> nodes = new HashMap<Object, Node>();
+	private HashMap<Object, Object> registeredGroups = new HashMap<Object, Object>();
+	private LinkedList<TimeStampedObject<Object>> initList = new LinkedList<TimeStampedObject<Object>>();
+	private long lastTimeout = -1;
+
+	public SeqNrCoverage(int timewindow, String groupField, String seqNrField, int maxSeqNr, String newTupleType) {
+		this(timewindow, groupField, seqNrField, maxSeqNr, DEFAULT_CAPACITY, newTupleType);
+	}
+
+	/**
+	 * @param timewindow
+	 * @param groupField node id
+	 * @param seqNrField
+	 * @param maxSeqNr largest sequence number before wrap around
+	 * @param capacity max nr of sequence numbers per window, rounded up to a power of two, at least 64
+	 * @param newTupleType
+	 */
+	public SeqNrCoverage(int timewindow, String groupField, String seqNrField, int maxSeqNr, int capacity, String newTupleType) {
+		this.timewindow = timewindow;
+		this.slotLength = Math.max( 1, timewindow / SUB_WINDOWS);
+		this.modulus = maxSeqNr + 1;
+		// bitmap index is the unwrapped sequence number masked by capacity - 1
+		this.capacity = 64;
+		while (this.capacity < capacity) {
+			this.capacity <<= 1;
+		}
+		if (this.capacity > modulus / 2) {
+			throw new RuntimeException("SeqNrCoverage: capacity must be less than half of the sequence number space");
+		}
+		this.groupField = new TupleAttribute(groupField);
+		this.seqNrField = new TupleAttribute(seqNrField);
+		this.groupTupleGroupField = new TupleAttribute(GROUPID_FIELD_NAME);
+		tupleTypeID = Tuple.registerTupleType(newTupleType, groupField, "ratio", "count", "min", "max", "last");
+
+		// register "group" tuple with "group" field
+		String[] groupTupleField = {GROUPID_FIELD_NAME};
+		Tuple.registerTupleType(GROUPID_TUPLE_NAME, groupTupleField);
+	}
+
+	public void process(Tuple o, int srcID, long timestamp) {
+		// check for "group" tuple
+		if (o.getType() == GROUPID_TUPLE_NAME) {
+			registerGroup(o.getAttribute(groupTupleGroupField), timestamp);
+			return;
+		}
+		Object gID = o.getAttribute(groupField);
+		int seqNr = o.getIntAttribute(seqNrField);
+		Node node = nodes.get(gID);
+		if (node == null) {
+			node = new Node();
+			node.gID = gID;
+			node.low = seqNr;
+			node.high = seqNr - 1;
+			nodes.put(gID, node);
+		}
+		// unwrap relative to highest sequence number
+		int diff = (seqNr - wrap(node.high) + modulus) % modulus;
+		if (diff >= modulus / 2) {
+			diff -= modulus;
+		}
+		long unwrapped = node.high + diff;
+		if (unwrapped > node.high) {
+			// keep at most capacity sequence numbers
+			if (unwrapped - node.low >= capacity) {
+				advance(node, unwrapped - capacity + 1);
+			}
+			if (node.isEmpty()) {
+				node.low = unwrapped;
+			}
+			node.high = unwrapped;
+		} else if (unwrapped < node.low) {
+			// older than window, e.g. after node reboot: restart
+			advance(node, node.high + 1);
+			node.low = unwrapped;
+			node.high = unwrapped;
+			node.count = 0;
+		}
+		int index = (int) (unwrapped & (capacity - 1));
+		long mask = 1L << (index & 63);
+		if ((node.bits[index >> 6] & mask) == 0) {
+			node.bits[index >> 6] |= mask;
+			node.seen++;
+		}
+		node.last = seqNr;
+
+		// track highest sequence number per sub window
+		long timeout = (timestamp / slotLength + 1) * slotLength + timewindow;
+		int head = (node.first + node.count - 1) % node.expiry.length;
+		if (node.count > 0 && node.expiry[head] == timeout) {
+			node.maxSeqNr[head] = Math.max( node.maxSeqNr[head], unwrapped);
+		} else {
+			if (node.count == node.expiry.length) {
+				// timer pending, merge into oldest sub window
+				int next = (node.first + 1) % node.expiry.length;
+				node.maxSeqNr[next] = Math.max( node.maxSeqNr[next], node.maxSeqNr[node.first]);
+				node.first = next;
+				node.count--;
+			}
+			head = (node.first + node.count) % node.expiry.length;
+			node.expiry[head] = timeout;
+			node.maxSeqNr[head] = unwrapped;
+			node.count++;
+		}
+		if (timeout > lastTimeout) {
+			lastTimeout = timeout;
+			Scheduler.getInstance().registerTimeout( timeout, this);
+		}
+		transferAggregate(node, timestamp);
+	}
+
+	/**
+	 * Register group explicitly with operator to receive an aggregate even if no other items are processed
+	 * @param gID
+	 * @param timestamp
+	 */
+	protected void registerGroup(Object gID, long timestamp) {
+		if (!registeredGroups.containsKey(gID)) {
+			registeredGroups.put(gID, null);
+			initList.addLast(new TimeStampedObject<Object>(timestamp, gID));
+			Scheduler.getInstance().registerTimeout(timestamp + timewindow, this);
+		}
+	}
+
+	public void handleTimerEvent(long timestamp) {
+		ArrayList<Object> emptyNodes = new ArrayList<Object>();
+		for (Node node : nodes.values()) {
+			long newLow = node.low;
+			while (node.count > 0 && node.expiry[node.first] <= timestamp) {
+				newLow = Math.max( newLow, node.maxSeqNr[node.first] + 1);
+				node.first = (node.first + 1) % node.expiry.length;
+				node.count--;
+			}
+			if (newLow > node.low) {
+				advance(node, newLow);
+				transferAggregate(node, timestamp);
+			}
+			if (node.isEmpty()) {
+				emptyNodes.add(node.gID);
+			}
+		}
+		// memory is only kept for active nodes
+		for (Object gID : emptyNodes) {
+			nodes.remove(gID);
+		}
+
+		// handle init timeouts for registered groups
+		while (initList.size() > 0 && initList.getFirst().timestamp + timewindow <= timestamp) {
+			Object gID = initList.removeFirst().object;
+			Node node = nodes.get(gID);
+			if (node == null) {
+				node = new Node();
+				node.gID = gID;
+				node.low = 1;
+				node.high = 0;
+			}
+			transferAggregate(node, timestamp);
+		}
+	}
+
+	/**
+	 * remove sequence numbers below newLow from window
+	 */
+	private void advance(Node node, long newLow) {
+		if (newLow > node.high) {
+			for (int i = 0; i < node.bits.length; i++) {
+				node.bits[i] = 0;
+			}
+			node.seen = 0;
+		} else {
+			for (long seqNr = node.low; seqNr < newLow; seqNr++) {
+				int index = (int) (seqNr & (capacity - 1));
+				long mask = 1L << (index & 63);
+				if ((node.bits[index >> 6] & mask) != 0) {
+					node.bits[index >> 6] &= ~mask;
+					node.seen--;
+				}
+			}
+		}
+		node.low = newLow;
+	}
+
+	private void transferAggregate(Node node, long timestamp) {
+		Tuple aggregate = Tuple.createTuple(tupleTypeID);
+		aggregate.setAttribute(groupField, node.gID);
+		aggregate.setIntAttribute(countField, node.seen);
+		if (node.isEmpty()) {
+			aggregate.setAttribute(ratioField, 0.0);
+			aggregate.setIntAttribute(lastField, -1);
+		} else {
+			aggregate.setAttribute(ratioField, (double) node.seen / node.getExpected());
+			aggregate.setIntAttribute(minField, wrap(node.low));
+			aggregate.setIntAttribute(maxField, wrap(node.high));
+			aggregate.setIntAttribute(lastField, node.last);
+		}
+		transfer(aggregate, timestamp);
+	}
+
+	/**
+	 * @return unwrapped sequence number mapped into 0..maxSeqNr
+	 */
+	private int wrap(long seqNr) {
+		return (int) (((seqNr % modulus) + modulus) % modulus);
+	}
+
+	public void saveState(DataOutputStream out) throws IOException {
+		TupleCodec codec = new TupleCodec();
+		out.writeInt(nodes.size());
+		for (Node node : nodes.values()) {
+			codec.writeValue(out, node.gID);
+			out.writeLong(node.low);
+			out.writeLong(node.high);
+			out.writeInt(node.seen);
+			out.writeInt(node.last);
+			for (int i = 0; i < node.bits.length; i++) {
+				out.writeLong(node.bits[i]);
+			}
+			out.writeInt(node.count);
+			for (int i = 0; i < node.count; i++) {
+				int slot = (node.first + i) % node.expiry.length;
+				out.writeLong(node.expiry[slot]);
+				out.writeLong(node.maxSeqNr[slot]);
+			}
+		}
+		out.writeInt(initList.size());
+		for (TimeStampedObject<Object> element : initList) {
+			out.writeLong(element.timestamp);
+			codec.writeValue(out, element.object);
+		}
+		out.writeInt(registeredGroups.size());
+		for (Object gID : registeredGroups.keySet()) {
+			codec.writeValue(out, gID);
+		}
+	}
+
+	public void restoreState(DataInputStream in, long timeShift) throws IOException {
+		TupleCodec codec = new TupleCodec();
+		nodes.clear();
+		initList.clear();
+		registeredGroups.clear();
+		lastTimeout = -1;
+		int count = in.readInt();
+		for (int i = 0; i < count; i++) {
+			Node node = new Node();
+			node.gID = codec.readValue(in);
+			node.low = in.readLong();
+			node.high = in.readLong();
+			node.seen = in.readInt();
+			node.last = in.readInt();
+			for (int j = 0; j < node.bits.length; j++) {
+				node.bits[j] = in.readLong();
+			}
+			node.count = in.readInt();
+			for (int j = 0; j < node.count; j++) {
+				node.expiry[j] = in.readLong() + timeShift;
+				node.maxSeqNr[j] = in.readLong();
+				Scheduler.getInstance().registerTimeout( node.expiry[j], this);
+				lastTimeout = Math.max( lastTimeout, node.expiry[j]);
+			}
+			nodes.put(node.gID, node);
+		}
+		count = in.readInt();
+		for (int i = 0; i < count; i++) {
+			long timestamp = in.readLong() + timeShift;
+			initList.addLast( new TimeStampedObject<Object>(timestamp, codec.readValue(in)));
+			Scheduler.getInstance().registerTimeout( timestamp + timewindow, this);
+		}
+		count = in.readInt();
+		for (int i = 0; i < count; i++) {
+			registeredGroups.put( codec.readValue(in), null);
+		}
+	}
+}
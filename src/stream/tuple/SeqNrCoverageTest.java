@@ -0,0 +1,89 @@
+package stream.tuple;
+
+import stream.AbstractSink;
+import stream.PipelineContext;
+import stream.Scheduler;
+import util.SelfCheck;
+
+/**
+ * Self-check: SeqNrCoverage across sequence number wrap-around, node reboot and expiry
+ * 
+ * @author mringwal
+ *
+ */
+public class SeqNrCoverageTest {
+
+	private static final int TIME_WINDOW = 8000;
+
+	private static Tuple last;
+	private static int inputTypeID;
+	private static TupleAttribute nodeID = new TupleAttribute("nodeID");
+	private static TupleAttribute seqNr = new TupleAttribute("seqNr");
+	private static TupleAttribute ratio = new TupleAttribute("ratio");
+	private static TupleAttribute count = new TupleAttribute("count");
+	private static TupleAttribute min = new TupleAttribute("min");
+	private static TupleAttribute max = new TupleAttribute("max");
+
+	private static void check(boolean condition, String message) {
+		SelfCheck.check( condition, message + ", last aggregate " + last);
+	}
+
+	private static void send(SeqNrCoverage coverage, int node, int nr, long timestamp) {
+		Tuple tuple = Tuple.createTuple(inputTypeID);
+		tuple.setIntAttribute(nodeID, node);
+		tuple.setIntAttribute(seqNr, nr);
+		Scheduler.getInstance().advanceTo(timestamp);
+		coverage.process(tuple, 0, timestamp);
+	}
+
+	public static void main(String[] args) {
+		PipelineContext previous = new PipelineContext("SeqNrCoverageTest").activate();
+		inputTypeID = Tuple.registerTupleType("SeqNrInput", "nodeID", "seqNr");
+		// sequence numbers 0..255, 64 per window
+		SeqNrCoverage coverage = new SeqNrCoverage(TIME_WINDOW, "nodeID", "seqNr", 255, 64, "Coverage");
+		coverage.subscribe(new AbstractSink<Tuple>() {
+			public void process(Tuple o, int srcID, long timestamp) {
+				last = o;
+			}
+		}, 0);
+
+		// wrap around from 255 to 0, 253 and 2 are lost
+		long time = 0;
+		int sent[] = { 250, 251, 252, 254, 255, 0, 1, 3, 4, 5 };
+		for (int nr : sent) {
+			send(coverage, 1, nr, time);
+			time += 100;
+		}
+		check( last.getIntAttribute(count) == 10, "count after wrap-around");
+		check( (Double) last.getAttribute(ratio) == 10.0 / 12, "ratio after wrap-around");
+		check( last.getIntAttribute(min) == 250 && last.getIntAttribute(max) == 5, "range after wrap-around");
+
+		// duplicates are not counted twice
+		send(coverage, 1, 4, time);
+		check( last.getIntAttribute(count) == 10, "count after duplicate");
+
+		// reboot: sequence number far behind window restarts it
+		send(coverage, 1, 200, time);
+		check( last.getIntAttribute(count) == 1, "count after reboot");
+		check( (Double) last.getAttribute(ratio) == 1.0, "ratio after reboot");
+		check( last.getIntAttribute(min) == 200 && last.getIntAttribute(max) == 200, "range after reboot");
+		send(coverage, 1, 202, time + 100);
+		check( (Double) last.getAttribute(ratio) == 2.0 / 3, "ratio after reboot and loss");
+
+		// more than capacity sequence numbers: oldest are dropped
+		time += 1000;
+		for (int i = 0; i < 100; i++) {
+			send(coverage, 2, i, time);
+		}
+		check( last.getIntAttribute(count) == 64, "count beyond capacity");
+		check( last.getIntAttribute(min) == 36 && last.getIntAttribute(max) == 99, "range beyond capacity");
+
+		// window expires without packets
+		Scheduler.getInstance().advanceTo(time + 2 * TIME_WINDOW);
+		check( last.getIntAttribute(count) == 0, "count after expiry");
+		check( (Double) last.getAttribute(ratio) == 0.0, "ratio after expiry");
+
+		previous.activate();
+		System.out.println("SeqNrCoverageTest: OK");
+	}
+}
@@ -1,10 +1,15 @@
 package stream.tuple;
 
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.IOException;
 import java.util.HashMap;
+import java.util.Map;
 
 import stream.AbstractPipe;
+import stream.Checkpointable;
 
-public class SeqNrResetDetector extends AbstractPipe<Tuple, Tuple> {
+public class SeqNrResetDetector extends AbstractPipe<Tuple, Tuple> implements Checkpointable {
 
 	private static final String NODE_REBOOT_EVENT = "NodeRebootEvent";
 	
@@ -39,4 +44,23 @@ public class SeqNrResetDetector extends AbstractPipe<Tuple, Tuple> {
 		this.expectOverrun = maxSeqNq - expectOverrun;
 
 		Tuple.registerTupleType( NODE_REBOOT_EVENT,  idField);	}
+
+	public void saveState(DataOutputStream out) throws IOException {
+		TupleCodec codec = new TupleCodec();
+		out.writeInt(nodes.size());
+		for (Map.Entry<Object, Integer> entry : nodes.entrySet()) {
+			codec.writeValue(out, entry.getKey());
+			out.writeInt(entry.getValue());
+		}
+	}
+
+	public void restoreState(DataInputStream in, long timeShift) throws IOException {
+		TupleCodec codec = new TupleCodec();
+		nodes.clear();
+		int count = in.readInt();
+		for (int i = 0; i < count; i++) {
+			Object nodeID = codec.readValue(in);
+			nodes.put( nodeID, in.readInt());
+		}
+	}
 }
@@ -0,0 +1,272 @@
+package stream.tuple;
+
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.concurrent.Callable;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+
+import packetparser.PDL;
+import packetparser.Parser;
+import stream.AbstractSink;
+import stream.AbstractSource;
+import stream.PipelineContext;
+import stream.Scheduler;
+import stream.Sink;
+import stream.Source;
+
+/**
+ * Offline analysis of a packet log or capture on several cores
+ *
+ * The log is split into time shards of equal length. For each shard, an independent
+ * instance of the analysis graph is created and fed with the packets of the shard,
+ * preceded by a warm-up of the given length. The warm-up has to be at least as long
+ * as the largest time window or timeout in the graph, so that all operators are in the
+ * same state at the start of the shard as in a sequential run. Results with a timestamp
+ * in the warm-up are dropped. The shards are processed on a thread pool and the results
+ * are passed to the output in shard order, i.e. in the same order as in a sequential run.
+ *
+ * Graphs are created on the calling thread, as tuple types are registered then.
+ * Each shard runs in a fork of the caller's PipelineContext, i.e. with the same
+ * schema and its own Scheduler.
+ *
+ * @author mringwal
+ *
+ */
+public class ShardedReplay {
+
+	/**
+	 * Creates one instance of the analysis graph per shard
+	 */
+	public interface GraphFactory {
+		/**
+		 * @param input packets of one shard
+		 * @param output sink for results
+		 */
+		void createGraph(AbstractSource<PacketTuple> input, Sink<Tuple> output);
+	}
+
+	/**
+	 * Packets of one shard, ends with first packet after shard
+	 */
+	private static class ShardSource extends AbstractSource<PacketTuple> {
+		AbstractSource<PacketTuple> reader;
+		long end;
+		boolean boundary = false;
+
+		public PacketTuple next() {
+			if (boundary) return null;
+			PacketTuple packet = reader.next();
+			if (packet != null && packet.getTime() >= end) {
+				if (packet.getPacket() != null) {
+					packet.getPacket().recycle();
+				}
+				boundary = true;
+				return null;
+			}
+			return packet;
+		}
+	}
+
+	/**
+	 * Collects results of one shard without warm-up
+	 */
+	private static class ShardOutput extends AbstractSink<Tuple> {
+		long start;
+		long end;
+		ArrayList<Tuple> tuples = new ArrayList<Tuple>();
+		ArrayList<Long> timestamps = new ArrayList<Long>();
+
+		public void process(Tuple o, int srcID, long timestamp) {
+			if (timestamp < start || timestamp >= end) return;
+			// packet buffers are recycled by the shard
+			tuples.add(o instanceof PacketTuple ? o.copy() : o);
+			timestamps.add(timestamp);
+		}
+	}
+
+	private class Shard implements Callable<Integer> {
+		long start;
+		long end;
+		ShardSource source = new ShardSource();
+		ShardOutput output = new ShardOutput();
+		PipelineContext context = PipelineContext.getCurrent().fork();
+
+		public Integer call() throws Exception {
+			PipelineContext previous = context.activate();
+			try {
+				if (start != Long.MIN_VALUE) {
+					seek(source.reader, start, warmup);
+				}
+				int packets = Scheduler.runBatch(source);
+				if (source.boundary) {
+					// timers a sequential run would process before the next packet
+					Scheduler.getInstance().processTimers(end);
+				}
+				Scheduler.reset();
+				close(source.reader);
+				return packets;
+			} finally {
+				previous.activate();
+			}
+		}
+	}
+
+	private String fileName;
+	private PDL parser;
+	private GraphFactory factory;
+	private long warmup;
+
+	/**
+	 * @param fileName packet log or capture (CaptureWriter.SUFFIX)
+	 * @param parser
+	 * @param factory
+	 * @param warmup in ms, at least largest time window of graph
+	 */
+	public ShardedReplay(String fileName, PDL parser, GraphFactory factory, long warmup) {
+		this.fileName = fileName;
+		this.parser = parser;
+		this.factory = factory;
+		this.warmup = warmup;
+	}
+
+	/**
+	 * Process whole log and pass results to output
+	 * @param shardLength in ms
+	 * @param threads
+	 * @param output
+	 * @return nr of results
+	 * @throws IOException
+	 */
+	public int run(long shardLength, int threads, Sink<Tuple> output) throws IOException {
+		AbstractSource<PacketTuple> reader = openReader();
+		long range[];
+		if (reader instanceof CaptureReader) {
+			range = ((CaptureReader) reader).getTimeRange();
+		} else {
+			// builds time index once, before shards seek in parallel
+			range = ((LogReader) reader).getTimeRange();
+		}
+		close(reader);
+		if (range == null) return 0;
+
+		ArrayList<Shard> shards = new ArrayList<Shard>();
+		for (long start = range[0]; start <= range[1]; start += shardLength) {
+			Shard shard = new Shard();
+			shard.start = start;
+			shard.end = start + shardLength;
+			shards.add(shard);
+		}
+		shards.get(0).start = Long.MIN_VALUE;
+		shards.get(shards.size() - 1).end = Long.MAX_VALUE;
+
+		for (Shard shard : shards) {
+			shard.source.reader = openReader();
+			shard.source.end = shard.end;
+			shard.output.start = shard.start;
+			shard.output.end = shard.end;
+			factory.createGraph(shard.source, shard.output);
+		}
+
+		long startMillis = System.currentTimeMillis();
+		ExecutorService pool = Executors.newFixedThreadPool(threads);
+		ArrayList<Future<Integer>> results = new ArrayList<Future<Integer>>();
+		for (Shard shard : shards) {
+			results.add(pool.submit(shard));
+		}
+		int packets = 0;
+		int count = 0;
+		try {
+			for (int i = 0; i < shards.size(); i++) {
+				packets += results.get(i).get();
+				// pass results as soon as all earlier shards are done
+				ShardOutput shardOutput = shards.get(i).output;
+				for (int j = 0; j < shardOutput.tuples.size(); j++) {
+					output.process(shardOutput.tuples.get(j), 0, shardOutput.timestamps.get(j));
+				}
+				count += shardOutput.tuples.size();
+				shards.set(i, null);
+			}
+		} catch (InterruptedException e) {
+			throw new RuntimeException("ShardedReplay: interrupted", e);
+		} catch (ExecutionException e) {
+			throw new RuntimeException("ShardedReplay: shard failed", e.getCause());
+		} finally {
+			pool.shutdownNow();
+		}
+		long end = System.currentTimeMillis();
+		System.out.println("ShardedReplay: " + results.size() + " shards on " + threads + " threads. Duration: "
+				+ ((end - startMillis) / 1000) + " s. " + packets + " packets incl. warm-up, " + count + " results");
+		return count;
+	}
+
+	private AbstractSource<PacketTuple> openReader() throws IOException {
+		if (fileName.endsWith(CaptureWriter.SUFFIX)) {
+			return new CaptureReader(fileName, parser);
+		}
+		LogReader logReader = LogReader.createLogReaderFromFile(fileName);
+		logReader.setParser(parser);
+		return logReader;
+	}
+
+	private static void seek(AbstractSource<PacketTuple> reader, long time, long warmup) throws IOException {
+		if (reader instanceof CaptureReader) {
+			((CaptureReader) reader).seek(time, warmup);
+		} else {
+			((LogReader) reader).seek(time, warmup);
+		}
+	}
+
+	private static void close(AbstractSource<PacketTuple> reader) {
+		if (reader instanceof CaptureReader) {
+			((CaptureReader) reader).close();
+		}
+	}
+
+	/**
+	 * Run graph definitions on a packet log in parallel, see GraphPlanner
+	 *
+	 * @param args packet definition, packet log, warm-up (s), shard length (s), threads, graph definition(s)
+	 * @throws Exception
+	 */
+	public static void main(String args[]) throws Exception {
+		if (args.length < 6) {
+			System.out.println("Usage: ShardedReplay packet_definition packet_log warmup_s shard_s threads graph_definition [graph_definition ...]");
+			return;
+		}
+		final PDL parser = Parser.readDescription(args[0]);
+		long warmup = Long.parseLong(args[2]) * 1000;
+		long shardLength = Long.parseLong(args[3]) * 1000;
+		int threads = Integer.parseInt(args[4]);
+		final String graphs[] = new String[args.length - 5];
+		System.arraycopy(args, 5, graphs, 0, graphs.length);
+
+		ShardedReplay replay = new ShardedReplay(args[1], parser, new GraphFactory() {
+			@SuppressWarnings("unchecked")
+			public void createGraph(AbstractSource<PacketTuple> input, Sink<Tuple> output) {
+				GraphPlanner planner = new GraphPlanner(parser);
+				try {
+					for (String graph : graphs) {
+						planner.load(graph);
+					}
+				} catch (IOException e) {
+					throw new RuntimeException(e.getMessage());
+				}
+				planner.bindInput("packets", input);
+				planner.build();
+				for (String name : planner.getOutputs()) {
+					((Source<Tuple>) planner.getOperator(name)).subscribe(output, 0);
+				}
+			}
+		}, warmup);
+
+		Scheduler.batchSize = Scheduler.DEFAULT_BATCH_SIZE;
+		replay.run(shardLength, threads, new Sink<Tuple>() {
+			public void process(Tuple o, int srcID, long timestamp) {
+				System.out.println("" + timestamp + " -- " + o);
+			}
+		});
+	}
+}
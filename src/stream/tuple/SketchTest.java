@@ -0,0 +1,97 @@
+package stream.tuple;
+
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.HashMap;
+import java.util.Random;
+
+import util.SelfCheck;
+
+/**
+ * Self-check: error bounds of the HyperLogLog and SpaceSaving sketches
+ * 
+ * @author mringwal
+ *
+ */
+public class SketchTest {
+
+	private static void testHyperLogLog() {
+		int precision = 10;
+		// four times the standard error
+		double maxError = 4 * 1.04 / Math.sqrt(1 << precision);
+		int sizes[] = { 10, 100, 1000, 10000, 100000 };
+		for (int n : sizes) {
+			HyperLogLog sketch = new HyperLogLog(precision);
+			for (int i = 0; i < n; i++) {
+				sketch.add(i);
+				// duplicates don't count
+				sketch.add(i);
+			}
+			long estimate = sketch.estimate();
+			SelfCheck.check( Math.abs(estimate - n) <= Math.max( 2, maxError * n), "HyperLogLog estimated " + estimate + " for " + n);
+		}
+
+		// merge of two halves estimates the union
+		HyperLogLog lower = new HyperLogLog(precision);
+		HyperLogLog upper = new HyperLogLog(precision);
+		for (int i = 0; i < 20000; i++) {
+			if (i < 15000) lower.add(i);
+			if (i >= 5000) upper.add(i);
+		}
+		lower.merge(upper);
+		long estimate = lower.estimate();
+		SelfCheck.check( Math.abs(estimate - 20000) <= maxError * 20000, "HyperLogLog merged estimate " + estimate);
+		lower.merge(upper);
+		SelfCheck.check( lower.estimate() == estimate, "HyperLogLog merge not idempotent");
+		lower.clear();
+		SelfCheck.check( lower.estimate() == 0, "HyperLogLog not empty after clear");
+	}
+
+	private static void testSpaceSaving() {
+		int capacity = 20;
+		// item i occurs 2000 / (i+1) times, shuffled
+		ArrayList<Integer> stream = new ArrayList<Integer>();
+		HashMap<Integer, Integer> exact = new HashMap<Integer, Integer>();
+		for (int i = 0; i < 200; i++) {
+			int count = 2000 / (i + 1);
+			exact.put(i, count);
+			for (int j = 0; j < count; j++) {
+				stream.add(i);
+			}
+		}
+		Collections.shuffle(stream, new Random(1));
+		int total = stream.size();
+
+		SpaceSaving sketch = new SpaceSaving(capacity);
+		for (Integer item : stream) {
+			sketch.add(item);
+		}
+		sketch.sort();
+		SelfCheck.check( sketch.size() == capacity, "SpaceSaving size " + sketch.size());
+		for (int rank = 0; rank < sketch.size(); rank++) {
+			Integer item = (Integer) sketch.getItem(rank);
+			int count = sketch.getCount(rank);
+			SelfCheck.check( count >= exact.get(item), "SpaceSaving underestimates " + item + ": " + count);
+			SelfCheck.check( count - exact.get(item) <= total / capacity, "SpaceSaving overestimates " + item + ": " + count);
+			if (rank > 0) {
+				SelfCheck.check( count <= sketch.getCount(rank - 1), "SpaceSaving not sorted at rank " + rank);
+			}
+		}
+		// all items occurring more than total / capacity times are kept
+		for (int i = 0; i < 200; i++) {
+			if (exact.get(i) <= total / capacity) continue;
+			boolean found = false;
+			for (int rank = 0; rank < sketch.size(); rank++) {
+				if (sketch.getItem(rank).equals(i)) found = true;
+			}
+			SelfCheck.check( found, "SpaceSaving lost heavy hitter " + i);
+		}
+		SelfCheck.check( sketch.getItem(0).equals(0), "SpaceSaving top item " + sketch.getItem(0));
+	}
+
+	public static void main(String[] args) {
+		testHyperLogLog();
+		testSpaceSaving();
+		System.out.println("SketchTest: OK");
+	}
+}
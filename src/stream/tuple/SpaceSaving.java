@@ -0,0 +1,120 @@
+package stream.tuple;
+
+import java.util.HashMap;
+
+/**
+ * Space-Saving heavy hitter sketch
+ * 
+ * Keeps at most capacity items with their counts. If a new item arrives
+ * and the sketch is full, the item with the smallest count is replaced 
+ * and the new item inherits its count. Counts are overestimated by at most 
+ * total / capacity. Sketches can be merged by adding all counters.
+ * 
+ * @author mringwal
+ *
+ */
+public class SpaceSaving {
+
+	private Object items[];
+	private int counts[];
+	private int size = 0;
+	private HashMap<Object, Integer> index = new HashMap<Object, Integer>();
+	
+	/**
+	 * @param capacity max nr of counters
+	 */
+	public SpaceSaving(int capacity) {
+		items = new Object[capacity];
+		counts = new int[capacity];
+	}
+	
+	public void add(Object item) {
+		add(item, 1);
+	}
+	
+	public void add(Object item, int count) {
+		Integer position = index.get(item);
+		if (position != null) {
+			counts[position] += count;
+			return;
+		}
+		if (size < items.length) {
+			items[size] = item;
+			counts[size] = count;
+			index.put(item, size);
+			size++;
+			return;
+		}
+		// replace item with min count
+		int min = 0;
+		for (int i = 1; i < size; i++) {
+			if (counts[i] < counts[min]) {
+				min = i;
+			}
+		}
+		index.remove(items[min]);
+		items[min] = item;
+		counts[min] += count;
+		index.put(item, min);
+	}
+	
+	/**
+	 * add counters of other sketch
+	 * @param other
+	 */
+	public void merge(SpaceSaving other) {
+		for (int i = 0; i < other.size; i++) {
+			add(other.items[i], other.counts[i]);
+		}
+	}
+	
+	public void clear() {
+		for (int i = 0; i < size; i++) {
+			items[i] = null;
+		}
+		size = 0;
+		index.clear();
+	}
+	
+	public int size() {
+		return size;
+	}
+	
+	/**
+	 * sort counters by decreasing count, call before getItem/getCount
+	 */
+	public void sort() {
+		// insertion sort, capacity is small
+		for (int i = 1; i < size; i++) {
+			Object item = items[i];
+			int count = counts[i];
+			int j = i - 1;
+			while (j >= 0 && counts[j] < count) {
+				items[j+1] = items[j];
+				counts[j+1] = counts[j];
+				j--;
+			}
+			items[j+1] = item;
+			counts[j+1] = count;
+		}
+		for (int i = 0; i < size; i++) {
+			index.put(items[i], i);
+		}
+	}
+	
+	/**
+	 * @param rank 0 = most frequent item
+	 * @return item
+	 */
+	public Object getItem(int rank) {
+		return items[rank];
+	}
+
+	/**
+	 * @param rank 0 = most frequent item
+	 * @return estimated count
+	 */
+	public int getCount(int rank) {
+		return counts[rank];
+	}
+}
@@ -0,0 +1,185 @@
+package stream.tuple;
+
+import java.io.ByteArrayOutputStream;
+import java.io.DataOutputStream;
+import java.io.File;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.util.HashMap;
+
+import stream.AbstractSink;
+
+/**
+ * Store tuples on disk for later queries with TimeSeriesStore
+ *
+ * For each tuple type, a data file TYPE.ts and a sparse index TYPE.idx are written
+ * to the store directory. The data file starts with the type name and field names,
+ * followed by blocks of up to BLOCK_SIZE tuples. A block never spans more than one
+ * time partition of partitionLength ms. Blocks are stored column by column: first
+ * the timestamps, then the values of each field, each column prefixed by its length.
+ *
+ * For each block written, an index entry with its first and last timestamp,
+ * file offset, length and nr of tuples is appended to the index file.
+ *
+ * @author mringwal
+ *
+ */
+public class TimeSeriesSink extends AbstractSink<Tuple> {
+
+	public static final String DATA_SUFFIX = ".ts";
+	public static final String INDEX_SUFFIX = ".idx";
+	static final int MAGIC = 0x534e5453; // "SNTS"
+
+	/** max nr of tuples per block */
+	public static final int BLOCK_SIZE = 1024;
+
+	/** default time partition: one minute */
+	public static final long DEFAULT_PARTITION_LENGTH = 60 * 1000;
+
+	private class TypeWriter {
+		DataOutputStream data;
+		DataOutputStream index;
+		long offset;
+		TupleAttribute fields[];
+		long partition = -1;
+		int rows = 0;
+		long timestamps[] = new long[BLOCK_SIZE];
+		Object columns[][];
+	}
+
+	private File directory;
+	private long partitionLength;
+	private HashMap<String, TypeWriter> writers = new HashMap<String, TypeWriter>();
+
+	public TimeSeriesSink(File directory) {
+		this(directory, DEFAULT_PARTITION_LENGTH);
+	}
+
+	/**
+	 * @param directory store directory, created if necessary. Existing series are replaced
+	 * @param partitionLength in ms
+	 */
+	public TimeSeriesSink(File directory, long partitionLength) {
+		this.directory = directory;
+		this.partitionLength = partitionLength;
+		directory.mkdirs();
+	}
+
+	public void process(Tuple o, int srcID, long timestamp) {
+		try {
+			TypeWriter writer = writers.get(o.getType());
+			if (writer == null) {
+				writer = createWriter(o);
+				writers.put(o.getType(), writer);
+			}
+			long partition = timestamp / partitionLength;
+			if (writer.rows == BLOCK_SIZE || (writer.rows > 0 && partition != writer.partition)) {
+				writeBlock(writer);
+			}
+			writer.partition = partition;
+			writer.timestamps[writer.rows] = timestamp;
+			for (int i = 0; i < writer.fields.length; i++) {
+				writer.columns[i][writer.rows] = o.getAttribute(writer.fields[i]);
+			}
+			writer.rows++;
+		} catch (IOException e) {
+			e.printStackTrace();
+		}
+	}
+
+	/**
+	 * write all pending tuples
+	 */
+	public void flush() {
+		try {
+			for (TypeWriter writer : writers.values()) {
+				if (writer.rows > 0) {
+					writeBlock(writer);
+				}
+			}
+		} catch (IOException e) {
+			e.printStackTrace();
+		}
+	}
+
+	/**
+	 * write all pending tuples and close files
+	 */
+	public void close() {
+		flush();
+		try {
+			for (TypeWriter writer : writers.values()) {
+				writer.data.close();
+				writer.index.close();
+			}
+		} catch (IOException e) {
+			e.printStackTrace();
+		}
+		writers.clear();
+	}
+
+	private TypeWriter createWriter(Tuple tuple) throws IOException {
+		TypeWriter writer = new TypeWriter();
+		String type = tuple.getType();
+		// field 0 is tuple type
+		TupleAttribute attributes[] = tuple.getPrototype().fieldAttributes;
+		writer.fields = new TupleAttribute[attributes.length - 1];
+		System.arraycopy(attributes, 1, writer.fields, 0, writer.fields.length);
+		writer.columns = new Object[writer.fields.length][BLOCK_SIZE];
+
+		writer.data = new DataOutputStream(new FileOutputStream(new File(directory, type + DATA_SUFFIX)));
+		writer.index = new DataOutputStream(new FileOutputStream(new File(directory, type + INDEX_SUFFIX)));
+		writer.data.writeInt(MAGIC);
+		writer.data.writeUTF(type);
+		writer.data.writeShort(writer.fields.length);
+		for (TupleAttribute field : writer.fields) {
+			writer.data.writeUTF(field.getName());
+		}
+		writer.data.flush();
+		writer.offset = writer.data.size();
+		return writer;
+	}
+
+	private void writeBlock(TypeWriter writer) throws IOException {
+		ByteArrayOutputStream block = new ByteArrayOutputStream();
+		DataOutputStream out = new DataOutputStream(block);
+		out.writeInt(writer.rows);
+		out.writeLong(writer.timestamps[0]);
+		for (int row = 1; row < writer.rows; row++) {
+			out.writeInt((int) (writer.timestamps[row] - writer.timestamps[row-1]));
+		}
+		ByteArrayOutputStream column = new ByteArrayOutputStream();
+		for (int i = 0; i < writer.fields.length; i++) {
+			// each column is self-contained, so it can be skipped
+			column.reset();
+			DataOutputStream columnOut = new DataOutputStream(column);
+			TupleCodec codec = new TupleCodec();
+			for (int row = 0; row < writer.rows; row++) {
+				codec.writeValue(columnOut, writer.columns[i][row]);
+				writer.columns[i][row] = null;
+			}
+			columnOut.flush();
+			out.writeInt(column.size());
+			column.writeTo(out);
+		}
+		out.flush();
+
+		// data first, index entries always refer to complete blocks
+		block.writeTo(writer.data);
+		writer.data.flush();
+		long first = writer.timestamps[0];
+		long last = writer.timestamps[0];
+		for (int row = 1; row < writer.rows; row++) {
+			first = Math.min(first, writer.timestamps[row]);
+			last = Math.max(last, writer.timestamps[row]);
+		}
+		writer.index.writeLong(first);
+		writer.index.writeLong(last);
+		writer.index.writeLong(writer.offset);
+		writer.index.writeInt(block.size());
+		writer.index.writeInt(writer.rows);
+		writer.index.flush();
+		writer.offset += block.size();
+		writer.rows = 0;
+	}
+}
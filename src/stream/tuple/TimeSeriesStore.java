@@ -0,0 +1,242 @@
+package stream.tuple;
+
+import java.io.ByteArrayInputStream;
+import java.io.DataInputStream;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.util.ArrayList;
+import java.util.List;
+
+import stream.Sink;
+
+/**
+ * Query tuples written by a TimeSeriesSink
+ *
+ * Only blocks overlapping the requested time range are read, using the sparse index.
+ * If a field value is given, only the column of this field is decoded for blocks
+ * without a match. The index is re-read for each query, so a store can be queried
+ * while it is still written.
+ *
+ * @author mringwal
+ *
+ */
+public class TimeSeriesStore {
+
+	private static final int INDEX_ENTRY_SIZE = 8 + 8 + 8 + 4 + 4;
+
+	private File directory;
+
+	public TimeSeriesStore(File directory) {
+		this.directory = directory;
+	}
+
+	/**
+	 * @return stored tuple types
+	 */
+	public List<String> getTupleTypes() {
+		ArrayList<String> types = new ArrayList<String>();
+		String files[] = directory.list();
+		if (files == null) return types;
+		for (String file : files) {
+			if (file.endsWith(TimeSeriesSink.DATA_SUFFIX)) {
+				types.add(file.substring(0, file.length() - TimeSeriesSink.DATA_SUFFIX.length()));
+			}
+		}
+		return types;
+	}
+
+	/**
+	 * @param type
+	 * @return field names of stored type
+	 * @throws IOException
+	 */
+	public String[] getFields(String type) throws IOException {
+		DataInputStream in = new DataInputStream(new FileInputStream(new File(directory, type + TimeSeriesSink.DATA_SUFFIX)));
+		try {
+			return readHeader(in, type);
+		} finally {
+			in.close();
+		}
+	}
+
+	/**
+	 * Pass all tuples of type within [from, to] to sink
+	 * @return nr of tuples
+	 * @throws IOException
+	 */
+	public int query(String type, long from, long to, Sink<Tuple> sink) throws IOException {
+		return query(type, from, to, null, null, sink);
+	}
+
+	/**
+	 * Pass all tuples of type within [from, to] that have the given field value to sink,
+	 * e.g. the series of a single node
+	 * @param type
+	 * @param from
+	 * @param to
+	 * @param field field name or null
+	 * @param value
+	 * @param sink
+	 * @return nr of tuples
+	 * @throws IOException
+	 */
+	public int query(String type, long from, long to, String field, Object value, Sink<Tuple> sink) throws IOException {
+		String fields[] = getFields(type);
+		int filterColumn = -1;
+		for (int i = 0; i < fields.length; i++) {
+			if (fields[i].equals(field)) {
+				filterColumn = i;
+			}
+		}
+		if (field != null && filterColumn < 0) {
+			return 0;
+		}
+		Tuple.registerTupleType(type, fields);
+		int tupleTypeID = Tuple.getTupleTypeID(type);
+		TupleAttribute attributes[] = new TupleAttribute[fields.length];
+		for (int i = 0; i < fields.length; i++) {
+			attributes[i] = new TupleAttribute(fields[i]);
+		}
+
+		long index[][] = readIndex(type);
+		int count = 0;
+		RandomAccessFile data = new RandomAccessFile(new File(directory, type + TimeSeriesSink.DATA_SUFFIX), "r");
+		try {
+			for (long entry[] : index) {
+				// first, last, offset, length, rows
+				if (entry[1] < from) continue;
+				if (entry[0] > to) break;
+				byte block[] = new byte[(int) entry[3]];
+				data.seek(entry[2]);
+				data.readFully(block);
+				count += readBlock(block, fields.length, from, to, filterColumn, value, tupleTypeID, attributes, sink);
+			}
+		} finally {
+			data.close();
+		}
+		return count;
+	}
+
+	private int readBlock(byte block[], int nrFields, long from, long to, int filterColumn, Object value,
+			int tupleTypeID, TupleAttribute attributes[], Sink<Tuple> sink) throws IOException {
+		DataInputStream in = new DataInputStream(new ByteArrayInputStream(block));
+		int rows = in.readInt();
+		long timestamps[] = new long[rows];
+		timestamps[0] = in.readLong();
+		for (int row = 1; row < rows; row++) {
+			timestamps[row] = timestamps[row-1] + in.readInt();
+		}
+		// column positions
+		int columnStart[] = new int[nrFields];
+		int position = 4 + 8 + 4 * (rows - 1);
+		for (int i = 0; i < nrFields; i++) {
+			int length = readInt(block, position);
+			columnStart[i] = position + 4;
+			position += 4 + length;
+		}
+
+		boolean selected[] = new boolean[rows];
+		int nrSelected = 0;
+		for (int row = 0; row < rows; row++) {
+			selected[row] = timestamps[row] >= from && timestamps[row] <= to;
+		}
+		Object values[][] = new Object[nrFields][];
+		if (filterColumn >= 0) {
+			values[filterColumn] = readColumn(block, columnStart[filterColumn], rows);
+			for (int row = 0; row < rows; row++) {
+				if (selected[row] && !value.equals(values[filterColumn][row])) {
+					selected[row] = false;
+				}
+			}
+		}
+		for (int row = 0; row < rows; row++) {
+			if (selected[row]) nrSelected++;
+		}
+		if (nrSelected == 0) return 0;
+
+		for (int i = 0; i < nrFields; i++) {
+			if (values[i] == null) {
+				values[i] = readColumn(block, columnStart[i], rows);
+			}
+		}
+		for (int row = 0; row < rows; row++) {
+			if (!selected[row]) continue;
+			Tuple tuple = Tuple.createTuple(tupleTypeID);
+			for (int i = 0; i < nrFields; i++) {
+				tuple.setAttribute(attributes[i], values[i][row]);
+			}
+			sink.process(tuple, 0, timestamps[row]);
+		}
+		return nrSelected;
+	}
+
+	private Object[] readColumn(byte block[], int start, int rows) throws IOException {
+		DataInputStream in = new DataInputStream(new ByteArrayInputStream(block, start, block.length - start));
+		TupleCodec codec = new TupleCodec();
+		Object column[] = new Object[rows];
+		for (int row = 0; row < rows; row++) {
+			column[row] = codec.readValue(in);
+		}
+		return column;
+	}
+
+	private static int readInt(byte buffer[], int pos) {
+		return ((buffer[pos] & 0xff) << 24) | ((buffer[pos+1] & 0xff) << 16)
+			| ((buffer[pos+2] & 0xff) << 8) | (buffer[pos+3] & 0xff);
+	}
+
+	private String[] readHeader(DataInputStream in, String type) throws IOException {
+		if (in.readInt() != TimeSeriesSink.MAGIC || !in.readUTF().equals(type)) {
+			throw new IOException("TimeSeriesStore: " + type + " is not a time series");
+		}
+		String fields[] = new String[in.readUnsignedShort()];
+		for (int i = 0; i < fields.length; i++) {
+			fields[i] = in.readUTF();
+		}
+		return fields;
+	}
+
+	private long[][] readIndex(String type) throws IOException {
+		File file = new File(directory, type + TimeSeriesSink.INDEX_SUFFIX);
+		// ignore partially written entry
+		int entries = (int) (file.length() / INDEX_ENTRY_SIZE);
+		long index[][] = new long[entries][];
+		DataInputStream in = new DataInputStream(new FileInputStream(file));
+		try {
+			for (int i = 0; i < entries; i++) {
+				index[i] = new long[] { in.readLong(), in.readLong(), in.readLong(), in.readInt(), in.readInt() };
+			}
+		} finally {
+			in.close();
+		}
+		return index;
+	}
+
+	/**
+	 * print the series of one node
+	 * @param args directory nodeID [from to] (s)
+	 */
+	public static void main(String args[]) throws IOException {
+		if (args.length < 2) {
+			System.out.println("Usage: TimeSeriesStore directory nodeID [from to]");
+			return;
+		}
+		TimeSeriesStore store = new TimeSeriesStore(new File(args[0]));
+		Integer nodeID = Integer.parseInt(args[1]);
+		long from = 0;
+		long to = Long.MAX_VALUE;
+		if (args.length >= 4) {
+			from = Long.parseLong(args[2]) * 1000;
+			to   = Long.parseLong(args[3]) * 1000;
+		}
+		for (final String type : store.getTupleTypes()) {
+			store.query(type, from, to, "nodeID", nodeID, new Sink<Tuple>() {
+				public void process(Tuple o, int srcID, long timestamp) {
+					System.out.println("" + timestamp / 1000 + " -- " + type + o);
+				}
+			});
+		}
+	}
+}
@@ -1,11 +1,15 @@
 package stream.tuple;
 
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.IOException;
 import java.util.HashMap;
 import java.util.LinkedList;
 
 import model.NodeAddress;
 
 import stream.AbstractPipe;
+import stream.Checkpointable;
 import stream.Scheduler;
 import stream.TimeStampedObject;
 import stream.TimeTriggered;
@@ -18,7 +22,7 @@ import stream.TimeTriggered;
  * @todo: limit validation by post-poning validation. but have to use timer for this
  */
 public class TopologyAnalyzer extends AbstractPipe<Tuple,Tuple> implements
-		TimeTriggered {
+		TimeTriggered, Checkpointable {
 
 	/** single downlink and its timeout */
 	private class DownLink {
@@ -285,4 +289,58 @@ public class TopologyAnalyzer extends AbstractPipe<Tuple,Tuple> implements
 		// check nodes
 		if (validate) validateNew( timestamp );
 	}
+
+	public void saveState(DataOutputStream out) throws IOException {
+		TupleCodec codec = new TupleCodec();
+		out.writeLong(lastEvaluation);
+		out.writeInt(nodeStates.size());
+		for (NodeState nodeState : nodeStates.values()) {
+			out.writeUTF(nodeState.nodeId.toString());
+			out.writeUTF(nodeState.partitionCause);
+			out.writeLong(nodeState.evaluationTime);
+			out.writeBoolean(nodeState.inEvaluation);
+			codec.writeValue(out, nodeState.stateTuple);
+			out.writeInt(nodeState.downLinks.size());
+			for (DownLink dl : nodeState.downLinks.values()) {
+				out.writeUTF(dl.downLink.toString());
+				out.writeLong(dl.timeout);
+			}
+		}
+		out.writeInt(window.size());
+		for (TimeStampedObject<Tuple> element : window) {
+			out.writeLong(element.timestamp);
+			codec.writeValue(out, element.object);
+		}
+	}
+
+	public void restoreState(DataInputStream in, long timeShift) throws IOException {
+		TupleCodec codec = new TupleCodec();
+		nodeStates.clear();
+		window.clear();
+		lastEvaluation = in.readLong() + timeShift;
+		int count = in.readInt();
+		for (int i = 0; i < count; i++) {
+			NodeState nodeState = new NodeState( new NodeAddress(in.readUTF()));
+			nodeState.partitionCause = in.readUTF();
+			nodeState.evaluationTime = in.readLong() + timeShift;
+			nodeState.inEvaluation = in.readBoolean();
+			nodeState.stateTuple = (Tuple) codec.readValue(in);
+			int nrDownLinks = in.readInt();
+			for (int j = 0; j < nrDownLinks; j++) {
+				NodeAddress addr = new NodeAddress(in.readUTF());
+				nodeState.downLinks.put( addr, new DownLink( addr, in.readLong() + timeShift));
+			}
+			nodeStates.put( nodeState.nodeId, nodeState);
+		}
+		// sink is always known
+		if (!nodeStates.containsKey(sink)) {
+			nodeStates.put( sink, new NodeState( sink ));
+		}
+		count = in.readInt();
+		for (int i = 0; i < count; i++) {
+			long timestamp = in.readLong() + timeShift;
+			window.addLast( new TimeStampedObject<Tuple>(timestamp, codec.readTupleValue(in)));
+			Scheduler.getInstance().registerTimeout( timestamp + timewindow, this);
+		}
+	}
 }
@@ -1,13 +1,19 @@
 package stream.tuple;
 
-import java.util.ArrayList;
-import java.util.HashMap;
+import java.util.List;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.CopyOnWriteArrayList;
+
+import stream.PipelineContext;
 
 /**
  * Tuple interface
  * 
  * Tuples always have a type. Type-safe access is provided by different accessor methods
  * To create a tuple a factory-method is used
+ * 
+ * Type names are resolved by the TupleSchema of the current PipelineContext.
+ * Type IDs and attribute IDs are unique in the process.
  * @author mringwal
  */
 public class Tuple {
@@ -33,10 +39,12 @@ public class Tuple {
 			this.id = id;
 		}
 	}
-	static HashMap<String, Integer> registeredTuples = new HashMap<String,Integer>();  
-	static HashMap<String, Integer> registeredAttributeNames = new HashMap<String,Integer>();;
-	static ArrayList<TupleType> tuplesList = new ArrayList<TupleType>();
-	public static ArrayList<String> attributeList = new ArrayList<String>();
+	/** attributes of all schemas, read without lock by operators on any thread */
+	static ConcurrentHashMap<String, Integer> registeredAttributeNames = new ConcurrentHashMap<String,Integer>();
+	public static List<String> attributeList = new CopyOnWriteArrayList<String>();
+
+	/** types of all schemas by type ID, replaced on registration */
+	private static volatile TupleType tupleTypes[] = new TupleType[0];
 	
 	TupleType prototype;
 	int tupleTypeId;
@@ -47,7 +55,7 @@ public class Tuple {
 	 * @param attribute
 	 * @return
 	 */
-	public static void registerTupleField( String attribute) {
+	public static synchronized void registerTupleField( String attribute) {
 		if (registeredAttributeNames.containsKey(attribute)) {
 			return; // getAttributeId( attribute );
 		}
@@ -57,45 +65,30 @@ public class Tuple {
 		return; //   fieldID;
 	}
 	
+	/**
+	 * Register tuple type with the schema of the current PipelineContext
+	 * @param type
+	 * @param fields
+	 * @return type ID
+	 */
 	public static int registerTupleType( String type, String... fields) {
-		if (registeredTuples.containsKey(type)) {
-			// compare
-			int oldTupleID = registeredTuples.get( type );
-			TupleType oldTuple = tuplesList.get( oldTupleID);
-			// check, if attribues match
-			for (String field : fields ) {
-				// check if 
-				int fieldID = getAttributeId( field );
-				if (oldTuple.id2field[fieldID] < 0) {
-					throw new RuntimeException("Tuple "+type+" registered twice with different fields. Previous registration lacks field "+field);
-				}
-			}
-			for (TupleAttribute attribute : oldTuple.fieldAttributes) {
-				if (attribute.getName().equals("TupleType")) {
-					continue;
-				}
-				boolean found = false;
-				for (String field : fields ) {
-					if (attribute.getName().equals(field)) {
-						found = true;
-						break;
-					}
-				}
-				if (!found) {
-					throw new RuntimeException("Tuple "+type+" registered twice with different fields. New registration lacks field "+attribute.getName());
-				}
-			}
-			return oldTupleID;
-		}
+		return PipelineContext.getCurrent().getSchema().registerTupleType(type, fields);
+	}
+
+	/**
+	 * Create new tuple type with an ID unique in the process. Used by TupleSchema
+	 * @param type
+	 * @param fields
+	 * @return type ID
+	 */
+	static synchronized int createTupleType( String type, String... fields) {
 		// assert all fields are registered
 		if (registeredAttributeNames.size() == 0) {
 			registerTupleField("TupleType");
 		}
 		// register new tuple type
-		int newTupleID = tuplesList.size();
+		int newTupleID = tupleTypes.length;
 		TupleType newType = new TupleType( type, newTupleID);
-		tuplesList.add(newType);
-		registeredTuples.put( type, newTupleID);
 
 		// create prototype
 		newType.fieldAttributes = new TupleAttribute[fields.length+1];
@@ -114,15 +107,33 @@ public class Tuple {
 		for (int i = 0; i<newType.fieldAttributes.length; i++) {
 			newType.id2field[newType.fieldAttributes[i].getID()] = i;
 		}
+
+		// publish
+		TupleType newTypes[] = new TupleType[newTupleID + 1];
+		System.arraycopy(tupleTypes, 0, newTypes, 0, newTupleID);
+		newTypes[newTupleID] = newType;
+		tupleTypes = newTypes;
 		return newTupleID;
 	}
 
+	static TupleType getTupleType( int typeID) {
+		return tupleTypes[typeID];
+	}
+
+	/**
+	 * @param type
+	 * @return type ID in schema of the current PipelineContext
+	 */
 	public static int  getTupleTypeID( String type) {
-		Integer typeID = registeredTuples.get( type );
-		if (typeID == null) {
-			throw new RuntimeException("TupleType "+type+" not registered");
-		}
-		return typeID;
+		return PipelineContext.getCurrent().getSchema().getTupleTypeID(type);
+	}
+
+	/**
+	 * @param type
+	 * @return true, if type is registered in schema of the current PipelineContext
+	 */
+	public static boolean isTupleTypeRegistered( String type) {
+		return PipelineContext.getCurrent().getSchema().isRegistered(type);
 	}
 	
 	public static Tuple createTuple(String type) {
@@ -130,7 +141,7 @@ public class Tuple {
 	}
 	
 	public static Tuple createTuple(int typeID) {
-		TupleType prototype = tuplesList.get( typeID);
+		TupleType prototype = tupleTypes[typeID];
 		Tuple newTuple = new Tuple();
 		newTuple.tupleTypeId = typeID;
 		newTuple.values = new Object[ prototype.fieldAttributes.length];
@@ -175,7 +186,39 @@ public class Tuple {
 	public String getType() {
 		return prototype.name;
 	}
+
+	/**
+	 * @return tuple of same type with same attribute values (shallow copy)
+	 */
+	public Tuple copy() {
+		Tuple newTuple = createTuple(tupleTypeId);
+		System.arraycopy(values, 0, newTuple.values, 0, values.length);
+		return newTuple;
+	}
 	
+	/**
+	 * @param other
+	 * @return true, if other tuple has same type and equal attribute values
+	 */
+	public boolean equalValues(Tuple other) {
+		if (other == null || other.prototype != prototype) return false;
+		for (int i = 1; i < values.length; i++) {
+			if (!equalValue(values[i], other.values[i])) return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @return true, if both values are null or equal. Numbers of different classes are compared by value
+	 */
+	public static boolean equalValue(Object value, Object other) {
+		if (value == null || other == null) return value == other;
+		if (value.getClass() != other.getClass() && value instanceof Number && other instanceof Number) {
+			return ((Number) value).doubleValue() == ((Number) other).doubleValue();
+		}
+		return value.equals(other);
+	}
+
 	public TupleType getPrototype() {
 		return prototype;
 	}
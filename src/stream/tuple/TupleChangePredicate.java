@@ -1,10 +1,15 @@
 package stream.tuple;
 
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.IOException;
 import java.util.HashMap;
+import java.util.Map;
 
+import stream.Checkpointable;
 import stream.Predicate;
 
-public class TupleChangePredicate extends Predicate<Tuple> {
+public class TupleChangePredicate extends Predicate<Tuple> implements Checkpointable {
 	
 	HashMap<Object, Tuple> nodes = new HashMap<Object, Tuple>();
 	TupleAttribute idFieldID;
@@ -28,7 +33,7 @@ public class TupleChangePredicate extends Predicate<Tuple> {
 			for (int i = 0; i < nrFields; i++) {
 				Object oldValue = lastState.getAttribute(compareFieldIDs[i]);
 				Object newValue = o.getAttribute(compareFieldIDs[i]);
-				if ( !oldValue.toString().equals( newValue.toString())) {
+				if ( !Tuple.equalValue( oldValue, newValue)) {
 					stateChange = true;
 					break;
 				}
@@ -49,4 +54,23 @@ public class TupleChangePredicate extends Predicate<Tuple> {
 			compareFieldIDs[i] = new TupleAttribute( compareFields[i]);
 		}
 	}
+
+	public void saveState(DataOutputStream out) throws IOException {
+		TupleCodec codec = new TupleCodec();
+		out.writeInt(nodes.size());
+		for (Map.Entry<Object, Tuple> entry : nodes.entrySet()) {
+			codec.writeValue(out, entry.getKey());
+			codec.writeValue(out, entry.getValue());
+		}
+	}
+
+	public void restoreState(DataInputStream in, long timeShift) throws IOException {
+		TupleCodec codec = new TupleCodec();
+		nodes.clear();
+		int count = in.readInt();
+		for (int i = 0; i < count; i++) {
+			Object nodeID = codec.readValue(in);
+			nodes.put( nodeID, codec.readTupleValue(in));
+		}
+	}
 }
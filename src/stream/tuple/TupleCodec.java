@@ -0,0 +1,183 @@
+package stream.tuple;
+
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.HashMap;
+
+import packetparser.DecodedPacket;
+import packetparser.PDL;
+
+/**
+ * Compact binary encoding of tuples and attribute values.
+ * 
+ * Tuple types are written once per codec instance with name and field names, further
+ * tuples of the same type only refer to it by number. When reading, fields are matched
+ * by name, so the tuple type may have changed in the meantime.
+ * 
+ * A codec instance must be used for a single stream only. 
+ *  
+ * @author mringwal
+ *
+ */
+public class TupleCodec {
+
+	private static final byte NULL         = 0;
+	private static final byte INTEGER      = 1;
+	private static final byte LONG         = 2;
+	private static final byte DOUBLE       = 3;
+	private static final byte FLOAT        = 4;
+	private static final byte STRING       = 5;
+	private static final byte BOOLEAN      = 6;
+	private static final byte TUPLE        = 7;
+	private static final byte PACKET_TUPLE = 8;
+	private static final byte NEW_TYPE     = 9;
+	
+	/** parser used to decode packet tuples */
+	private static PDL parser = null;
+	
+	/** type description read from stream */
+	private class StoredType {
+		String name;
+		TupleAttribute fields[];
+	}
+	
+	private HashMap<String, Integer> writtenTypes = new HashMap<String, Integer>();
+	private ArrayList<StoredType> readTypes = new ArrayList<StoredType>();
+	
+	public static void setParser(PDL pdl) {
+		parser = pdl;
+	}
+	
+	public void writeValue(DataOutputStream out, Object value) throws IOException {
+		if (value == null) {
+			out.writeByte(NULL);
+		} else if (value instanceof Integer) {
+			out.writeByte(INTEGER);
+			out.writeInt((Integer) value);
+		} else if (value instanceof Long) {
+			out.writeByte(LONG);
+			out.writeLong((Long) value);
+		} else if (value instanceof Double) {
+			out.writeByte(DOUBLE);
+			out.writeDouble((Double) value);
+		} else if (value instanceof Float) {
+			out.writeByte(FLOAT);
+			out.writeFloat((Float) value);
+		} else if (value instanceof String) {
+			out.writeByte(STRING);
+			out.writeUTF((String) value);
+		} else if (value instanceof Boolean) {
+			out.writeByte(BOOLEAN);
+			out.writeBoolean((Boolean) value);
+		} else if (value instanceof PacketTuple) {
+			PacketTuple packetTuple = (PacketTuple) value;
+			out.writeByte(PACKET_TUPLE);
+			out.writeLong(packetTuple.time_ms);
+			writeValue(out, packetTuple.dsnNode);
+			byte raw[] = packetTuple.getRaw();
+			out.writeByte(raw.length);
+			out.write(raw);
+		} else if (value instanceof Tuple) {
+			writeTuple(out, (Tuple) value);
+		} else {
+			throw new IOException("TupleCodec: cannot encode " + value.getClass().getName());
+		}
+	}
+	
+	private void writeTuple(DataOutputStream out, Tuple tuple) throws IOException {
+		Tuple.TupleType type = tuple.prototype;
+		Integer typeNr = writtenTypes.get(type.name);
+		if (typeNr == null) {
+			typeNr = writtenTypes.size();
+			writtenTypes.put(type.name, typeNr);
+			out.writeByte(NEW_TYPE);
+			out.writeUTF(type.name);
+			out.writeByte(type.fieldAttributes.length);
+			for (TupleAttribute field : type.fieldAttributes) {
+				out.writeUTF(field.getName());
+			}
+		} else {
+			out.writeByte(TUPLE);
+		}
+		out.writeShort(typeNr);
+		// field 0 is tuple type
+		for (int i = 1; i < tuple.values.length; i++) {
+			writeValue(out, tuple.values[i]);
+		}
+	}
+	
+	public Object readValue(DataInputStream in) throws IOException {
+		byte tag = in.readByte();
+		switch (tag) {
+		case NULL:
+			return null;
+		case INTEGER:
+			return in.readInt();
+		case LONG:
+			return in.readLong();
+		case DOUBLE:
+			return in.readDouble();
+		case FLOAT:
+			return in.readFloat();
+		case STRING:
+			return in.readUTF();
+		case BOOLEAN:
+			return in.readBoolean();
+		case PACKET_TUPLE:
+			long time = in.readLong();
+			String dsnNode = (String) readValue(in);
+			byte raw[] = new byte[in.readUnsignedByte()];
+			in.readFully(raw);
+			PacketTuple packetTuple = new PacketTuple( DecodedPacket.createPacketFromBuffer(parser, raw), time);
+			packetTuple.setDsnNode(dsnNode);
+			return packetTuple;
+		case NEW_TYPE:
+			StoredType storedType = new StoredType();
+			storedType.name = in.readUTF();
+			storedType.fields = new TupleAttribute[in.readUnsignedByte()];
+			for (int i = 0; i < storedType.fields.length; i++) {
+				storedType.fields[i] = new TupleAttribute(in.readUTF());
+			}
+			readTypes.add(storedType);
+			return readTuple(in);
+		case TUPLE:
+			return readTuple(in);
+		default:
+			throw new IOException("TupleCodec: unknown tag " + tag);
+		}
+	}
+
+	private Tuple readTuple(DataInputStream in) throws IOException {
+		StoredType storedType = readTypes.get( in.readShort());
+		if (!Tuple.isTupleTypeRegistered(storedType.name)) {
+			String fields[] = new String[storedType.fields.length-1];
+			for (int i = 1; i < storedType.fields.length; i++) {
+				fields[i-1] = storedType.fields[i].getName();
+			}
+			Tuple.registerTupleType(storedType.name, fields);
+		}
+		Tuple tuple = Tuple.createTuple(storedType.name);
+		for (int i = 1; i < storedType.fields.length; i++) {
+			Object value = readValue(in);
+			// skip fields not present anymore
+			Integer attributeID = Tuple.registeredAttributeNames.get( storedType.fields[i].getName());
+			if (attributeID == null || attributeID >= tuple.prototype.id2field.length 
+					|| tuple.prototype.id2field[attributeID] < 0) {
+				continue;
+			}
+			tuple.values[tuple.prototype.id2field[attributeID]] = value;
+		}
+		return tuple;
+	}
+	
+	/**
+	 * @param in
+	 * @return tuple read
+	 * @throws IOException
+	 */
+	public Tuple readTupleValue(DataInputStream in) throws IOException {
+		return (Tuple) readValue(in);
+	}
+}
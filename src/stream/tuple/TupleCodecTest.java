@@ -0,0 +1,79 @@
+package stream.tuple;
+
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.IOException;
+
+import stream.PipelineContext;
+import util.SelfCheck;
+
+/**
+ * Self-check: tuples and values survive a TupleCodec round-trip
+ * 
+ * @author mringwal
+ *
+ */
+public class TupleCodecTest {
+
+	private static ByteArrayOutputStream buffer = new ByteArrayOutputStream();
+
+	private static DataInputStream write(TupleCodec codec, Object values[]) throws IOException {
+		buffer.reset();
+		DataOutputStream out = new DataOutputStream(buffer);
+		for (Object value : values) {
+			codec.writeValue(out, value);
+		}
+		out.flush();
+		return new DataInputStream( new ByteArrayInputStream( buffer.toByteArray()));
+	}
+
+	public static void main(String[] args) throws IOException {
+		PipelineContext previous = new PipelineContext("TupleCodecTest").activate();
+		int typeID = Tuple.registerTupleType("CodecTest", "name", "count", "ratio", "nested");
+		TupleAttribute name = new TupleAttribute("name");
+		TupleAttribute count = new TupleAttribute("count");
+		TupleAttribute ratio = new TupleAttribute("ratio");
+		TupleAttribute nested = new TupleAttribute("nested");
+
+		Tuple inner = Tuple.createTuple(typeID);
+		inner.setAttribute(name, "inner");
+		inner.setIntAttribute(count, -1);
+		Tuple outer = Tuple.createTuple(typeID);
+		outer.setAttribute(name, "outer");
+		outer.setIntAttribute(count, 42);
+		outer.setAttribute(ratio, 0.25);
+		outer.setAttribute(nested, inner);
+
+		// scalars, a new type and a known type
+		Object values[] = { null, 7, 1L << 40, 1.5, 2.5f, "text", true, outer, inner };
+		DataInputStream in = write(new TupleCodec(), values);
+		TupleCodec reader = new TupleCodec();
+		for (int i = 0; i < 7; i++) {
+			Object value = reader.readValue(in);
+			SelfCheck.check( Tuple.equalValue(values[i], value), "value " + values[i] + " read as " + value);
+			SelfCheck.check( value == null || value.getClass() == values[i].getClass(), "class of " + values[i] + " changed");
+		}
+		Tuple readOuter = reader.readTupleValue(in);
+		SelfCheck.check( readOuter.getType().equals("CodecTest"), "type " + readOuter.getType());
+		SelfCheck.check( "outer".equals(readOuter.getAttribute(name)), "name " + readOuter);
+		SelfCheck.check( readOuter.getIntAttribute(count) == 42, "count " + readOuter);
+		SelfCheck.check( ((Double) readOuter.getAttribute(ratio)) == 0.25, "ratio " + readOuter);
+		SelfCheck.check( inner.equalValues((Tuple) readOuter.getAttribute(nested)), "nested " + readOuter);
+		SelfCheck.check( inner.equalValues(reader.readTupleValue(in)), "second tuple of known type");
+		SelfCheck.check( in.available() == 0, in.available() + " bytes left");
+
+		// fields are matched by name, fields unknown to the reading schema are skipped
+		new PipelineContext("TupleCodecTest-reader").activate();
+		Tuple.registerTupleType("CodecTest", "count", "name");
+		in = write(new TupleCodec(), new Object[] { outer });
+		Tuple changed = new TupleCodec().readTupleValue(in);
+		SelfCheck.check( "outer".equals(changed.getAttribute(name)), "name after type change " + changed);
+		SelfCheck.check( changed.getIntAttribute(count) == 42, "count after type change " + changed);
+		SelfCheck.check( changed.getPrototype().fieldAttributes.length == 3, "fields after type change " + changed);
+
+		previous.activate();
+		System.out.println("TupleCodecTest: OK");
+	}
+}
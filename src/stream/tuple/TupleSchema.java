@@ -0,0 +1,81 @@
+package stream.tuple;
+
+import java.util.HashMap;
+
+import stream.tuple.Tuple.TupleType;
+
+/**
+ * Tuple types of an analysis graph, see PipelineContext
+ *
+ * Maps type names to type IDs. A type name can be registered with different fields
+ * in different schemas. Type IDs are unique in the process, so tuples can be passed
+ * between graphs with different schemas.
+ *
+ * @author mringwal
+ *
+ */
+public class TupleSchema {
+
+	private HashMap<String, Integer> registeredTuples = new HashMap<String, Integer>();
+
+	/**
+	 * Register tuple type. Can be called multiple times with the same fields
+	 * @param type
+	 * @param fields
+	 * @return type ID
+	 */
+	public synchronized int registerTupleType(String type, String... fields) {
+		if (registeredTuples.containsKey(type)) {
+			// compare
+			int oldTupleID = registeredTuples.get( type );
+			TupleType oldTuple = Tuple.getTupleType( oldTupleID);
+			// check, if attribues match
+			for (String field : fields ) {
+				// check if
+				int fieldID = Tuple.getAttributeId( field );
+				if (fieldID >= oldTuple.id2field.length || oldTuple.id2field[fieldID] < 0) {
+					throw new RuntimeException("Tuple "+type+" registered twice with different fields. Previous registration lacks field "+field);
+				}
+			}
+			for (TupleAttribute attribute : oldTuple.fieldAttributes) {
+				if (attribute.getName().equals("TupleType")) {
+					continue;
+				}
+				boolean found = false;
+				for (String field : fields ) {
+					if (attribute.getName().equals(field)) {
+						found = true;
+						break;
+					}
+				}
+				if (!found) {
+					throw new RuntimeException("Tuple "+type+" registered twice with different fields. New registration lacks field "+attribute.getName());
+				}
+			}
+			return oldTupleID;
+		}
+		int newTupleID = Tuple.createTupleType(type, fields);
+		registeredTuples.put(type, newTupleID);
+		return newTupleID;
+	}
+
+	/**
+	 * @param type
+	 * @return type ID
+	 */
+	public synchronized int getTupleTypeID(String type) {
+		Integer typeID = registeredTuples.get( type );
+		if (typeID == null) {
+			throw new RuntimeException("TupleType "+type+" not registered");
+		}
+		return typeID;
+	}
+
+	/**
+	 * @param type
+	 * @return true, if type is registered
+	 */
+	public synchronized boolean isRegistered(String type) {
+		return registeredTuples.containsKey(type);
+	}
+}
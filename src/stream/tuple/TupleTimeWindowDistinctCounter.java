@@ -0,0 +1,72 @@
+package stream.tuple;
+
+/**
+ * Time window operator. GROUP + approximate COUNT DISTINCT
+ * 
+ * Approximate replacement for TupleTimeWindowDistinctGroupAggregator with Counter.
+ * Uses a HyperLogLog sketch per group and sub window, memory is fixed per group.
+ * Emits tuples of type newTupleType with the group field and resultField set to 
+ * the estimated nr of distinct value combinations of the distinctFields.
+ * 
+ * @author mringwal
+ *
+ */
+public class TupleTimeWindowDistinctCounter extends TupleTimeWindowSketchAggregator<HyperLogLog> {
+
+	/** 64 registers, ~13% standard error */
+	public static final int DEFAULT_PRECISION = 6;
+	
+	private int precision;
+	private TupleAttribute distinctFields[];
+	private TupleAttribute resultField;
+	private String tupleType;
+	private int tupleTypeID;
+	
+	public TupleTimeWindowDistinctCounter(int timewindow, String groupField, String newTupleType, String resultField, String... distinctFields) {
+		this(timewindow, DEFAULT_PRECISION, groupField, newTupleType, resultField, distinctFields);
+	}
+
+	public TupleTimeWindowDistinctCounter(int timewindow, int precision, String groupField, String newTupleType, String resultField, String... distinctFields) {
+		super(timewindow, groupField);
+		this.precision = precision;
+		this.tupleType = newTupleType;
+		this.resultField = new TupleAttribute(resultField);
+		this.distinctFields = new TupleAttribute[distinctFields.length];
+		for (int i = 0; i < distinctFields.length; i++) {
+			this.distinctFields[i] = new TupleAttribute(distinctFields[i]);
+		}
+		tupleTypeID = Tuple.registerTupleType(newTupleType, groupField, resultField);
+	}
+	
+	protected HyperLogLog createSketch() {
+		return new HyperLogLog(precision);
+	}
+
+	protected void clearSketch(HyperLogLog sketch) {
+		sketch.clear();
+	}
+
+	protected void mergeSketch(HyperLogLog sketch, HyperLogLog other) {
+		sketch.merge(other);
+	}
+
+	protected void addToSketch(HyperLogLog sketch, Tuple tuple) {
+		int hash = 0;
+		for (TupleAttribute field : distinctFields) {
+			Object value = tuple.getAttribute(field);
+			hash = 31 * hash + (value == null ? 0 : value.hashCode());
+		}
+		sketch.add(hash);
+	}
+
+	protected void transferAggregate(Object gID, HyperLogLog sketch, long timestamp) {
+		Tuple aggregate = Tuple.createTuple(tupleTypeID);
+		aggregate.setAttribute(groupField, gID);
+		aggregate.setIntAttribute(resultField, (int) sketch.estimate());
+		transfer(aggregate, timestamp);
+	}
+	
+	public String getTupleType() {
+		return tupleType;
+	}
+}
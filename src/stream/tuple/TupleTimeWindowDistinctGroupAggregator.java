@@ -1,9 +1,15 @@
 package stream.tuple;
 
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.IOException;
 import java.util.Iterator;
+import java.util.Map;
 import java.util.Set;
 
+import stream.Checkpointable;
 import stream.Function;
+import stream.Scheduler;
 import stream.TimeStampedObject;
 import stream.TimeWindowDistinctGroupAggregator;
 
@@ -19,7 +25,7 @@ import stream.TimeWindowDistinctGroupAggregator;
  */
 
 public class TupleTimeWindowDistinctGroupAggregator extends
-TimeWindowDistinctGroupAggregator<Tuple, Object, Object, Tuple> {
+TimeWindowDistinctGroupAggregator<Tuple, Object, Object, Tuple> implements Checkpointable {
 
 	private static final String GROUPID_TUPLE_NAME = "groupID";
 	private static final String GROUPID_FIELD_NAME = "groupID";
@@ -139,4 +145,58 @@ TimeWindowDistinctGroupAggregator<Tuple, Object, Object, Tuple> {
 		String[] groupTupleField = {GROUPID_FIELD_NAME};
 		Tuple.registerTupleType(GROUPID_TUPLE_NAME, groupTupleField);
 	}
+
+	public void saveState(DataOutputStream out) throws IOException {
+		TupleCodec codec = new TupleCodec();
+		out.writeInt(map.size());
+		for (Map.Entry<Object, TimeStampedObject<Tuple>> entry : map.entrySet()) {
+			codec.writeValue(out, entry.getKey());
+			out.writeLong(entry.getValue().timestamp);
+			codec.writeValue(out, entry.getValue().object);
+		}
+		out.writeInt(window.size());
+		for (TimeStampedObject<Object> element : window) {
+			out.writeLong(element.timestamp);
+			codec.writeValue(out, element.object);
+		}
+		out.writeInt(initList.size());
+		for (TimeStampedObject<Object> element : initList) {
+			out.writeLong(element.timestamp);
+			codec.writeValue(out, element.object);
+		}
+		out.writeInt(registeredGroups.size());
+		for (Object gID : registeredGroups.keySet()) {
+			codec.writeValue(out, gID);
+		}
+	}
+
+	public void restoreState(DataInputStream in, long timeShift) throws IOException {
+		TupleCodec codec = new TupleCodec();
+		map.clear();
+		window.clear();
+		initList.clear();
+		registeredGroups.clear();
+		int count = in.readInt();
+		for (int i = 0; i < count; i++) {
+			Object key = codec.readValue(in);
+			long timestamp = in.readLong() + timeShift;
+			map.put( key, new TimeStampedObject<Tuple>(timestamp, codec.readTupleValue(in)));
+		}
+		count = in.readInt();
+		for (int i = 0; i < count; i++) {
+			long timestamp = in.readLong() + timeShift;
+			window.addLast( new TimeStampedObject<Object>(timestamp, codec.readValue(in)));
+			Scheduler.getInstance().registerTimeout( timestamp + timewindow, this);
+		}
+		count = in.readInt();
+		for (int i = 0; i < count; i++) {
+			long timestamp = in.readLong() + timeShift;
+			initList.addLast( new TimeStampedObject<Object>(timestamp, codec.readValue(in)));
+			Scheduler.getInstance().registerTimeout( timestamp + timewindow, this);
+		}
+		count = in.readInt();
+		for (int i = 0; i < count; i++) {
+			registeredGroups.put( codec.readValue(in), null);
+		}
+	}
 }
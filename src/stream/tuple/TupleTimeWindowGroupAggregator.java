@@ -1,6 +1,12 @@
 package stream.tuple;
 
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.IOException;
+
+import stream.Checkpointable;
 import stream.Function;
+import stream.Scheduler;
 import stream.TimeStampedObject;
 import stream.TimeWindowGroupAggregator;
 
@@ -14,7 +20,7 @@ import stream.TimeWindowGroupAggregator;
  *
  */
 
-public class TupleTimeWindowGroupAggregator extends TimeWindowGroupAggregator<Tuple,Object,Tuple> {
+public class TupleTimeWindowGroupAggregator extends TimeWindowGroupAggregator<Tuple,Object,Tuple> implements Checkpointable {
 
 	private static final String GROUPID_TUPLE_NAME = "groupID";
 	private static final String GROUPID_FIELD_NAME = "groupID";
@@ -93,5 +99,45 @@ public class TupleTimeWindowGroupAggregator extends TimeWindowGroupAggregator<Tu
 		String[] groupTupleField = {GROUPID_FIELD_NAME};
 		Tuple.registerTupleType(GROUPID_TUPLE_NAME, groupTupleField);
 	}
-}
 
+	public void saveState(DataOutputStream out) throws IOException {
+		TupleCodec codec = new TupleCodec();
+		out.writeInt(window.size());
+		for (TimeStampedObject<Tuple> element : window) {
+			out.writeLong(element.timestamp);
+			codec.writeValue(out, element.object);
+		}
+		out.writeInt(initList.size());
+		for (TimeStampedObject<Object> element : initList) {
+			out.writeLong(element.timestamp);
+			codec.writeValue(out, element.object);
+		}
+		out.writeInt(registeredGroups.size());
+		for (Object gID : registeredGroups.keySet()) {
+			codec.writeValue(out, gID);
+		}
+	}
+
+	public void restoreState(DataInputStream in, long timeShift) throws IOException {
+		TupleCodec codec = new TupleCodec();
+		window.clear();
+		initList.clear();
+		registeredGroups.clear();
+		int count = in.readInt();
+		for (int i = 0; i < count; i++) {
+			long timestamp = in.readLong() + timeShift;
+			window.addLast( new TimeStampedObject<Tuple>(timestamp, codec.readTupleValue(in)));
+			Scheduler.getInstance().registerTimeout( timestamp + timewindow, this);
+		}
+		count = in.readInt();
+		for (int i = 0; i < count; i++) {
+			long timestamp = in.readLong() + timeShift;
+			initList.addLast( new TimeStampedObject<Object>(timestamp, codec.readValue(in)));
+			Scheduler.getInstance().registerTimeout( timestamp + timewindow, this);
+		}
+		count = in.readInt();
+		for (int i = 0; i < count; i++) {
+			registeredGroups.put( codec.readValue(in), null);
+		}
+	}
+}
@@ -0,0 +1,225 @@
+package stream.tuple;
+
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.LinkedList;
+
+import stream.AbstractPipe;
+import stream.Scheduler;
+import stream.TimeStampedObject;
+import stream.TimeTriggered;
+
+/**
+ * Time window operator. GROUP + approximate AGGREGATE using fixed size sketches
+ * 
+ * Instead of keeping all tuples of the window, each group keeps one sketch per
+ * sub window. A sub window is dropped as a whole, once its newest tuple could 
+ * have left the time window. Hence, tuples stay up to one sub window, i.e.
+ * timewindow / SUB_WINDOWS rounded up, longer in the aggregate. The aggregate is computed by merging the sketches 
+ * of the live sub windows.
+ * 
+ * Late tuples, e.g. from DSN nodes, are added to their sub window as long as it is
+ * kept. Tuples older than the oldest sub window of their group are ignored.
+ * 
+ * Like TupleTimeWindowGroupAggregator, an aggregate is emitted for each tuple and 
+ * each time a sub window of a group expires. A groupID tuple with the single 
+ * attribute "groupID" can be used to assert that an aggregate is emitted after 
+ * time window time
+ * 
+ * @author mringwal
+ *
+ * @param <S> sketch type
+ */
+public abstract class TupleTimeWindowSketchAggregator<S> extends AbstractPipe<Tuple,Tuple> implements TimeTriggered {
+
+	private static final String GROUPID_TUPLE_NAME = "groupID";
+	private static final String GROUPID_FIELD_NAME = "groupID";
+
+	/** nr of sub windows per time window */
+	public static final int SUB_WINDOWS = 8;
+
+	/** slot of unused ring entry, timestamps can be negative */
+	private static final long EMPTY = Long.MIN_VALUE;
+
+	private class Group {
+		Object gID;
+		S sketches[];
+		long slots[];
+		S aggregate;
+		
+		@SuppressWarnings("unchecked")
+		Group(Object gID) {
+			this.gID = gID;
+			// one more, as the oldest sub window is partially outside of the window
+			sketches = (S[]) new Object[SUB_WINDOWS + 1];
+			slots = new long[SUB_WINDOWS + 1];
+			for (int i = 0; i < sketches.length; i++) {
+				sketches[i] = createSketch();
+				slots[i] = EMPTY;
+			}
+			aggregate = createSketch();
+		}
+		
+		boolean isEmpty() {
+			for (int i = 0; i < slots.length; i++) {
+				if (slots[i] != EMPTY) return false;
+			}
+			return true;
+		}
+	}
+	
+	protected int timewindow;
+	protected long slotLength;
+	protected TupleAttribute groupField;
+	protected TupleAttribute groupTupleGroupField;
+	
+	private HashMap<Object, Group> groups = new HashMap<Object, Group>();
+	private HashMap<Object, Object> registeredGroups = new HashMap<Object, Object>();
+	private LinkedList<TimeStampedObject<Object>> initList = new LinkedList<TimeStampedObject<Object>>();
+	private long lastTimeout = Long.MIN_VALUE;
+	
+	protected TupleTimeWindowSketchAggregator(int timewindow, String groupField) {
+		this.timewindow = timewindow;
+		// round up, so that a time window spans at most SUB_WINDOWS + 1 slots of the ring
+		this.slotLength = Math.max( 1, (timewindow + SUB_WINDOWS - 1) / SUB_WINDOWS);
+		this.groupField = new TupleAttribute( groupField);
+		this.groupTupleGroupField = new TupleAttribute( GROUPID_FIELD_NAME);
+
+		// register "group" tuple with "group" field
+		String[] groupTupleField = {GROUPID_FIELD_NAME};
+		Tuple.registerTupleType(GROUPID_TUPLE_NAME, groupTupleField);
+	}
+
+	/**
+	 * @return new, empty sketch
+	 */
+	protected abstract S createSketch();
+	
+	/**
+	 * reset sketch to empty state
+	 */
+	protected abstract void clearSketch(S sketch);
+
+	/**
+	 * add items of other to sketch
+	 */
+	protected abstract void mergeSketch(S sketch, S other);
+	
+	/**
+	 * add tuple to sketch
+	 */
+	protected abstract void addToSketch(S sketch, Tuple tuple);
+
+	/**
+	 * emit result tuple(s) for group
+	 * @param gID
+	 * @param sketch merged sketch of all live sub windows
+	 * @param timestamp
+	 */
+	protected abstract void transferAggregate(Object gID, S sketch, long timestamp);
+	
+	/**
+	 *  Handle GROUPID_TUPLE_NAME tuples that contain a group id
+	 */
+	public void process(Tuple o, int srcID, long timestamp) {
+		// check for "group" tuple
+		if (o.getType() == GROUPID_TUPLE_NAME) {
+			registerGroup(o.getAttribute(groupTupleGroupField), timestamp);
+			return;
+		}
+		Object gID = o.getAttribute(groupField);
+		Group group = groups.get(gID);
+		if (group == null) {
+			group = new Group(gID);
+			groups.put(gID, group);
+		}
+		long slot = getSlot(timestamp);
+		int index = (int) (((slot % group.slots.length) + group.slots.length) % group.slots.length);
+		if (group.slots[index] != slot) {
+			if (group.slots[index] != EMPTY && group.slots[index] > slot) {
+				// late tuple, its sub window has already been replaced by a newer one
+				return;
+			}
+			clearSketch(group.sketches[index]);
+			group.slots[index] = slot;
+		}
+		addToSketch(group.sketches[index], o);
+		aggregate(group, timestamp);
+		
+		// one timeout per sub window
+		long timeout = (slot + 1) * slotLength + timewindow;
+		if (timeout > lastTimeout) {
+			lastTimeout = timeout;
+			Scheduler.getInstance().registerTimeout( timeout, this);
+		}
+	}
+	
+	/**
+	 * Register group explicitly with operator to receive an aggregate even if no other items are processed
+	 * @param gID
+	 * @param timestamp
+	 */
+	protected void registerGroup(Object gID, long timestamp) {
+		if (!registeredGroups.containsKey(gID)) {
+			registeredGroups.put(gID, null);
+			initList.addLast(new TimeStampedObject<Object>(timestamp, gID));
+			Scheduler.getInstance().registerTimeout(timestamp + timewindow, this);
+		}
+	}
+
+	public void handleTimerEvent(long timestamp) {
+		// drop expired sub windows
+		ArrayList<Object> emptyGroups = new ArrayList<Object>();
+		for (Group group : groups.values()) {
+			boolean expired = false;
+			for (int i = 0; i < group.slots.length; i++) {
+				if (group.slots[i] != EMPTY && (group.slots[i] + 1) * slotLength + timewindow <= timestamp) {
+					clearSketch(group.sketches[i]);
+					group.slots[i] = EMPTY;
+					expired = true;
+				}
+			}
+			if (expired) {
+				aggregate(group, timestamp);
+			}
+			if (group.isEmpty()) {
+				emptyGroups.add(group.gID);
+			}
+		}
+		// memory is only kept for active groups
+		for (Object gID : emptyGroups) {
+			groups.remove(gID);
+		}
+		
+		// handle init timeouts for registered groups
+		while (initList.size() > 0 && initList.getFirst().timestamp + timewindow <= timestamp) {
+			Object gID = initList.removeFirst().object;
+			Group group = groups.get(gID);
+			if (group == null) {
+				group = new Group(gID);
+			}
+			aggregate(group, timestamp);
+		}
+	}
+
+	/**
+	 * @return sub window of timestamp, rounded down for negative timestamps, too
+	 */
+	private long getSlot(long timestamp) {
+		long slot = timestamp / slotLength;
+		if (timestamp < 0 && slot * slotLength != timestamp) {
+			slot--;
+		}
+		return slot;
+	}
+
+	private void aggregate(Group group, long timestamp) {
+		clearSketch(group.aggregate);
+		for (int i = 0; i < group.slots.length; i++) {
+			if (group.slots[i] != EMPTY) {
+				mergeSketch(group.aggregate, group.sketches[i]);
+			}
+		}
+		transferAggregate(group.gID, group.aggregate, timestamp);
+	}
+}
@@ -0,0 +1,73 @@
+package stream.tuple;
+
+/**
+ * Time window operator. GROUP + approximate TOP-K
+ * 
+ * Finds the most frequent values of itemField per group using a Space-Saving sketch 
+ * per group and sub window, memory is fixed per group. For each aggregate, one tuple 
+ * of type newTupleType is emitted for each of the k most frequent items, containing the 
+ * group field, the item field and resultField set to the (over-)estimated count. 
+ * 
+ * @author mringwal
+ *
+ */
+public class TupleTimeWindowTopK extends TupleTimeWindowSketchAggregator<SpaceSaving> {
+
+	private int k;
+	private int capacity;
+	private TupleAttribute itemField;
+	private TupleAttribute resultField;
+	private String tupleType;
+	private int tupleTypeID;
+	
+	/**
+	 * @param timewindow
+	 * @param groupField
+	 * @param itemField
+	 * @param k nr of items reported per group
+	 * @param newTupleType
+	 * @param resultField
+	 */
+	public TupleTimeWindowTopK(int timewindow, String groupField, String itemField, int k, String newTupleType, String resultField) {
+		super(timewindow, groupField);
+		this.k = k;
+		// more counters than reported items improves accuracy of the top k
+		this.capacity = 4 * k;
+		this.tupleType = newTupleType;
+		this.itemField = new TupleAttribute(itemField);
+		this.resultField = new TupleAttribute(resultField);
+		tupleTypeID = Tuple.registerTupleType(newTupleType, groupField, itemField, resultField);
+	}
+	
+	protected SpaceSaving createSketch() {
+		return new SpaceSaving(capacity);
+	}
+
+	protected void clearSketch(SpaceSaving sketch) {
+		sketch.clear();
+	}
+
+	protected void mergeSketch(SpaceSaving sketch, SpaceSaving other) {
+		sketch.merge(other);
+	}
+
+	protected void addToSketch(SpaceSaving sketch, Tuple tuple) {
+		sketch.add(tuple.getAttribute(itemField));
+	}
+
+	protected void transferAggregate(Object gID, SpaceSaving sketch, long timestamp) {
+		sketch.sort();
+		int items = Math.min(k, sketch.size());
+		for (int i = 0; i < items; i++) {
+			Tuple aggregate = Tuple.createTuple(tupleTypeID);
+			aggregate.setAttribute(groupField, gID);
+			aggregate.setAttribute(itemField, sketch.getItem(i));
+			aggregate.setIntAttribute(resultField, sketch.getCount(i));
+			transfer(aggregate, timestamp);
+		}
+	}
+
+	public String getTupleType() {
+		return tupleType;
+	}
+}
@@ -0,0 +1,238 @@
+package util;
+
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.Iterator;
+import java.util.LinkedHashMap;
+
+/**
+ * Estimate clock offset and drift of DSN nodes
+ *
+ * Each DSN node timestamps sniffed packets with its own clock. The node sending ticks,
+ * or else the first node seen, is the reference. When two nodes observe the same
+ * transmission, i.e. equal packets less than MATCH_WINDOW ms apart, the difference of
+ * their timestamps is a sample of the offset between their clocks. For each node, offset
+ * and drift relative to the reference are fitted by least squares over the last SAMPLES
+ * samples. Nodes are calibrated once they have MIN_SAMPLES samples, only observations by
+ * the reference or calibrated nodes are used as samples for others.
+ *
+ * Ticks also provide samples of the reference clock against the host clock. They are used
+ * to extrapolate the current reference time more accurately than from the last tick alone.
+ *
+ * Not thread-safe.
+ *
+ * @author mringwal
+ *
+ */
+public class ClockSkewEstimator {
+
+	/** max time between two observations of the same transmission in ms */
+	public static final long MATCH_WINDOW = 1000;
+
+	/** nr of samples per node */
+	public static final int SAMPLES = 64;
+
+	/** nr of samples before node is calibrated */
+	public static final int MIN_SAMPLES = 4;
+
+	/** max drift, larger estimates are caused by outliers */
+	public static final double MAX_DRIFT = 0.001;
+
+	/** linear model y = offset + drift * (x - x0) */
+	private static class ClockModel {
+		long x[] = new long[SAMPLES];
+		long y[] = new long[SAMPLES];
+		int nrSamples = 0;
+		int nextSample = 0;
+		long x0;
+		double offset;
+		double drift;
+		long residual;
+
+		void add(long sampleX, long sampleY) {
+			x[nextSample] = sampleX;
+			y[nextSample] = sampleY;
+			nextSample = (nextSample + 1) % SAMPLES;
+			if (nrSamples < SAMPLES) {
+				nrSamples++;
+			}
+			fit();
+		}
+
+		void fit() {
+			x0 = x[(nextSample - nrSamples + SAMPLES) % SAMPLES];
+			double sumX = 0, sumY = 0;
+			for (int i = 0; i < nrSamples; i++) {
+				sumX += x[i] - x0;
+				sumY += y[i];
+			}
+			double meanX = sumX / nrSamples;
+			double meanY = sumY / nrSamples;
+			double covariance = 0, variance = 0;
+			for (int i = 0; i < nrSamples; i++) {
+				double dx = x[i] - x0 - meanX;
+				covariance += dx * (y[i] - meanY);
+				variance += dx * dx;
+			}
+			drift = variance > 0 ? covariance / variance : 0;
+			drift = Math.max( -MAX_DRIFT, Math.min( MAX_DRIFT, drift));
+			offset = meanY - drift * meanX;
+			residual = 0;
+			for (int i = 0; i < nrSamples; i++) {
+				residual = Math.max(residual, Math.abs(y[i] - get(x[i])));
+			}
+		}
+
+		long get(long atX) {
+			return Math.round(offset + drift * (atX - x0));
+		}
+	}
+
+	private static class Observation {
+		Object node;
+		long timestamp;
+
+		Observation(Object node, long timestamp) {
+			this.node = node;
+			this.timestamp = timestamp;
+		}
+	}
+
+	private Object reference = null;
+	private boolean referenceFromTick = false;
+
+	/** all nodes with observations */
+	private HashSet<Object> observedNodes = new HashSet<Object>();
+
+	/** offset of node clock to reference clock */
+	private HashMap<Object, ClockModel> nodes = new HashMap<Object, ClockModel>();
+
+	/** reference time - host time */
+	private ClockModel hostModel = new ClockModel();
+
+	/** first observation of recent packets, in order of observation */
+	private LinkedHashMap<Object, Observation> recent = new LinkedHashMap<Object, Observation>();
+
+	/**
+	 * Tick with current time of node, which becomes the reference
+	 * @param node
+	 * @param timestamp node time
+	 * @param hostMillis host time of reception
+	 */
+	public void addTick(Object node, long timestamp, long hostMillis) {
+		if (!referenceFromTick) {
+			// models refer to old reference
+			reference = node;
+			referenceFromTick = true;
+			nodes.clear();
+		}
+		if (!node.equals(reference)) return;
+		hostModel.add(hostMillis, timestamp - hostMillis);
+	}
+
+	/**
+	 * @param hostMillis
+	 * @return reference time at host time, Long.MIN_VALUE without ticks
+	 */
+	public long getReferenceTime(long hostMillis) {
+		if (hostModel.nrSamples == 0) return Long.MIN_VALUE;
+		return hostMillis + hostModel.get(hostMillis);
+	}
+
+	/**
+	 * Observation of a packet by node. Observations have to be added roughly in time order.
+	 * @param node
+	 * @param timestamp node time
+	 * @param packet key with equals() and hashCode() on packet contents, kept for MATCH_WINDOW
+	 */
+	public void addObservation(Object node, long timestamp, Object packet) {
+		if (reference == null) {
+			reference = node;
+		}
+		observedNodes.add(node);
+		expire(timestamp);
+		Observation first = recent.get(packet);
+		if (first == null || first.node.equals(node) || Math.abs(timestamp - first.timestamp) > MATCH_WINDOW) {
+			recent.remove(packet);
+			recent.put(packet, new Observation(node, timestamp));
+			return;
+		}
+		if (isCalibrated(first.node) && !node.equals(reference)) {
+			getModel(node).add(timestamp, timestamp - correct(first.node, first.timestamp));
+		} else if (isCalibrated(node) && !first.node.equals(reference)) {
+			getModel(first.node).add(first.timestamp, first.timestamp - correct(node, timestamp));
+		}
+	}
+
+	/**
+	 * @param node
+	 * @param timestamp node time
+	 * @return reference time
+	 */
+	public long correct(Object node, long timestamp) {
+		if (!isCalibrated(node) || node.equals(reference)) return timestamp;
+		return timestamp - nodes.get(node).get(timestamp);
+	}
+
+	/**
+	 * @param node
+	 * @return true for reference and nodes with enough samples
+	 */
+	public boolean isCalibrated(Object node) {
+		if (node.equals(reference)) return true;
+		ClockModel model = nodes.get(node);
+		return model != null && model.nrSamples >= MIN_SAMPLES;
+	}
+
+	/**
+	 * @return true, if clocks of several nodes have been observed and all of them are calibrated
+	 */
+	public boolean isCalibrated() {
+		if (observedNodes.size() < 2) return false;
+		for (Object node : observedNodes) {
+			if (!isCalibrated(node)) return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @param node
+	 * @return drift of node clock relative to reference clock
+	 */
+	public double getDrift(Object node) {
+		ClockModel model = nodes.get(node);
+		return model == null ? 0 : model.drift;
+	}
+
+	/**
+	 * @return max deviation of samples from fitted clocks of calibrated nodes in ms. Remaining
+	 * timestamp differences of duplicates are below this, so the window for duplicates
+	 * can be reduced accordingly
+	 */
+	public long getMaxResidual() {
+		long residual = 0;
+		for (ClockModel model : nodes.values()) {
+			if (model.nrSamples >= MIN_SAMPLES) {
+				residual = Math.max(residual, model.residual);
+			}
+		}
+		return residual;
+	}
+
+	private ClockModel getModel(Object node) {
+		ClockModel model = nodes.get(node);
+		if (model == null) {
+			model = new ClockModel();
+			nodes.put(node, model);
+		}
+		return model;
+	}
+
+	private void expire(long timestamp) {
+		Iterator<Observation> observations = recent.values().iterator();
+		while (observations.hasNext()) {
+			if (observations.next().timestamp >= timestamp - 2 * MATCH_WINDOW) break;
+			observations.remove();
+		}
+	}
+}
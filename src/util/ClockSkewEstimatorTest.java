@@ -0,0 +1,115 @@
+package util;
+
+/**
+ * Self-check: ClockSkewEstimator converges to offset and drift of synthetic node clocks
+ * 
+ * @author mringwal
+ *
+ */
+public class ClockSkewEstimatorTest {
+
+	/** one packet every STEP ms */
+	private static final int STEP = 2000;
+	private static final int PACKETS = 200;
+
+	/** node B: +300 ms, 200 ppm fast. Node C: -300 ms, 100 ppm slow */
+	private static final double DRIFT_B = 0.0002 / 1.0002;
+	private static final double DRIFT_C = -0.0001 / 0.9999;
+
+	private static final String nodes[] = { "A", "B", "C" };
+
+	/**
+	 * @return clock of node at reference time
+	 */
+	private static long clock(int node, long time) {
+		switch (node) {
+		case 1:
+			return time + 300 + time * 2 / 10000;
+		case 2:
+			return time - 300 - time / 10000;
+		default:
+			return time;
+		}
+	}
+
+	/**
+	 * @return timestamp of packet nr by node, with reception jitter of +-2 ms
+	 */
+	private static long timestamp(int node, int nr) {
+		long jitter = ((nr * 37 + node * 11) % 5) - 2;
+		return clock(node, getTime(nr)) + jitter;
+	}
+
+	private static long getTime(int nr) {
+		return 10000 + nr * STEP;
+	}
+
+	/**
+	 * packet nr observed by two nodes
+	 */
+	private static void observe(ClockSkewEstimator estimator, int first, int second, int nr) {
+		Integer packet = new Integer(nr);
+		estimator.addObservation(nodes[first], timestamp(first, nr), packet);
+		estimator.addObservation(nodes[second], timestamp(second, nr), packet);
+	}
+
+	private static void checkClock(ClockSkewEstimator estimator, int node, double drift, long time) {
+		String name = nodes[node];
+		SelfCheck.check( estimator.isCalibrated(name), name + " not calibrated");
+		SelfCheck.check( Math.abs(estimator.getDrift(name) - drift) < 2e-5, "drift of " + name + ": " + estimator.getDrift(name));
+		long error = estimator.correct(name, clock(node, time)) - time;
+		SelfCheck.check( Math.abs(error) <= 5, "corrected time of " + name + " off by " + error);
+	}
+
+	public static void main(String[] args) {
+		ClockSkewEstimator estimator = new ClockSkewEstimator();
+
+		// A and B observe packets, first node is the reference
+		for (int nr = 0; nr < ClockSkewEstimator.MIN_SAMPLES; nr++) {
+			SelfCheck.check( !estimator.isCalibrated("B"), "B calibrated after " + nr + " samples");
+			SelfCheck.check( estimator.correct("B", 5000) == 5000, "uncalibrated B corrected");
+			observe(estimator, 0, 1, nr);
+		}
+		SelfCheck.check( estimator.isCalibrated("A"), "reference not calibrated");
+		SelfCheck.check( estimator.isCalibrated(), "A and B not calibrated");
+		for (int nr = ClockSkewEstimator.MIN_SAMPLES; nr < PACKETS; nr++) {
+			observe(estimator, 0, 1, nr);
+		}
+		checkClock(estimator, 1, DRIFT_B, getTime(PACKETS));
+		SelfCheck.check( estimator.getMaxResidual() <= 8, "residual " + estimator.getMaxResidual());
+
+		// C is only observed together with B, calibrated via B
+		observe(estimator, 1, 2, PACKETS);
+		SelfCheck.check( !estimator.isCalibrated(), "C calibrated after one sample");
+		for (int nr = PACKETS + 1; nr < 2 * PACKETS; nr++) {
+			observe(estimator, 1, 2, nr);
+		}
+		SelfCheck.check( estimator.isCalibrated(), "C not calibrated");
+		checkClock(estimator, 1, DRIFT_B, getTime(2 * PACKETS));
+		checkClock(estimator, 2, DRIFT_C, getTime(2 * PACKETS));
+		SelfCheck.check( estimator.getMaxResidual() <= 8, "residual " + estimator.getMaxResidual());
+
+		// unrelated packets with equal contents are not matched
+		estimator.addObservation("A", getTime(3 * PACKETS), "other");
+		estimator.addObservation("B", clock(1, getTime(3 * PACKETS)) + 5 * ClockSkewEstimator.MATCH_WINDOW, "other");
+		checkClock(estimator, 1, DRIFT_B, getTime(2 * PACKETS));
+
+		// ticks make their sender the reference, models for old reference are dropped
+		long host = 1200000000000L;
+		estimator.addTick("C", clock(2, getTime(2 * PACKETS)), host);
+		SelfCheck.check( !estimator.isCalibrated("B"), "B calibrated after reference changed");
+		SelfCheck.check( estimator.isCalibrated("C"), "new reference not calibrated");
+
+		// reference time extrapolated from ticks, reference clock 50 ppm fast
+		ClockSkewEstimator ticks = new ClockSkewEstimator();
+		SelfCheck.check( ticks.getReferenceTime(host) == Long.MIN_VALUE, "reference time without ticks");
+		for (int i = 0; i < 100; i++) {
+			long hostMillis = host + i * 1000 + (i % 3);
+			ticks.addTick("A", 12345 + i * 1000 + i / 20, hostMillis);
+		}
+		long error = ticks.getReferenceTime(host + 110000) - (12345 + 110000 + 110 / 20);
+		SelfCheck.check( Math.abs(error) <= 3, "reference time off by " + error);
+
+		System.out.println("ClockSkewEstimatorTest: OK");
+	}
+}
@@ -1,7 +1,7 @@
 package util;
 import java.io.BufferedReader;
+import java.io.File;
 import java.io.FileNotFoundException;
-import java.io.FileReader;
 import java.io.IOException;
 import java.io.StringReader;
 import java.util.StringTokenizer;
@@ -23,6 +23,18 @@ public class LinkDumpParser {
 	private LinkDumpParser( BufferedReader input) {
 		reader = input;
 	}
+
+	/**
+	 * Constructor from log file, allows to seek
+	 */
+	private LinkDumpParser( File file) throws IOException {
+		logFile = file;
+		fileReader = new SeekableLineReader(file);
+		index = TimeIndex.load(file);
+		if (index == null) {
+			newIndex = new TimeIndex();
+		}
+	}
 	
 	/**
 	 * Factory method to create a parser which is fed by a String
@@ -36,8 +48,60 @@ public class LinkDumpParser {
 	}
 
 	public static LinkDumpParser createLinkDumpParserFromFile(String fileName) throws FileNotFoundException {
-		BufferedReader buffReader = new BufferedReader( new FileReader(fileName) );
-		return new LinkDumpParser(buffReader);
+		try {
+			return new LinkDumpParser(new File(fileName));
+		} catch (FileNotFoundException e) {
+			throw e;
+		} catch (IOException e) {
+			throw new FileNotFoundException("LinkDumpParser: cannot open " + fileName + ": " + e.getMessage());
+		}
+	}
+
+	/**
+	 * Continue reading with the first packet at or after time.
+	 * 
+	 * If the log has not been indexed yet, the index is built first by reading the whole file.
+	 * 
+	 * @param time in ms
+	 * @throws Exception
+	 */
+	public void seek(long time) throws Exception {
+		if (fileReader == null) {
+			throw new IOException("LinkDumpParser: can only seek in log files");
+		}
+		if (index == null) {
+			// read whole file once
+			fileReader.seek(0);
+			logFileHeader = true;
+			newIndex = new TimeIndex();
+			packetsRead = 0;
+			while (readPacket() != null);
+			if (index == null) {
+				// stopped before end of file, use index as far as read
+				index = newIndex;
+			}
+		}
+		newIndex = null;
+		int entry = index.findTime(time);
+		if (entry >= 0) {
+			fileReader.seek(index.getOffset(entry));
+			logFileHeader = false;
+		} else {
+			fileReader.seek(0);
+			logFileHeader = true;
+		}
+		// skip packets before time
+		while (true) {
+			long offset = fileReader.getPosition();
+			Packet packet = readPacket();
+			if (packet == null) break;
+			if (packet.time_ms >= time) {
+				fileReader.seek(offset);
+				// offset may be before log file header
+				logFileHeader = (offset == 0);
+				break;
+			}
+		}
 	}
 	/**
 	 * Read an emstar link-dump packet from an input stream
@@ -51,9 +115,19 @@ public class LinkDumpParser {
 		String lineBuffer;
 
 		// be prepared for some log file header
+		long offset = -1;
 		while (true) {
-			lineBuffer = reader.readLine();
+			if (fileReader != null) {
+				offset = fileReader.getPosition();
+			}
+			lineBuffer = readLine();
 			if (lineBuffer == null) {
+				if (newIndex != null) {
+					// complete file read, store index for next time
+					newIndex.save(logFile);
+					index = newIndex;
+					newIndex = null;
+				}
 				return null;
 			}
 			headerMatcher = packetHeaderPattern.matcher(lineBuffer);
@@ -90,24 +164,28 @@ public class LinkDumpParser {
 		// store time given as seconds + useconds as ms
 		packet.time_ms = Integer.parseInt(headerMatcher.group(9)) * 1000L
 				+ Integer.parseInt(headerMatcher.group(10)) / 1000;
+		if (newIndex != null) {
+			newIndex.add(packet.time_ms, offset, packetsRead);
+		}
+		packetsRead++;
 		// allocate buffer
 		packet.data = new int[packet.data_len];
-		int offset = 0;
+		int dataOffset = 0;
 		// awaiting data
 
-		while (offset < packet.data_len) {
-			lineBuffer = reader.readLine();
+		while (dataOffset < packet.data_len) {
+			lineBuffer = readLine();
 			Matcher lineMatcher = dataLinePattern.matcher(lineBuffer);
 			if (lineMatcher.matches()) {
 				int readOffset = Integer.parseInt(lineMatcher.group(1));
-				if (readOffset != offset)
+				if (readOffset != dataOffset)
 					throw new Exception(
 							"Packet Parser: DataLine Offset incorrect. is: "
-									+ readOffset + " should be: " + offset);
+									+ readOffset + " should be: " + dataOffset);
 				StringTokenizer tokenizer = new StringTokenizer(lineMatcher
 						.group(2));
 				while (tokenizer.hasMoreTokens()) {
-					packet.data[offset++] = Integer.parseInt(tokenizer
+					packet.data[dataOffset++] = Integer.parseInt(tokenizer
 							.nextToken(), 16);
 				}
 			}
@@ -115,6 +193,13 @@ public class LinkDumpParser {
 		return packet;
 	}
 
+	private String readLine() throws IOException {
+		if (fileReader != null) {
+			return fileReader.readLine();
+		}
+		return reader.readLine();
+	}
+
 	 
 	/** 
 	 * Test Packet parsing
@@ -175,5 +260,12 @@ public class LinkDumpParser {
 
 	/** private members */
 	private BufferedReader reader = null;
+	private SeekableLineReader fileReader = null;
+	private File logFile = null;
 	private boolean logFileHeader = true;
+	private int packetsRead = 0;
+	
+	/** time index, built while reading the whole file if not stored yet */
+	private TimeIndex index = null;
+	private TimeIndex newIndex = null;
 }
@@ -0,0 +1,98 @@
+package util;
+
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+
+/**
+ * Buffered line reader for files that knows the file offset of the next line
+ * and can seek to a previously reported offset.
+ * 
+ * Bytes are mapped 1:1 to chars, which is fine for ASCII logs.
+ * 
+ * @author mringwal
+ *
+ */
+public class SeekableLineReader {
+
+	private static final int BUFFER_SIZE = 64 * 1024;
+	
+	private RandomAccessFile file;
+	private byte buffer[] = new byte[BUFFER_SIZE];
+	/** file offset of buffer[0] */
+	private long bufferStart = 0;
+	private int bufferLength = 0;
+	private int pos = 0;
+	private StringBuffer line = new StringBuffer();
+	
+	public SeekableLineReader(File file) throws IOException {
+		this.file = new RandomAccessFile(file, "r");
+	}
+	
+	/**
+	 * @return file offset of next line
+	 */
+	public long getPosition() {
+		return bufferStart + pos;
+	}
+	
+	/**
+	 * continue reading at given offset
+	 * @param offset
+	 * @throws IOException
+	 */
+	public void seek(long offset) throws IOException {
+		if (offset >= bufferStart && offset <= bufferStart + bufferLength) {
+			pos = (int) (offset - bufferStart);
+			return;
+		}
+		file.seek(offset);
+		bufferStart = offset;
+		bufferLength = 0;
+		pos = 0;
+	}
+	
+	/**
+	 * @return next line without line terminator or null at end of file
+	 * @throws IOException
+	 */
+	public String readLine() throws IOException {
+		line.setLength(0);
+		boolean found = false;
+		while (true) {
+			if (pos == bufferLength && !fill()) {
+				// end of file
+				return found ? line.toString() : null;
+			}
+			found = true;
+			byte c = buffer[pos++];
+			if (c == '\n') {
+				break;
+			}
+			if (c == '\r') {
+				// skip \n of \r\n
+				if (pos == bufferLength) fill();
+				if (pos < bufferLength && buffer[pos] == '\n') pos++;
+				break;
+			}
+			line.append((char) (c & 0xff));
+		}
+		return line.toString();
+	}
+	
+	public void close() throws IOException {
+		file.close();
+	}
+	
+	private boolean fill() throws IOException {
+		bufferStart += bufferLength;
+		pos = 0;
+		bufferLength = 0;
+		int read = file.read(buffer, 0, buffer.length);
+		if (read <= 0) {
+			return false;
+		}
+		bufferLength = read;
+		return true;
+	}
+}
@@ -0,0 +1,25 @@
+package util;
+
+/**
+ * Support for self-checks
+ * 
+ * A self-check is a class named ...Test with a main() that exercises some classes and fails
+ * with an exception. Target "test" in build.xml runs all self-checks in the project directory,
+ * with assertions enabled so that the asserts of the checked classes are active as well.
+ * 
+ * @author mringwal
+ *
+ */
+public class SelfCheck {
+
+	/**
+	 * @param condition
+	 * @param message describing the failure
+	 * @throws RuntimeException if condition does not hold
+	 */
+	public static void check(boolean condition, String message) {
+		if (!condition) {
+			throw new RuntimeException(message);
+		}
+	}
+}
@@ -0,0 +1,181 @@
+package util;
+
+import java.io.BufferedInputStream;
+import java.io.BufferedOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+
+/**
+ * Sparse index mapping packet timestamps to file offsets of a capture file
+ * 
+ * An entry is added for the first packet at least interval ms after the previous entry.
+ * The index is stored next to the log file as LOG.idx and is ignored if the log is newer.
+ * 
+ * Timestamps in a log are only roughly ordered, so readers should start a bit earlier 
+ * than the packet of interest.
+ * 
+ * @author mringwal
+ *
+ */
+public class TimeIndex {
+
+	public static final String SUFFIX = ".idx";
+	
+	/** default: one entry every 10 seconds */
+	public static final long DEFAULT_INTERVAL = 10 * 1000;
+
+	private static final int MAGIC = 0x534e4958; // "SNIX"
+	
+	private long interval;
+	private int size = 0;
+	private long times[] = new long[64];
+	private long offsets[] = new long[64];
+	private int packetNrs[] = new int[64];
+	
+	public TimeIndex() {
+		this(DEFAULT_INTERVAL);
+	}
+	
+	public TimeIndex(long interval) {
+		this.interval = interval;
+	}
+	
+	/**
+	 * register packet 
+	 * @param time of packet
+	 * @param offset in file
+	 * @param packetNr nr of packets before this one
+	 */
+	public void add(long time, long offset, int packetNr) {
+		if (size > 0 && time < times[size-1] + interval) {
+			return;
+		}
+		if (size == times.length) {
+			long newTimes[] = new long[size * 2];
+			long newOffsets[] = new long[size * 2];
+			int newPacketNrs[] = new int[size * 2];
+			System.arraycopy(times, 0, newTimes, 0, size);
+			System.arraycopy(offsets, 0, newOffsets, 0, size);
+			System.arraycopy(packetNrs, 0, newPacketNrs, 0, size);
+			times = newTimes;
+			offsets = newOffsets;
+			packetNrs = newPacketNrs;
+		}
+		times[size] = time;
+		offsets[size] = offset;
+		packetNrs[size] = packetNr;
+		size++;
+	}
+	
+	/**
+	 * @param time
+	 * @return entry of last indexed packet before or at time, -1 if there is none
+	 */
+	public int findTime(long time) {
+		int low = 0;
+		int high = size - 1;
+		int result = -1;
+		while (low <= high) {
+			int mid = (low + high) >>> 1;
+			if (times[mid] <= time) {
+				result = mid;
+				low = mid + 1;
+			} else {
+				high = mid - 1;
+			}
+		}
+		return result;
+	}
+
+	/**
+	 * @param packetNr
+	 * @return entry of last indexed packet before or at packetNr, -1 if there is none
+	 */
+	public int findPacket(int packetNr) {
+		int result = -1;
+		for (int i = 0; i < size && packetNrs[i] <= packetNr; i++) {
+			result = i;
+		}
+		return result;
+	}
+	
+	public long getTime(int entry) {
+		return times[entry];
+	}
+
+	public long getOffset(int entry) {
+		return offsets[entry];
+	}
+
+	public int getPacketNr(int entry) {
+		return packetNrs[entry];
+	}
+	
+	public int size() {
+		return size;
+	}
+	
+	/**
+	 * @param logFile
+	 * @return index file for log
+	 */
+	public static File getIndexFile(File logFile) {
+		return new File(logFile.getPath() + SUFFIX);
+	}
+	
+	/**
+	 * @param logFile
+	 * @return stored index or null, if missing or outdated
+	 */
+	public static TimeIndex load(File logFile) {
+		File indexFile = getIndexFile(logFile);
+		if (!indexFile.exists() || indexFile.lastModified() < logFile.lastModified()) {
+			return null;
+		}
+		DataInputStream in = null;
+		try {
+			in = new DataInputStream(new BufferedInputStream(new FileInputStream(indexFile)));
+			if (in.readInt() != MAGIC) return null;
+			TimeIndex index = new TimeIndex(in.readLong());
+			int count = in.readInt();
+			for (int i = 0; i < count; i++) {
+				index.add(in.readLong(), in.readLong(), in.readInt());
+			}
+			return index;
+		} catch (IOException e) {
+			System.out.println("TimeIndex: cannot read " + indexFile + ": " + e.getMessage());
+			return null;
+		} finally {
+			try {
+				if (in != null) in.close();
+			} catch (IOException e) {
+			}
+		}
+	}
+	
+	/**
+	 * store index next to log file
+	 * @param logFile
+	 */
+	public void save(File logFile) {
+		File indexFile = getIndexFile(logFile);
+		try {
+			DataOutputStream out = new DataOutputStream(new BufferedOutputStream(new FileOutputStream(indexFile)));
+			out.writeInt(MAGIC);
+			out.writeLong(interval);
+			out.writeInt(size);
+			for (int i = 0; i < size; i++) {
+				out.writeLong(times[i]);
+				out.writeLong(offsets[i]);
+				out.writeInt(packetNrs[i]);
+			}
+			out.close();
+		} catch (IOException e) {
+			System.out.println("TimeIndex: cannot write " + indexFile + ": " + e.getMessage());
+		}
+	}
+}